@@ -0,0 +1,88 @@
+#   Copyright 2020-2021 PragmaTwice
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+
+# protopuf_generate(<HEADERS> <proto>... [OPTIONS <option>...] [IMPORT_DIRS <dir>...])
+#
+# Generate protopuf message type aliases from .proto files via protoc and protoc-gen-protopuf,
+# like `protobuf_generate_cpp`: `<name>.pp.h` is generated into CMAKE_CURRENT_BINARY_DIR for each `<name>.proto`
+# (relative to CMAKE_CURRENT_SOURCE_DIR), and paths of generated headers are stored into variable <HEADERS>.
+#
+# OPTIONS are passed to the plugin, i.e. `namespace=x::y`.
+# IMPORT_DIRS are searched for imports besides CMAKE_CURRENT_SOURCE_DIR and the directory of `protopuf/options.proto`.
+#
+# protoc is found as `Protobuf_PROTOC_EXECUTABLE` or in PATH, and the plugin is the target `protoc-gen-protopuf`
+# (built from this repository) or `PROTOPUF_GENERATOR` (i.e. an installed one).
+
+set(PROTOPUF_PROTO_DIR "${CMAKE_CURRENT_LIST_DIR}/../include")
+if(NOT EXISTS "${PROTOPUF_PROTO_DIR}/protopuf/options.proto")
+    # installed into <prefix>/share/protopuf
+    set(PROTOPUF_PROTO_DIR "${CMAKE_CURRENT_LIST_DIR}/../../include")
+endif()
+get_filename_component(PROTOPUF_PROTO_DIR "${PROTOPUF_PROTO_DIR}" ABSOLUTE)
+
+function(protopuf_generate HEADERS)
+    cmake_parse_arguments(ARG "" "" "OPTIONS;IMPORT_DIRS" ${ARGN})
+
+    if(NOT ARG_UNPARSED_ARGUMENTS)
+        message(SEND_ERROR "protopuf_generate() called without any proto files")
+        return()
+    endif()
+
+    if(Protobuf_PROTOC_EXECUTABLE)
+        set(PROTOC ${Protobuf_PROTOC_EXECUTABLE})
+    else()
+        find_program(PROTOC protoc REQUIRED)
+    endif()
+
+    if(TARGET protoc-gen-protopuf)
+        set(PLUGIN $<TARGET_FILE:protoc-gen-protopuf>)
+        set(PLUGIN_DEPENDS protoc-gen-protopuf)
+    elseif(PROTOPUF_GENERATOR)
+        set(PLUGIN ${PROTOPUF_GENERATOR})
+    else()
+        find_program(PLUGIN protoc-gen-protopuf REQUIRED)
+    endif()
+
+    set(IMPORT_FLAGS -I ${CMAKE_CURRENT_SOURCE_DIR} -I ${PROTOPUF_PROTO_DIR})
+    foreach(DIR ${ARG_IMPORT_DIRS} ${Protobuf_INCLUDE_DIRS})
+        get_filename_component(DIR ${DIR} ABSOLUTE)
+        list(APPEND IMPORT_FLAGS -I ${DIR})
+    endforeach()
+
+    # options are passed via `--protopuf_opt` since `--protopuf_out=<options>:<dir>` splits on the first colon
+    set(OUT_FLAG --protopuf_out=${CMAKE_CURRENT_BINARY_DIR})
+    if(ARG_OPTIONS)
+        string(REPLACE ";" "," PLUGIN_OPTIONS "${ARG_OPTIONS}")
+        list(APPEND OUT_FLAG --protopuf_opt=${PLUGIN_OPTIONS})
+    endif()
+
+    set(GENERATED)
+    foreach(PROTO ${ARG_UNPARSED_ARGUMENTS})
+        get_filename_component(ABS_PROTO ${PROTO} ABSOLUTE)
+        file(RELATIVE_PATH REL_PROTO ${CMAKE_CURRENT_SOURCE_DIR} ${ABS_PROTO})
+        string(REGEX REPLACE "\\.proto$" ".pp.h" HEADER ${REL_PROTO})
+        set(HEADER ${CMAKE_CURRENT_BINARY_DIR}/${HEADER})
+
+        add_custom_command(
+            OUTPUT ${HEADER}
+            COMMAND ${PROTOC} --plugin=protoc-gen-protopuf=${PLUGIN} ${OUT_FLAG} ${IMPORT_FLAGS} ${ABS_PROTO}
+            DEPENDS ${ABS_PROTO} ${PLUGIN_DEPENDS} ${PROTOPUF_PROTO_DIR}/protopuf/options.proto
+            COMMENT "Running protoc-gen-protopuf on ${PROTO}"
+            VERBATIM)
+
+        list(APPEND GENERATED ${HEADER})
+    endforeach()
+
+    set(${HEADERS} ${GENERATED} PARENT_SCOPE)
+endfunction()
@@ -0,0 +1,585 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+// protoc-gen-protopuf: a protoc plugin which generates protopuf message type aliases from .proto files, i.e.
+//
+//   protoc --plugin=protoc-gen-protopuf=<path> --protopuf_out=<options>:<dir> -I <protopuf/include> a.proto
+//
+// generates `a.pp.h` into <dir>. The request from protoc and the response to it are coded by protopuf itself.
+//
+// Options (separated by commas):
+// - namespace=<ns>: the namespace of generated types instead of the one derived from the package, i.e. `namespace=x::y`
+
+#include <protopuf/message.h>
+
+#include <cctype>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+using namespace pp;
+
+namespace desc {
+
+    // subsets of google/protobuf/descriptor.proto and google/protobuf/compiler/plugin.proto
+
+    enum class label : int32 {
+        optional = 1,
+        required = 2,
+        repeated = 3
+    };
+
+    enum class kind : int32 {
+        double_ = 1, float_, int64, uint64, int32, fixed64, fixed32, bool_, string, group, message, bytes,
+        uint32, enum_, sfixed32, sfixed64, sint32, sint64
+    };
+
+    enum class string_type : int32 {
+        string = 0,
+        view = 1,
+        pmr = 2
+    };
+
+    enum class map_type : int32 {
+        ordered = 0,
+        hash = 1,
+        sorted = 2,
+        pmr = 3
+    };
+
+    // protopuf/options.proto
+    using PufFieldOptions = message<enum_field<"string_type", 1, string_type>, bool_field<"lazy", 2>, enum_field<"map_type", 3, map_type>>;
+    using PufMessageOptions = message<bool_field<"compact", 1>, bool_field<"preserve_unknown", 2>>;
+
+    using FieldOptions = message<bool_field<"packed", 2>, message_field<"protopuf", 52000, PufFieldOptions>>;
+    using MessageOptions = message<bool_field<"map_entry", 7>, message_field<"protopuf", 52000, PufMessageOptions>>;
+
+    using FieldDescriptorProto = message<string_view_field<"name", 1>, int32_field<"number", 3>, enum_field<"label", 4, label>,
+        enum_field<"type", 5, kind>, string_view_field<"type_name", 6>, message_field<"options", 8, FieldOptions>,
+        int32_field<"oneof_index", 9>, bool_field<"proto3_optional", 17>>;
+
+    using OneofDescriptorProto = message<string_view_field<"name", 1>>;
+
+    using EnumValueDescriptorProto = message<string_view_field<"name", 1>, int32_field<"number", 2>>;
+
+    using EnumDescriptorProto = message<string_view_field<"name", 1>, message_field<"value", 2, EnumValueDescriptorProto, repeated>>;
+
+    // nested types are kept encoded, since a recursive message type cannot be aliased
+    using DescriptorProto = message<string_view_field<"name", 1>, message_field<"field", 2, FieldDescriptorProto, repeated>,
+        bytes_view_field<"nested_type", 3, repeated>, message_field<"enum_type", 4, EnumDescriptorProto, repeated>,
+        message_field<"options", 7, MessageOptions>, message_field<"oneof_decl", 8, OneofDescriptorProto, repeated>>;
+
+    using FileDescriptorProto = message<string_view_field<"name", 1>, string_view_field<"package", 2>,
+        string_view_field<"dependency", 3, repeated>, message_field<"message_type", 4, DescriptorProto, repeated>,
+        message_field<"enum_type", 5, EnumDescriptorProto, repeated>, string_view_field<"syntax", 12>>;
+
+    using CodeGeneratorRequest = message<string_view_field<"file_to_generate", 1, repeated>, string_view_field<"parameter", 2>,
+        message_field<"proto_file", 15, FileDescriptorProto, repeated>>;
+
+    using GeneratedFile = message<string_field<"name", 1>, string_field<"content", 15>>;
+
+    using CodeGeneratorResponse = message<string_field<"error", 1>, uint64_field<"supported_features", 2>,
+        message_field<"file", 15, GeneratedFile, repeated>>;
+
+    // CodeGeneratorResponse.Feature.FEATURE_PROTO3_OPTIONAL
+    constexpr uint64 proto3_optional = 1;
+}
+
+namespace {
+
+    struct generate_error {
+        std::string what;
+    };
+
+    /// A message or enum type found in any file of the request
+    struct type_info {
+        /// the C++ name in its namespace, i.e. `Outer_Inner`
+        std::string name;
+
+        /// the C++ namespace, i.e. `a::b`
+        std::string ns;
+
+        const desc::FileDescriptorProto* file = nullptr;
+
+        /// the message type, or null for enum types
+        const desc::DescriptorProto* message = nullptr;
+
+        /// the enum type, or null for message types
+        const desc::EnumDescriptorProto* enumeration = nullptr;
+
+        bool map_entry() const {
+            return message && message->get<"options">() && message->get<"options">()->get<"map_entry">().value_or(false);
+        }
+    };
+
+    std::string str(std::string_view s) {
+        return std::string(s);
+    }
+
+    std::string proto_to_header(std::string_view proto) {
+        auto name = str(proto);
+        if(name.ends_with(".proto")) {
+            name.resize(name.size() - 6);
+        }
+
+        return name + ".pp.h";
+    }
+
+    class generator {
+        std::string ns_option;
+        bool has_ns_option = false;
+
+        /// decoded nested types, which are referred by @ref type_info
+        std::deque<desc::DescriptorProto> nested;
+
+        /// types by full proto names, i.e. `.a.b.Outer.Inner`
+        std::map<std::string, type_info> types;
+
+        /// full names of types declared in each file, in declaration order
+        std::map<const desc::FileDescriptorProto*, std::vector<std::string>> declared;
+
+        void declare(const std::string& full, type_info t) {
+            declared[t.file].push_back(full);
+            types[full] = std::move(t);
+        }
+
+        std::string namespace_of(const desc::FileDescriptorProto& file) const {
+            if(has_ns_option) {
+                return ns_option;
+            }
+
+            std::string ns;
+            for(char c : file.get<"package">().value_or("")) {
+                if(c == '.') {
+                    ns += "::";
+                } else {
+                    ns += c;
+                }
+            }
+
+            return ns;
+        }
+
+        void collect(const desc::FileDescriptorProto& file, const desc::DescriptorProto& msg, const std::string& scope, const std::string& prefix) {
+            auto name = str(msg["name"_f].value_or(""));
+            auto full = scope + "." + name;
+            auto cpp = prefix + name;
+
+            declare(full, {cpp, namespace_of(file), &file, &msg});
+
+            for(const auto& e : msg["enum_type"_f]) {
+                auto n = str(e["name"_f].value_or(""));
+                declare(full + "." + n, {cpp + "_" + n, namespace_of(file), &file, nullptr, &e});
+            }
+
+            for(auto b : msg["nested_type"_f]) {
+                // views refer to the input buffer, which is mutable
+                auto r = message_coder<desc::DescriptorProto>::checked_decode(bytes(const_cast<std::byte*>(b.data()), b.size()));
+                if(!r) {
+                    throw generate_error{"malformed nested type in " + full};
+                }
+
+                nested.push_back(std::move(r->first));
+                collect(file, nested.back(), full, cpp + "_");
+            }
+        }
+
+        const type_info& find(std::string_view type_name) const {
+            auto it = types.find(str(type_name));
+            if(it == types.end()) {
+                throw generate_error{"type " + str(type_name) + " is not found"};
+            }
+
+            return it->second;
+        }
+
+        /// the C++ name of a type referred from namespace `ns`
+        static std::string qualified(const type_info& t, const std::string& ns) {
+            if(t.ns == ns) {
+                return t.name;
+            }
+
+            return (t.ns.empty() ? "::" : "::" + t.ns + "::") + t.name;
+        }
+
+        static const desc::PufFieldOptions& options_of(const desc::FieldDescriptorProto& f) {
+            static const desc::PufFieldOptions none;
+
+            const auto& o = f["options"_f];
+            return o && o->get<"protopuf">() ? *o->get<"protopuf">() : none;
+        }
+
+        static std::string scalar_field(desc::kind k, desc::string_type s) {
+            using desc::kind;
+            using desc::string_type;
+
+            switch(k) {
+                case kind::double_: return "pp::double_field";
+                case kind::float_: return "pp::float_field";
+                case kind::int64: return "pp::int64_field";
+                case kind::uint64: return "pp::uint64_field";
+                case kind::int32: return "pp::int32_field";
+                case kind::fixed64: return "pp::fixed64_field";
+                case kind::fixed32: return "pp::fixed32_field";
+                case kind::bool_: return "pp::bool_field";
+                case kind::uint32: return "pp::uint32_field";
+                case kind::sfixed32: return "pp::sfixed32_field";
+                case kind::sfixed64: return "pp::sfixed64_field";
+                case kind::sint32: return "pp::sint32_field";
+                case kind::sint64: return "pp::sint64_field";
+                case kind::string:
+                    return s == string_type::view ? "pp::string_view_field" : s == string_type::pmr ? "pp::pmr_string_field" : "pp::string_field";
+                case kind::bytes:
+                    return s == string_type::view ? "pp::bytes_view_field" : s == string_type::pmr ? "pp::pmr_bytes_field" : "pp::bytes_field";
+                default: return "";
+            }
+        }
+
+        std::string coder_of(const desc::FieldDescriptorProto& f, desc::string_type s, const std::string& ns) const {
+            using desc::kind;
+            using desc::string_type;
+
+            switch(*f["type"_f]) {
+                case kind::double_: return "pp::float_coder<pp::floating<8>>";
+                case kind::float_: return "pp::float_coder<pp::floating<4>>";
+                case kind::int64: return "pp::varint_coder<pp::int64>";
+                case kind::uint64: return "pp::varint_coder<pp::uint64>";
+                case kind::int32: return "pp::varint_coder<pp::int32>";
+                case kind::fixed64: return "pp::integer_coder<pp::uint<8>>";
+                case kind::fixed32: return "pp::integer_coder<pp::uint<4>>";
+                case kind::bool_: return "pp::bool_coder";
+                case kind::uint32: return "pp::varint_coder<pp::uint32>";
+                case kind::sfixed32: return "pp::integer_coder<pp::sint<4>>";
+                case kind::sfixed64: return "pp::integer_coder<pp::sint<8>>";
+                case kind::sint32: return "pp::varint_coder<pp::sint32>";
+                case kind::sint64: return "pp::varint_coder<pp::sint64>";
+                case kind::string:
+                    return s == string_type::view ? "pp::string_view_coder" : s == string_type::pmr ? "pp::pmr_string_coder" : "pp::string_coder";
+                case kind::bytes:
+                    return s == string_type::view ? "pp::bytes_view_coder" : s == string_type::pmr ? "pp::pmr_bytes_coder" : "pp::bytes_coder";
+                case kind::enum_: return "pp::enum_coder<" + qualified(find(*f["type_name"_f]), ns) + ">";
+                case kind::message: return "pp::embedded_message_coder<" + qualified(find(*f["type_name"_f]), ns) + ">";
+                default: throw generate_error{"groups are not supported: " + str(*f["name"_f])};
+            }
+        }
+
+        static bool scalar(desc::kind k) {
+            return k != desc::kind::string && k != desc::kind::bytes && k != desc::kind::message && k != desc::kind::group;
+        }
+
+        /// the field type of field `f` in a file of syntax `syntax`, referred from namespace `ns`
+        std::string field_of(const desc::FieldDescriptorProto& f, bool proto2, const std::string& ns, std::set<std::string>& headers) const {
+            using desc::kind;
+
+            const auto k = *f["type"_f];
+            const auto& o = options_of(f);
+            const auto name = "\"" + str(*f["name"_f]) + "\", " + std::to_string(*f["number"_f]);
+            const bool repeated = f["label"_f] == desc::label::repeated;
+
+            if(k == kind::group) {
+                throw generate_error{"groups are not supported: " + str(*f["name"_f])};
+            }
+
+            if(k == kind::message) {
+                const auto& t = find(*f["type_name"_f]);
+
+                if(t.map_entry()) {
+                    const auto& entry = *t.message;
+                    const auto s = o["string_type"_f].value_or(desc::string_type::string);
+                    const auto m = o["map_type"_f].value_or(desc::map_type::ordered);
+
+                    headers.insert("protopuf/map.h");
+                    const char* alias = m == desc::map_type::hash ? "pp::hash_map_field" :
+                                        m == desc::map_type::sorted ? "pp::sorted_map_field" :
+                                        m == desc::map_type::pmr ? "pp::pmr_map_field" : "pp::map_field";
+
+                    return str(alias) + "<" + name + ", " + coder_of(entry["field"_f][0], s, ns) + ", " + coder_of(entry["field"_f][1], s, ns) + ">";
+                }
+
+                const auto attr = repeated ? ", pp::repeated" : "";
+                if(o["lazy"_f].value_or(false)) {
+                    headers.insert("protopuf/lazy.h");
+                    return "pp::lazy_message_field<" + name + ", " + qualified(t, ns) + attr + ">";
+                }
+
+                return "pp::message_field<" + name + ", " + qualified(t, ns) + attr + ">";
+            }
+
+            std::string res = k == kind::enum_ ?
+                "pp::enum_field<" + name + ", " + qualified(find(*f["type_name"_f]), ns) :
+                scalar_field(k, o["string_type"_f].value_or(desc::string_type::string)) + "<" + name;
+
+            if(repeated) {
+                const auto& fo = f["options"_f];
+                const bool packed = scalar(k) && (fo && fo->get<"packed">() ? *fo->get<"packed">() : !proto2);
+                res += packed ? ", pp::packed" : ", pp::repeated";
+            }
+
+            return res + ">";
+        }
+
+        /// message types which message `m` depends on, i.e. types of its fields and values of its map fields
+        std::vector<std::string> dependencies(const desc::DescriptorProto& m) const {
+            std::vector<std::string> res;
+            for(const auto& f : m["field"_f]) {
+                if(f["type"_f] != desc::kind::message) {
+                    continue;
+                }
+
+                const auto& t = find(*f["type_name"_f]);
+                if(t.map_entry()) {
+                    const auto& v = t.message->get<"field">()[1];
+                    if(v["type"_f] == desc::kind::message) {
+                        res.push_back(str(*v["type_name"_f]));
+                    }
+                } else {
+                    res.push_back(str(*f["type_name"_f]));
+                }
+            }
+
+            return res;
+        }
+
+        /// append full names of message types in file `file` to `order` in which every type follows its dependencies
+        void sort(const std::string& full, const desc::FileDescriptorProto& file, std::map<std::string, int>& state, std::vector<std::string>& order) const {
+            const auto& t = find(full);
+            if(t.file != &file || !t.message) {
+                return;
+            }
+
+            auto& s = state[full];
+            if(s == 2) {
+                return;
+            } else if(s == 1) {
+                throw generate_error{"message " + full.substr(1) + " is recursive, which cannot be represented by protopuf message type aliases"};
+            }
+
+            s = 1;
+            for(const auto& d : dependencies(*t.message)) {
+                sort(d, file, state, order);
+            }
+
+            s = 2;
+            if(!t.map_entry()) {
+                order.push_back(full);
+            }
+        }
+
+        std::string generate_message(const type_info& t, bool proto2, std::set<std::string>& headers) const {
+            const auto& m = *t.message;
+            std::vector<std::string> fields;
+            std::map<int32, std::size_t> oneofs;
+
+            for(const auto& f : m["field"_f]) {
+                auto field = field_of(f, proto2, t.ns, headers);
+
+                if(f["oneof_index"_f] && !f["proto3_optional"_f].value_or(false)) {
+                    auto i = *f["oneof_index"_f];
+                    auto it = oneofs.find(i);
+
+                    if(it == oneofs.end()) {
+                        oneofs[i] = fields.size();
+                        fields.push_back("pp::oneof_field<\"" + str(*m["oneof_decl"_f].at(i)["name"_f]) + "\", " + field + ">");
+                    } else {
+                        fields[it->second].insert(fields[it->second].size() - 1, ", " + field);
+                    }
+                } else {
+                    fields.push_back(field);
+                }
+            }
+
+            const auto& mo = m["options"_f];
+            const auto& po = mo && mo->get<"protopuf">() ? *mo->get<"protopuf">() : desc::PufMessageOptions{};
+            if(po["preserve_unknown"_f].value_or(false)) {
+                fields.push_back("pp::unknown_fields<>");
+            }
+
+            std::string res = "    using " + t.name + " = pp::message<";
+            for(std::size_t i = 0; i < fields.size(); ++i) {
+                res += (i == 0 ? "\n        " : ",\n        ") + fields[i];
+            }
+
+            return res + (fields.empty() ? ">;\n" : "\n    >;\n");
+        }
+
+        static std::string generate_enum(const std::string& name, const desc::EnumDescriptorProto& e) {
+            std::string res = "    enum class " + name + " : pp::int32 {\n";
+            for(const auto& v : e["value"_f]) {
+                res += "        " + str(*v["name"_f]) + " = " + std::to_string(v["number"_f].value_or(0)) + ",\n";
+            }
+
+            return res + "    };\n";
+        }
+
+        static std::string guard_of(std::string_view header) {
+            std::string res = "PROTOPUF_GENERATED_";
+            for(char c : header) {
+                res += std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : '_';
+            }
+
+            return res;
+        }
+
+        std::string generate_file(const desc::FileDescriptorProto& file) const {
+            const auto ns = namespace_of(file);
+            const auto header = proto_to_header(*file["name"_f]);
+            const bool proto2 = file["syntax"_f].value_or("proto2") == "proto2";
+
+            std::string body;
+            std::set<std::string> headers;
+
+            // enums first, then messages in declaration order, where every message follows its dependencies
+            std::vector<std::string> order;
+            std::map<std::string, int> state;
+            for(const auto& full : declared.at(&file)) {
+                sort(full, file, state, order);
+            }
+
+            const auto open = ns.empty() ? std::string() : "namespace " + ns + " {\n\n";
+            const auto close = ns.empty() ? std::string() : "}\n\n";
+
+            body += open;
+            for(const auto& full : declared.at(&file)) {
+                if(const auto& t = find(full); t.enumeration) {
+                    body += generate_enum(t.name, *t.enumeration) + "\n";
+                }
+            }
+
+            for(const auto& full : order) {
+                const auto& t = find(full);
+                body += generate_message(t, proto2, headers) + "\n";
+
+                const auto& mo = t.message->get<"options">();
+                if(mo && mo->get<"protopuf">() && mo->get<"protopuf">()->get<"compact">().value_or(false)) {
+                    // the specialization precedes any use of the message type
+                    body += close + "template <>\nstruct pp::compact_layout<" + (ns.empty() ? t.name : ns + "::" + t.name) + "> : std::true_type {};\n\n" + open;
+                }
+            }
+            body += close;
+
+            std::string res = "// Generated by protoc-gen-protopuf from " + str(*file["name"_f]) + ". DO NOT EDIT!\n\n";
+            res += "#ifndef " + guard_of(header) + "\n#define " + guard_of(header) + "\n\n";
+            res += "#include <protopuf/message.h>\n";
+            for(const auto& h : headers) {
+                res += "#include <" + h + ">\n";
+            }
+
+            bool first = true;
+            for(auto d : file["dependency"_f]) {
+                if(d == "protopuf/options.proto" || d.starts_with("google/protobuf/descriptor.proto")) {
+                    continue;
+                }
+
+                res += (first ? "\n#include \"" : "#include \"") + proto_to_header(d) + "\"\n";
+                first = false;
+            }
+
+            // collapse empty namespace blocks
+            if(!ns.empty()) {
+                for(auto i = body.find(open + close); i != std::string::npos; i = body.find(open + close)) {
+                    body.erase(i, open.size() + close.size());
+                }
+            }
+
+            res += "\n" + body;
+            res += "#endif // " + guard_of(header) + "\n";
+
+            return res;
+        }
+
+    public:
+        desc::CodeGeneratorResponse run(const desc::CodeGeneratorRequest& req) {
+            std::string_view params = req["parameter"_f].value_or("");
+            while(!params.empty()) {
+                auto p = params.substr(0, params.find(','));
+                params.remove_prefix(std::min(params.size(), p.size() + 1));
+
+                if(p.starts_with("namespace=")) {
+                    ns_option = str(p.substr(10));
+                    has_ns_option = true;
+                } else if(!p.empty()) {
+                    throw generate_error{"unknown option: " + str(p)};
+                }
+            }
+
+            for(const auto& file : req["proto_file"_f]) {
+                std::string scope = file["package"_f] ? "." + str(*file["package"_f]) : "";
+
+                declared[&file];
+                for(const auto& e : file["enum_type"_f]) {
+                    declare(scope + "." + str(*e["name"_f]), {str(*e["name"_f]), namespace_of(file), &file, nullptr, &e});
+                }
+
+                for(const auto& m : file["message_type"_f]) {
+                    collect(file, m, scope, "");
+                }
+            }
+
+            desc::CodeGeneratorResponse res;
+            res["supported_features"_f] = desc::proto3_optional;
+
+            for(auto name : req["file_to_generate"_f]) {
+                for(const auto& file : req["proto_file"_f]) {
+                    if(file["name"_f] == name) {
+                        res["file"_f].push_back(desc::GeneratedFile{proto_to_header(name), generate_file(file)});
+                    }
+                }
+            }
+
+            return res;
+        }
+    };
+}
+
+int main() {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    std::vector<std::byte> input;
+    std::byte buf[4096];
+    while(auto n = std::fread(buf, 1, sizeof buf, stdin)) {
+        input.insert(input.end(), buf, buf + n);
+    }
+
+    desc::CodeGeneratorResponse res;
+
+    auto req = message_coder<desc::CodeGeneratorRequest>::checked_decode(input);
+    if(!req) {
+        std::fprintf(stderr, "protoc-gen-protopuf: malformed request from protoc\n");
+        return 1;
+    }
+
+    try {
+        res = generator{}.run(req->first);
+    } catch(const generate_error& e) {
+        res = desc::CodeGeneratorResponse{};
+        res["error"_f] = e.what;
+    }
+
+    std::vector<std::byte> output(skipper<message_coder<desc::CodeGeneratorResponse>>::encode_skip(res));
+    message_coder<desc::CodeGeneratorResponse>::encode(res, output);
+
+    return std::fwrite(output.data(), 1, output.size(), stdout) == output.size() ? 0 : 1;
+}
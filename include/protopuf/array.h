@@ -17,6 +17,9 @@
 
 #include <ranges>
 #include <vector>
+#include <string>
+#include <bit>
+#include <cstring>
 #include "coder.h"
 #include "varint.h"
 #include "skip.h"
@@ -34,6 +37,127 @@ namespace pp {
     template <typename T>
     concept insertable_sized_range = insertable_range<T> && std::ranges::sized_range<T>;
 
+    /// @brief Checks whether the encoded form of values of coder `C` is their in-memory representation (up to byte order),
+    /// so that a contiguous sequence of them can be encoded/decoded by a single `memcpy`
+    /// followed by a bulk @ref byteswap_elements on big-endian targets.
+    ///
+    /// It holds for fixed-length integers (i.e. characters of strings and bytes) and floating points.
+    template <typename C>
+    constexpr bool is_bulk_coder = false;
+
+    template <std::integral T>
+    constexpr bool is_bulk_coder<integer_coder<T>> = true;
+
+    template <std::floating_point T>
+    constexpr bool is_bulk_coder<float_coder<T>> = true;
+
+    /// A contiguous range `R` of values of a @ref is_bulk_coder coder `C`
+    template <typename R, typename C>
+    concept bulk_range = is_bulk_coder<C> && std::ranges::contiguous_range<R> &&
+        std::same_as<std::ranges::range_value_t<R>, typename C::value_type>;
+
+    /// A @ref bulk_range which can be resized, so that decoded values can be copied into it
+    template <typename R, typename C>
+    concept resizable_bulk_range = bulk_range<R, C> && std::ranges::sized_range<R> && requires(R r, std::size_t n) {
+        r.resize(n);
+    };
+
+    /// Get the total encoded length of elements of `con` via `C`, without any length prefix
+    template <coder C, std::ranges::sized_range R>
+    constexpr std::size_t elements_encode_skip(const R& con) {
+        if constexpr (bulk_range<R, C>) {
+            return std::ranges::size(con) * sizeof(typename C::value_type);
+        } else {
+            std::size_t n = 0;
+
+            for(const auto &i : con) {
+                n += skipper<C>::encode_skip(i);
+            }
+
+            return n;
+        }
+    }
+
+    /// Encode elements of `con` via `C` back to back into `b`, without any length prefix
+    template <coder C, std::ranges::sized_range R>
+    constexpr bytes encode_elements(const R& con, bytes b) {
+        if constexpr (bulk_range<R, C>) {
+            if (!std::is_constant_evaluated()) {
+                auto n = std::ranges::size(con) * sizeof(typename C::value_type);
+                if (n > 0) {
+                    std::memcpy(b.data(), std::ranges::data(con), n);
+
+                    if constexpr (needs_byteswap) {
+                        byteswap_elements<sizeof(typename C::value_type)>(b.first(n));
+                    }
+                }
+
+                return b.subspan(n);
+            }
+        }
+
+        for(const auto& i : con) {
+            b = C::encode(i, b);
+        }
+
+        return b;
+    }
+
+    /// Decode all elements from `b` via `C` and append them to `con`
+    template <coder C, typename R>
+    constexpr void decode_elements(R& con, bytes b) {
+        if constexpr (resizable_bulk_range<R, C>) {
+            if (!std::is_constant_evaluated()) {
+                auto origin = std::ranges::size(con);
+                auto n = b.size() / sizeof(typename C::value_type);
+
+                con.resize(origin + n);
+                if (n > 0) {
+                    std::memcpy(std::ranges::data(con) + origin, b.data(), n * sizeof(typename C::value_type));
+
+                    if constexpr (needs_byteswap) {
+                        byteswap_elements<sizeof(typename C::value_type)>(
+                            std::as_writable_bytes(std::span(std::ranges::data(con) + origin, n)));
+                    }
+                }
+
+                return;
+            }
+        }
+
+        if constexpr (is_varint_coder<C> && std::ranges::sized_range<R> && requires(R r, std::size_t n) { r.reserve(n); }) {
+            con.reserve(std::ranges::size(con) + varint_count(b));
+        }
+
+        while(!b.empty()) {
+            std::tie(*std::inserter(con, con.end()), b) = C::decode(b);
+        }
+    }
+
+    /// Same as @ref decode_elements, but reports malformed bytes as @ref decode_error, returns the remaining (empty) bytes otherwise
+    template <coder C, typename R>
+    constexpr checked_result<bytes> checked_decode_elements(R& con, bytes b) {
+        if constexpr (is_bulk_coder<C>) {
+            if(b.size() % sizeof(typename C::value_type) != 0) {
+                return decode_error::truncated;
+            }
+
+            decode_elements<C>(con, b);
+            return b.subspan(b.size());
+        } else {
+            while(!b.empty()) {
+                auto r = C::checked_decode(b);
+                if(!r) {
+                    return r.error();
+                }
+
+                std::tie(*std::inserter(con, con.end()), b) = std::move(*r);
+            }
+
+            return b;
+        }
+    }
+
     /// @brief A @ref coder for range types, i.e. `std::vector<T>`.
     ///
     /// @param C the @ref coder for the element type of the range types, i.e. `C = integer_coder<int>` for `R = std::vector<int>`
@@ -45,32 +169,86 @@ namespace pp {
         array_coder() = delete;
 
         static constexpr bytes encode(const R& con, bytes b) {
-            uint<8> n = 0;
+            b = varint_coder<uint<8>>::encode(elements_encode_skip<C>(con), b);
 
-            for(const auto &i : con) {
-                n += skipper<C>::encode_skip(i);
-            }
+            return encode_elements<C>(con, b);
+        }
+
+        /// Encode `con` using its payload size recorded by `skipper<array_coder>::encode_skip(con, cache)`
+        static constexpr bytes encode(const R& con, bytes b, size_cache& cache) {
+            b = varint_coder<uint<8>>::encode(cache.next(), b);
 
-            b = varint_coder<uint<8>>::encode(n, b);
+            if constexpr (is_bulk_coder<C>) {
+                return encode_elements<C>(con, b);
+            } else {
+                for(const auto& i : con) {
+                    b = cached_encode<C>(i, b, cache);
+                }
 
-            for(const auto& i : con) {
-                b = C::encode(i, b);
+                return b;
             }
+        }
 
-            return b;
+        /// Decode a range from `b`, which allocates from `mr` if the range is allocator-aware and `mr` is not null
+        static constexpr decode_result<R> decode(bytes b, std::pmr::memory_resource* mr = nullptr) {
+            uint<8> len = 0;
+            std::tie(len, b) = varint_coder<uint<8>>::decode(b);
+            R con = make_with_resource<R>(mr);
+
+            decode_elements<C>(con, b.subspan(0, len));
+
+            return {std::move(con), b.subspan(len)};
         }
 
-        static constexpr decode_result<R> decode(bytes b) {
+        /// Decode a range from `b` into `con` in place, reusing the capacity of `con`
+        static constexpr bytes decode_reuse(R& con, bytes b, std::pmr::memory_resource* = nullptr) {
             uint<8> len = 0;
             std::tie(len, b) = varint_coder<uint<8>>::decode(b);
-            R con;
 
-            auto origin_b = b;
-            while(begin_diff(b, origin_b) < len) {
-                std::tie(*std::inserter(con, con.end()), b) = C::decode(b);
+            con.clear();
+            decode_elements<C>(con, b.subspan(0, len));
+
+            return b.subspan(len);
+        }
+
+        /// Same as `decode_reuse(con, b)`, but never reads past the end of `b`
+        static constexpr checked_result<bytes> checked_decode_reuse(R& con, bytes b, std::pmr::memory_resource* = nullptr) {
+            auto lr = varint_coder<uint<8>>::checked_decode(b);
+            if(!lr) {
+                return lr.error();
             }
 
-            return {con, b};
+            auto [len, rest] = *lr;
+            if(len > rest.size()) {
+                return decode_error::length_overflow;
+            }
+
+            con.clear();
+            if(auto r = checked_decode_elements<C>(con, rest.subspan(0, len)); !r) {
+                return r.error();
+            }
+
+            return rest.subspan(len);
+        }
+
+        static constexpr checked_decode_result<R> checked_decode(bytes b, std::pmr::memory_resource* mr = nullptr) {
+            auto lr = varint_coder<uint<8>>::checked_decode(b);
+            if(!lr) {
+                return lr.error();
+            }
+
+            auto [len, rest] = *lr;
+            if(len > rest.size()) {
+                return decode_error::length_overflow;
+            }
+
+            R con = make_with_resource<R>(mr);
+
+            if(auto r = checked_decode_elements<C>(con, rest.subspan(0, len)); !r) {
+                return r.error();
+            }
+
+            return decode_result<R>{std::move(con), rest.subspan(len)};
         }
     };
 
@@ -80,12 +258,27 @@ namespace pp {
         using value_type = R;
 
         static constexpr std::size_t encode_skip(const R &con) {
+            uint<8> n = elements_encode_skip<C>(con);
+
+            n += skipper<varint_coder<uint<8>>>::encode_skip(n);
+
+            return n;
+        }
+
+        /// Same as `encode_skip(con)`, but records the payload size of `con` and its elements into `cache`
+        static constexpr std::size_t encode_skip(const R &con, size_cache& cache) {
+            auto slot = cache.reserve();
             uint<8> n = 0;
 
-            for(const auto &i : con) {
-                n += skipper<C>::encode_skip(i);
+            if constexpr (is_bulk_coder<C>) {
+                n = elements_encode_skip<C>(con);
+            } else {
+                for(const auto &i : con) {
+                    n += cached_encode_skip<C>(i, cache);
+                }
             }
 
+            cache.record(slot, n);
             n += skipper<varint_coder<uint<8>>>::encode_skip(n);
 
             return n;
@@ -97,6 +290,20 @@ namespace pp {
 
             return b.subspan(n);
         }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            auto lr = varint_coder<uint<8>>::checked_decode(b);
+            if(!lr) {
+                return lr.error();
+            }
+
+            auto [n, rest] = *lr;
+            if(n > rest.size()) {
+                return decode_error::length_overflow;
+            }
+
+            return rest.subspan(n);
+        }
     };
 
     /// Type alias of @ref coder for `std::basic_string<T>`
@@ -109,6 +316,12 @@ namespace pp {
     /// Type alias of @ref coder for `std::vector<uint<1>>`
     using bytes_coder = array_coder<integer_coder<uint<1>>>;
 
+    /// Type alias of @ref coder for `std::pmr::string`, which allocates from the memory resource passed to `decode`
+    using pmr_string_coder = array_coder<integer_coder<char>, std::pmr::string>;
+
+    /// Type alias of @ref coder for `std::pmr::vector<uint<1>>`, which allocates from the memory resource passed to `decode`
+    using pmr_bytes_coder = array_coder<integer_coder<uint<1>>, std::pmr::vector<uint<1>>>;
+
 }
 
 #endif //PROTOPUF_ARRAY_H
@@ -0,0 +1,185 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_BATCH_H
+#define PROTOPUF_BATCH_H
+
+#include <ranges>
+#include <vector>
+#include "message.h"
+
+namespace pp {
+
+    /// Checks whether `R` is a range of messages of type `T`, which can be traversed more than once
+    template <typename R, typename T>
+    concept message_range = std::ranges::forward_range<R> && std::same_as<std::ranges::range_value_t<R>, T>;
+
+    /// @brief A coder for a batch of messages of type `T` as a sequence of length-prefixed records,
+    /// where every record is encoded as an embedded message, i.e. a varint length followed by the message.
+    ///
+    /// All messages of a batch share one sizing pass through a @ref size_cache
+    /// and are written into one output range reserved at once, instead of being sized and grown per message.
+    template <message_c T>
+    struct batch_coder {
+        using record_coder = embedded_message_coder<T>;
+
+        batch_coder() = delete;
+
+        /// @brief Get the encoded length of all messages in `r`, the sizing pass of the batch,
+        /// where sizes of messages and their nested values are recorded into `cache`
+        template <message_range<T> R>
+        static constexpr std::size_t encode_skip(const R& r, size_cache& cache) {
+            std::size_t n = 0;
+            for(const auto& msg : r) {
+                n += skipper<record_coder>::encode_skip(msg, cache);
+            }
+
+            return n;
+        }
+
+        /// Get the encoded length of all messages in `r`
+        template <message_range<T> R>
+        static constexpr std::size_t encode_skip(const R& r) {
+            std::size_t n = 0;
+            for(const auto& msg : r) {
+                n += skipper<record_coder>::encode_skip(msg);
+            }
+
+            return n;
+        }
+
+        /// Encode all messages in `r` into `b` using sizes recorded by `encode_skip(r, cache)`, returns the remaining bytes
+        template <message_range<T> R>
+        static constexpr bytes encode(const R& r, bytes b, size_cache& cache) {
+            for(const auto& msg : r) {
+                b = record_coder::encode(msg, b, cache);
+            }
+
+            return b;
+        }
+
+        /// Encode all messages in `r` into `b`, which must be large enough (ref to `encode_skip(r)`), returns the remaining bytes
+        template <message_range<T> R>
+        static constexpr bytes encode(const R& r, bytes b) {
+            size_cache cache;
+            encode_skip(r, cache);
+
+            return encode(r, b, cache);
+        }
+
+        /// Encode all messages in `r` into the output @ref sink `s` with one reservation, returns the number of bytes written
+        template <message_range<T> R, sink S>
+        static constexpr std::size_t encode(const R& r, S& s) {
+            size_cache cache;
+            auto n = encode_skip(r, cache);
+
+            encode(r, s.reserve(n), cache);
+            s.commit(n);
+
+            return n;
+        }
+
+        /// Encode all messages in `r` into a new vector of exactly the encoded length
+        template <message_range<T> R>
+        static std::vector<std::byte> encode(const R& r) {
+            size_cache cache;
+            std::vector<std::byte> res(encode_skip(r, cache));
+
+            encode(r, res, cache);
+
+            return res;
+        }
+
+        /// Get the number of records in `b` by skipping over their lengths, which are not bounds-checked
+        static constexpr std::size_t count(bytes b) {
+            std::size_t n = 0;
+            while(b.end() > b.begin()) {
+                b = skipper<record_coder>::decode_skip(b);
+                ++n;
+            }
+
+            return n;
+        }
+
+        /// @brief Decode all records from `b` and append messages into `out`, returns the remaining bytes,
+        /// where values allocate from `mr` if not null.
+        ///
+        /// Records are counted beforehand, so that `out` is grown once.
+        template <typename C>
+        static constexpr bytes decode(C& out, bytes b, std::pmr::memory_resource* mr = nullptr) {
+            if constexpr (requires(std::size_t n) { out.reserve(n); }) {
+                out.reserve(std::ranges::size(out) + count(b));
+            }
+
+            while(b.end() > b.begin()) {
+                auto [v, rest] = record_coder::decode(b, mr);
+                out.push_back(std::move(v));
+                b = rest;
+            }
+
+            return b;
+        }
+
+        /// Decode all records from `b` into a vector of messages
+        static std::vector<T> decode(bytes b, std::pmr::memory_resource* mr = nullptr) {
+            std::vector<T> res;
+            decode(res, b, mr);
+
+            return res;
+        }
+
+        /// @brief Decode all records from `b` into `out`, reusing its existing messages in order (ref to `message_coder<T>::decode_reuse`),
+        /// returns the remaining bytes, afterwards `out` holds exactly the decoded messages
+        static constexpr bytes decode_reuse(std::vector<T>& out, bytes b, std::pmr::memory_resource* mr = nullptr) {
+            std::size_t i = 0;
+            for(; b.end() > b.begin() && i < out.size(); ++i) {
+                b = record_coder::decode_reuse(out[i], b, mr);
+            }
+
+            out.resize(i);
+            return decode(out, b, mr);
+        }
+
+        /// @brief Same as `decode(out, b, mr)`, but never reads past the end of `b`,
+        /// messages decoded before an error are kept in `out`
+        template <typename C>
+        static constexpr checked_result<bytes> checked_decode(C& out, bytes b, std::pmr::memory_resource* mr = nullptr) {
+            while(b.end() > b.begin()) {
+                auto r = record_coder::checked_decode(b, mr);
+                if(!r) {
+                    return r.error();
+                }
+
+                auto &[v, rest] = *r;
+                out.push_back(std::move(v));
+                b = rest;
+            }
+
+            return b;
+        }
+
+        /// Same as `decode(b, mr)`, but never reads past the end of `b`
+        static checked_result<std::vector<T>> checked_decode(bytes b, std::pmr::memory_resource* mr = nullptr) {
+            std::vector<T> res;
+            if(auto r = checked_decode(res, b, mr); !r) {
+                return r.error();
+            }
+
+            return res;
+        }
+    };
+
+}
+
+#endif //PROTOPUF_BATCH_H
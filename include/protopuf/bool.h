@@ -34,6 +34,10 @@ namespace pp {
         static constexpr decode_result<bool> decode(bytes b) {
             return integer_coder<uint<1>>::decode(b);
         }
+
+        static constexpr checked_decode_result<bool> checked_decode(bytes b) {
+            return integer_coder<uint<1>>::checked_decode(b);
+        }
     };
 
 }
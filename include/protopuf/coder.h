@@ -16,6 +16,9 @@
 #define PROTOPUF_CODER_H
 
 #include <utility>
+#include <variant>
+#include <memory>
+#include <memory_resource>
 #include "byte.h"
 
 namespace pp {
@@ -59,6 +62,174 @@ namespace pp {
     template<typename T>
     concept coder = encoder<T> && decoder<T>;
 
+    /// Errors reported by checked decoding while the input bytes are malformed
+    enum class decode_error {
+        /// the input bytes end before the value is complete
+        truncated,
+        /// a varint has more bytes than any 64-bit integer can be encoded into
+        overlong_varint,
+        /// a field key contains a wire type which is not supported
+        bad_wire_type,
+        /// a length prefix exceeds the remaining input bytes
+        length_overflow,
+        /// a field key contains the reserved field number 0
+        invalid_field_number
+    };
+
+    /// @brief An `expected`-like type which holds either a value of type `T` or a @ref decode_error.
+    template<typename T>
+    class checked_result {
+        std::variant<T, decode_error> data;
+
+        template<typename>
+        friend class checked_result;
+
+    public:
+        using value_type = T;
+
+        /// Construct a result holding the value `v`
+        constexpr checked_result(const T& v) : data(std::in_place_index<0>, v) {}
+        constexpr checked_result(T&& v) : data(std::in_place_index<0>, std::move(v)) {}
+
+        /// Construct a result holding the error `e`
+        constexpr checked_result(decode_error e) : data(std::in_place_index<1>, e) {}
+
+        /// Convert from a result holding a value of type `U`, where `U` is convertible to `T`
+        template<typename U> requires (!std::same_as<T, U> && std::convertible_to<U, T>)
+        constexpr checked_result(checked_result<U>&& other) : data(other.has_value() ?
+            std::variant<T, decode_error>(std::in_place_index<0>, std::move(*other)) :
+            std::variant<T, decode_error>(std::in_place_index<1>, other.error())) {}
+
+        /// Checks whether the result holds a value
+        constexpr bool has_value() const {
+            return data.index() == 0;
+        }
+
+        /// Same as @ref has_value
+        constexpr explicit operator bool() const {
+            return has_value();
+        }
+
+        /// Get the held value, the behavior is undefined if the result holds an error
+        constexpr T& operator*() & {
+            return *std::get_if<0>(&data);
+        }
+
+        constexpr const T& operator*() const& {
+            return *std::get_if<0>(&data);
+        }
+
+        constexpr T&& operator*() && {
+            return std::move(*std::get_if<0>(&data));
+        }
+
+        constexpr T* operator->() {
+            return std::get_if<0>(&data);
+        }
+
+        constexpr const T* operator->() const {
+            return std::get_if<0>(&data);
+        }
+
+        /// Get the held error, the behavior is undefined if the result holds a value
+        constexpr decode_error error() const {
+            return *std::get_if<1>(&data);
+        }
+    };
+
+    /// @brief A @ref checked_result type which `checked_decode` returns, holding a @ref decode_result or a @ref decode_error
+    template<typename T>
+    using checked_decode_result = checked_result<decode_result<T>>;
+
+    /// @brief Describes a type with static member function `checked_decode`, which deserializes some `bytes`
+    /// to an object like @ref decoder does, but never reads past the end of the bytes.
+    ///
+    /// Static member function `checked_decode`:
+    /// @param s the bytes which the object is decoded from (source bytes).
+    /// @returns the @ref checked_decode_result holding the @ref decode_result if the bytes are well-formed,
+    /// or the @ref decode_error otherwise.
+    template<typename T>
+    concept checked_decoder = requires(bytes s) {
+        typename T::value_type;
+        { T::checked_decode(s) } -> std::same_as<checked_decode_result<typename T::value_type>>;
+    };
+
+    /// @brief Describes a @ref decoder which can allocate decoded objects from a `std::pmr::memory_resource`, i.e. an arena,
+    /// as it has static member function `decode(s, mr)`, where a null `mr` means the default construction of containers.
+    template<typename T>
+    concept resource_decoder = decoder<T> && requires(bytes s, std::pmr::memory_resource* mr) {
+        { T::decode(s, mr) } -> std::same_as<decode_result<typename T::value_type>>;
+        { T::checked_decode(s, mr) } -> std::same_as<checked_decode_result<typename T::value_type>>;
+    };
+
+    /// @brief Construct an empty object of type `T` allocating from `mr` by uses-allocator construction,
+    /// or by default construction if `mr` is null.
+    ///
+    /// Types which are not allocator-aware, i.e. containers with `std::allocator`, are always default constructed.
+    template<typename T>
+    constexpr T make_with_resource(std::pmr::memory_resource* mr) {
+        if (mr != nullptr) {
+            if constexpr (std::constructible_from<T, std::allocator_arg_t, std::pmr::polymorphic_allocator<>>) {
+                return T(std::allocator_arg, std::pmr::polymorphic_allocator<>(mr));
+            } else {
+                return std::make_obj_using_allocator<T>(std::pmr::polymorphic_allocator<>(mr));
+            }
+        }
+
+        return T{};
+    }
+
+    /// Decode via `C`, allocating from `mr` if `C` is a @ref resource_decoder
+    template<decoder C>
+    constexpr decode_result<typename C::value_type> resource_decode(bytes s, std::pmr::memory_resource* mr) {
+        if constexpr (resource_decoder<C>) {
+            return C::decode(s, mr);
+        } else {
+            return C::decode(s);
+        }
+    }
+
+    /// @brief Decode via `C` into an existing object `v`, returns the remaining bytes.
+    ///
+    /// If `C` has static member function `decode_reuse(v, s, mr)`, the storage of `v` is reused, i.e. capacity of containers,
+    /// otherwise `v` is assigned by the decoded object.
+    template<decoder C>
+    constexpr bytes reuse_decode(typename C::value_type& v, bytes s, std::pmr::memory_resource* mr = nullptr) {
+        if constexpr (requires { { C::decode_reuse(v, s, mr) } -> std::same_as<bytes>; }) {
+            return C::decode_reuse(v, s, mr);
+        } else {
+            auto r = resource_decode<C>(s, mr);
+            v = std::move(r.first);
+            return r.second;
+        }
+    }
+
+    /// Same as @ref resource_decode, but via `checked_decode`
+    template<checked_decoder C>
+    constexpr checked_decode_result<typename C::value_type> resource_checked_decode(bytes s, std::pmr::memory_resource* mr) {
+        if constexpr (resource_decoder<C>) {
+            return C::checked_decode(s, mr);
+        } else {
+            return C::checked_decode(s);
+        }
+    }
+
+    /// Same as @ref reuse_decode, but via `checked_decode_reuse` or `checked_decode`, `v` is unspecified if decoding fails
+    template<checked_decoder C>
+    constexpr checked_result<bytes> reuse_checked_decode(typename C::value_type& v, bytes s, std::pmr::memory_resource* mr = nullptr) {
+        if constexpr (requires { { C::checked_decode_reuse(v, s, mr) } -> std::same_as<checked_result<bytes>>; }) {
+            return C::checked_decode_reuse(v, s, mr);
+        } else {
+            auto r = resource_checked_decode<C>(s, mr);
+            if(!r) {
+                return r.error();
+            }
+
+            v = std::move(r->first);
+            return r->second;
+        }
+    }
+
 }
 
 #endif //PROTOPUF_CODER_H
@@ -0,0 +1,391 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_COMPACT_H
+#define PROTOPUF_COMPACT_H
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <optional>
+#include <type_traits>
+#include "field.h"
+
+namespace pp {
+
+    /// @brief An extension point to store fields of message type `T` in the compact layout, which is disabled by default.
+    ///
+    /// In the compact layout, presence of all @ref compact_storable fields (i.e. integers, floating points, booleans and enums)
+    /// is tracked in one packed bitset per message, and their values are stored densely, ordered by alignment to minimize padding,
+    /// instead of one `std::optional` (with its own presence flag and padding) per field.
+    /// These fields are accessed through @ref compact_field_ref, which behaves like the field itself, ref to `message::get`.
+    ///
+    /// Specialize `compact_layout<T>` as `std::true_type` to store message type `T` compactly,
+    /// or partially specialize `compact_layout<T, void>` for all message types.
+    /// Specializations must precede any use of the message types.
+    template <typename T, typename = void>
+    struct compact_layout : std::false_type {};
+
+    /// Checks whether field `F` is stored in the compact layout: a singular field of a trivially copyable type
+    template <field_c F>
+    constexpr bool compact_storable = [] {
+        if constexpr (is_oneof<F>) {
+            return false;
+        } else {
+            using V = typename F::coder::value_type;
+            return F::attr == singular && std::is_trivially_copyable_v<V> && std::is_default_constructible_v<V>;
+        }
+    }();
+
+    /// Values of types `V...` stored back to back in order
+    template <typename... V>
+    struct dense_values {};
+
+    template <typename V, typename... R>
+    struct dense_values<V, R...> {
+        V head{};
+        [[no_unique_address]] dense_values<R...> tail;
+
+        template <std::size_t I>
+        constexpr auto& get() {
+            if constexpr (I == 0) {
+                return head;
+            } else {
+                return tail.template get<I - 1>();
+            }
+        }
+
+        template <std::size_t I>
+        constexpr const auto& get() const {
+            if constexpr (I == 0) {
+                return head;
+            } else {
+                return tail.template get<I - 1>();
+            }
+        }
+    };
+
+    /// @brief Storage of optional values of types `V...` in the compact layout, ref to @ref compact_layout
+    ///
+    /// Values are placed in descending order of alignment, followed by the presence bitset (one bit per value).
+    template <typename... V>
+    class compact_storage {
+        static constexpr std::size_t count = sizeof...(V);
+
+        /// indices of values placed in order
+        static constexpr std::array<std::size_t, count> order = [] {
+            std::array<std::size_t, count> res{}, align{alignof(V)...};
+            std::iota(res.begin(), res.end(), 0);
+            std::sort(res.begin(), res.end(), [&align](std::size_t a, std::size_t b) {
+                return align[a] > align[b] || (align[a] == align[b] && a < b);
+            });
+
+            return res;
+        }();
+
+        /// places of values by index
+        static constexpr std::array<std::size_t, count> place = [] {
+            std::array<std::size_t, count> res{};
+            for(std::size_t i = 0; i < count; ++i) {
+                res[order[i]] = i;
+            }
+
+            return res;
+        }();
+
+        using presence_type = std::array<uint<1>, (count + 7) / 8>;
+
+        template <std::size_t... I>
+        static auto values_of(std::index_sequence<I...>) -> dense_values<type_get<order[I], V...>..., presence_type>;
+
+        decltype(values_of(std::index_sequence_for<V...>{})) values;
+
+        constexpr presence_type& presence() {
+            return values.template get<count>();
+        }
+
+        constexpr const presence_type& presence() const {
+            return values.template get<count>();
+        }
+
+    public:
+        /// get the `I`-th value, which is meaningful only if it is present
+        template <std::size_t I>
+        constexpr auto& get() {
+            return values.template get<place[I]>();
+        }
+
+        template <std::size_t I>
+        constexpr const auto& get() const {
+            return values.template get<place[I]>();
+        }
+
+        /// Checks whether the `i`-th value is present
+        constexpr bool test(std::size_t i) const {
+            return (presence()[i / 8] >> (i % 8)) & 1u;
+        }
+
+        /// Mark the `i`-th value as present
+        constexpr void set(std::size_t i) {
+            presence()[i / 8] |= uint<1>(1u << (i % 8));
+        }
+
+        /// Mark the `i`-th value as absent
+        constexpr void reset(std::size_t i) {
+            presence()[i / 8] &= uint<1>(~(1u << (i % 8)));
+        }
+    };
+
+    template <field_c F, typename S, std::size_t I>
+    class compact_field_ref;
+
+    /// Checks whether the type is a @ref compact_field_ref type
+    template <typename>
+    constexpr bool is_compact_field_ref = false;
+
+    template <field_c F, typename S, std::size_t I>
+    constexpr bool is_compact_field_ref<compact_field_ref<F, S, I>> = true;
+
+    /// @brief A reference to field `F` stored as the `I`-th value of @ref compact_storage `S` (maybe const-qualified),
+    /// which provides the same interface as the field (a `std::optional`), i.e. `has_value`, `*`, `reset` and assignments.
+    ///
+    /// It is returned by value from `message::get` of messages in the compact layout, ref to @ref compact_layout,
+    /// and assignments write through to the referred value instead of rebinding the reference.
+    template <field_c F, typename S, std::size_t I>
+    class compact_field_ref {
+        S* storage;
+
+    public:
+        /// name of the field
+        static constexpr basic_fixed_string name = F::name;
+
+        /// type of name of the field
+        using name_type = typename F::name_type;
+
+        /// the field number
+        static constexpr uint<4> number = F::number;
+
+        /// key of the field, ref to @ref field::key
+        static constexpr uint<4> key = F::key;
+
+        /// key of each element of the field, ref to @ref field::element_key
+        static constexpr uint<4> element_key = F::element_key;
+
+        /// @ref coder of the field
+        using coder = typename F::coder;
+
+        /// attribute of the field, which is always @ref singular
+        static constexpr attribute attr = F::attr;
+
+        /// the underlying type which the field is derived from
+        using base_type = typename F::base_type;
+
+        /// the referred field type
+        using field_type = F;
+
+        using value_type = typename coder::value_type;
+
+        constexpr explicit compact_field_ref(S& storage) : storage(&storage) {}
+
+        constexpr compact_field_ref(const compact_field_ref&) = default;
+
+        /// Checks whether the field contains a value
+        constexpr bool has_value() const {
+            return storage->test(I);
+        }
+
+        constexpr explicit operator bool() const {
+            return has_value();
+        }
+
+        /// get the contained value, the field must contain a value
+        constexpr auto& operator*() const {
+            return storage->template get<I>();
+        }
+
+        constexpr auto* operator->() const {
+            return &**this;
+        }
+
+        /// get the contained value, throws `std::bad_optional_access` if the field is empty
+        constexpr auto& value() const {
+            if(!has_value()) {
+                throw std::bad_optional_access();
+            }
+
+            return **this;
+        }
+
+        /// get the contained value, or `v` if the field is empty
+        template <typename U>
+        constexpr value_type value_or(U&& v) const {
+            return has_value() ? **this : static_cast<value_type>(std::forward<U>(v));
+        }
+
+        /// get the field as a `std::optional`
+        constexpr operator std::optional<value_type>() const {
+            return has_value() ? std::optional<value_type>(**this) : std::nullopt;
+        }
+
+        /// get the field as its underlying object, which is the reference itself, ref to @ref field::cast_to_base
+        constexpr compact_field_ref cast_to_base() const {
+            return *this;
+        }
+
+        /// Empty the field
+        constexpr void reset() const requires (!std::is_const_v<S>) {
+            storage->reset(I);
+        }
+
+        /// Set a value constructed from `args` into the field
+        template <typename... Args>
+        constexpr value_type& emplace(Args&&... args) const requires (!std::is_const_v<S>) {
+            auto& v = storage->template get<I>();
+            v = value_type(std::forward<Args>(args)...);
+            storage->set(I);
+
+            return v;
+        }
+
+        constexpr const compact_field_ref& operator=(const compact_field_ref& other) const requires (!std::is_const_v<S>) {
+            return assign(other);
+        }
+
+        template <field_c G, typename T, std::size_t J>
+        constexpr const compact_field_ref& operator=(const compact_field_ref<G, T, J>& other) const requires (!std::is_const_v<S>) {
+            return assign(other);
+        }
+
+        constexpr const compact_field_ref& operator=(const std::optional<value_type>& other) const requires (!std::is_const_v<S>) {
+            return assign(other);
+        }
+
+        constexpr const compact_field_ref& operator=(std::nullopt_t) const requires (!std::is_const_v<S>) {
+            reset();
+            return *this;
+        }
+
+        template <typename U>
+            requires (!std::is_const_v<S> && !is_compact_field_ref<std::remove_cvref_t<U>> &&
+                      !std::derived_from<std::remove_cvref_t<U>, std::optional<value_type>> &&
+                      !std::same_as<std::remove_cvref_t<U>, std::nullopt_t> && std::constructible_from<value_type, U&&>)
+        constexpr const compact_field_ref& operator=(U&& v) const {
+            emplace(std::forward<U>(v));
+            return *this;
+        }
+
+        template <field_c G, typename T, std::size_t J>
+        constexpr bool operator==(const compact_field_ref<G, T, J>& other) const {
+            return has_value() == other.has_value() && (!has_value() || **this == *other);
+        }
+
+        constexpr bool operator==(const std::optional<value_type>& other) const {
+            return has_value() == other.has_value() && (!has_value() || **this == *other);
+        }
+
+        constexpr bool operator==(std::nullopt_t) const {
+            return !has_value();
+        }
+
+        template <typename U>
+            requires (!is_compact_field_ref<U> && !std::derived_from<U, std::optional<value_type>> &&
+                      !std::same_as<U, std::nullopt_t> && std::equality_comparable_with<value_type, U>)
+        constexpr bool operator==(const U& v) const {
+            if constexpr (std::integral<value_type> && std::integral<U>) {
+                // the usual arithmetic conversions made explicit, so that it compares as `std::optional` does
+                // without -Wsign-compare warnings
+                using C = std::common_type_t<value_type, U>;
+                return has_value() && static_cast<C>(**this) == static_cast<C>(v);
+            } else {
+                return has_value() && **this == v;
+            }
+        }
+
+    private:
+        template <typename O>
+        constexpr const compact_field_ref& assign(const O& other) const {
+            if(other.has_value()) {
+                emplace(*other);
+            } else {
+                reset();
+            }
+
+            return *this;
+        }
+    };
+
+    template <field_c F, typename S, std::size_t I>
+    constexpr bool is_field<compact_field_ref<F, S, I>> = true;
+
+    /// @brief Storage of field `F` as a base of a message: the field itself,
+    /// or an empty placeholder if it is stored in @ref compact_storage of the message
+    template <bool Compact, field_c F>
+    struct field_slot_impl {
+        using type = F;
+    };
+
+    /// An empty placeholder of field `F` stored in @ref compact_storage, which ignores values it is constructed from
+    template <field_c F>
+    struct compact_slot {
+        constexpr compact_slot() = default;
+
+        template <typename U>
+        constexpr explicit compact_slot(U&&) {}
+    };
+
+    template <field_c F> requires compact_storable<F>
+    struct field_slot_impl<true, F> {
+        using type = compact_slot<F>;
+    };
+
+    template <bool Compact, field_c F>
+    using field_slot = typename field_slot_impl<Compact, F>::type;
+
+    /// An empty placeholder of @ref compact_storage, for messages without any field stored compactly
+    struct no_compact_storage {};
+
+    template <typename S, field_c G, bool = compact_storable<G>>
+    struct compact_storage_append {
+        using type = S;
+    };
+
+    template <typename... V, field_c G>
+    struct compact_storage_append<compact_storage<V...>, G, true> {
+        using type = compact_storage<V..., typename G::coder::value_type>;
+    };
+
+    template <typename S, field_c... F>
+    struct compact_storage_of_impl {
+        using type = S;
+    };
+
+    template <typename S, field_c G, field_c... F>
+    struct compact_storage_of_impl<S, G, F...> : compact_storage_of_impl<typename compact_storage_append<S, G>::type, F...> {};
+
+    template <bool Compact, field_c... F>
+    struct compact_storage_select {
+        using type = no_compact_storage;
+    };
+
+    template <field_c... F> requires (compact_storable<F> || ...)
+    struct compact_storage_select<true, F...> : compact_storage_of_impl<compact_storage<>, F...> {};
+
+    /// @brief The @ref compact_storage of @ref compact_storable fields in `F...` (in declaration order),
+    /// or @ref no_compact_storage if the layout is not compact or no field is stored compactly
+    template <bool Compact, field_c... F>
+    using compact_storage_of = typename compact_storage_select<Compact, F...>::type;
+
+}
+
+#endif //PROTOPUF_COMPACT_H
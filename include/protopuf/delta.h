@@ -0,0 +1,418 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_DELTA_H
+#define PROTOPUF_DELTA_H
+
+#include <algorithm>
+#include <iterator>
+#include <ranges>
+#include <vector>
+#include "message.h"
+
+namespace pp {
+
+    /// @brief The field number of the record listing fields cleared by a delta, ref to @ref delta_coder,
+    /// which is in the range reserved by protobuf for implementations (19000 to 19999)
+    constexpr uint<4> delta_clear_number = 19000;
+
+    /// How a field is written into a delta, ref to @ref delta_coder
+    enum class delta_op {
+        /// the field is unchanged
+        none,
+
+        /// the field is cleared
+        clear,
+
+        /// the field is overwritten by its new value, or its new elements are appended after it is cleared
+        set,
+
+        /// new elements are appended to the field, which is a prefix of its new value
+        append,
+
+        /// changes of the embedded message are written as a nested delta
+        nested
+    };
+
+    template <message_c T>
+    struct delta_coder;
+
+    /// @brief A coder of changes between two messages of type `T` (a delta), which is the inverse of `message::merge`:
+    /// applying the delta from message `a` to message `b` onto `a` (i.e. `apply`) turns it into `b`.
+    ///
+    /// A delta is encoded as a message of type `T` holding only the changed fields, so that it is applied with merge semantics
+    /// (as protobuf merges an encoded message, i.e. singular fields are overwritten and repeated fields are appended):
+    /// - unchanged fields are omitted
+    /// - changed singular fields (and alternatives of oneof fields) are written with their new values
+    /// - elements appended to repeated fields (if the old elements are a prefix of the new ones) are written alone
+    /// - changes of embedded messages present on both sides are written as nested deltas in place of the messages
+    ///   (which are merged recursively into the embedded messages instead of overwriting them)
+    ///
+    /// Fields which cannot be expressed by merging (i.e. emptied fields and repeated fields changed otherwise)
+    /// are listed in a leading packed record of field @ref delta_clear_number, which are cleared before other fields are merged,
+    /// so that a delta is only meaningful to the message it is computed from.
+    template <field_c... F>
+    struct delta_coder<message<F...>> {
+    private:
+        using T = message<F...>;
+
+        static constexpr uint<4> clear_key = delta_clear_number << 3 | 2;
+
+        template <field_c G>
+        static constexpr bool nested_field = [] {
+            if constexpr (is_oneof<G>) {
+                return false;
+            } else {
+                return G::attr == singular && is_embedded_coder<typename G::coder>;
+            }
+        }();
+
+        template <field_c G>
+        static constexpr bool appendable_field = !is_oneof<G> && !is_unknown_fields<G> && G::attr != singular &&
+            std::ranges::random_access_range<typename G::base_type>;
+
+        template <field_c G>
+        static constexpr delta_op op_of(const auto& a, const auto& b) {
+            if(a.cast_to_base() == b.cast_to_base()) {
+                return delta_op::none;
+            }
+
+            if(empty_field(b)) {
+                return delta_op::clear;
+            }
+
+            if constexpr (nested_field<G>) {
+                if(a.has_value()) {
+                    return delta_op::nested;
+                }
+            } else if constexpr (appendable_field<G>) {
+                if(a.size() < b.size() && std::equal(a.begin(), a.end(), b.begin())) {
+                    return delta_op::append;
+                }
+            }
+
+            return delta_op::set;
+        }
+
+        /// Checks whether field `G` with operation `op` is listed in the record of cleared fields
+        template <field_c G>
+        static constexpr bool cleared(delta_op op, const auto& a) {
+            if constexpr (G::attr == singular) {
+                return op == delta_op::clear;
+            } else {
+                return op == delta_op::clear || (op == delta_op::set && !empty_field(a));
+            }
+        }
+
+        template <field_c G>
+        static constexpr auto appended(const auto& a, const auto& b) {
+            return std::ranges::subrange(std::ranges::next(b.begin(), a.size()), b.end());
+        }
+
+        /// Get the encoded length of the operation `op` of field `G` (excluding the record of cleared fields)
+        template <field_c G>
+        static constexpr std::size_t field_skip(delta_op op, const auto& a, const auto& b) {
+            if(op == delta_op::set) {
+                return field_encode_skip(b);
+            } else if(op == delta_op::append) {
+                if constexpr (appendable_field<G>) {
+                    using C = typename G::coder;
+                    auto r = appended<G>(a, b);
+
+                    if constexpr (G::attr == packed) {
+                        auto len = elements_encode_skip<C>(r);
+                        return varint_size(G::key) + varint_size(len) + len;
+                    } else {
+                        std::size_t n = 0;
+                        for(const auto& i : r) {
+                            n += varint_size(G::key) + skipper<C>::encode_skip(i);
+                        }
+
+                        return n;
+                    }
+                }
+            } else if(op == delta_op::nested) {
+                if constexpr (nested_field<G>) {
+                    auto len = delta_coder<typename G::coder::value_type>::encode_skip(*a, *b);
+                    return varint_size(G::key) + varint_size(len) + len;
+                }
+            }
+
+            return 0;
+        }
+
+        /// Encode the operation `op` of field `G` (excluding the record of cleared fields) into `bs`
+        template <field_c G>
+        static constexpr bytes field_encode(delta_op op, const auto& a, const auto& b, bytes bs) {
+            if(op == delta_op::set) {
+                bs = encode_field(b, bs);
+            } else if(op == delta_op::append) {
+                if constexpr (appendable_field<G>) {
+                    using C = typename G::coder;
+                    auto r = appended<G>(a, b);
+
+                    if constexpr (G::attr == packed) {
+                        bs = encode_constant_varint<G::key>(bs);
+                        bs = varint_coder<uint<8>>::encode(elements_encode_skip<C>(r), bs);
+                        bs = encode_elements<C>(r, bs);
+                    } else {
+                        for(const auto& i : r) {
+                            bs = encode_constant_varint<G::key>(bs);
+                            bs = C::encode(i, bs);
+                        }
+                    }
+                }
+            } else if(op == delta_op::nested) {
+                if constexpr (nested_field<G>) {
+                    using M = typename G::coder::value_type;
+
+                    bs = encode_constant_varint<G::key>(bs);
+                    bs = varint_coder<uint<8>>::encode(delta_coder<M>::encode_skip(*a, *b), bs);
+                    bs = delta_coder<M>::encode(*a, *b, bs);
+                }
+            }
+
+            return bs;
+        }
+
+        /// Apply `f(std::type_identity<G>{}, op, a, b)` to every field `G` with its operation `op` and values in `from` and `to`
+        template <typename Fn>
+        static constexpr void visit(const T& from, const T& to, Fn&& f) {
+            ([&] {
+                decltype(auto) a = from.template get<F::number>();
+                decltype(auto) b = to.template get<F::number>();
+
+                f(std::type_identity<F>{}, op_of<F>(a, b), a, b);
+            }(), ...);
+        }
+
+        /// the total encoded length of numbers of cleared fields
+        static constexpr std::size_t cleared_skip(const T& from, const T& to) {
+            std::size_t n = 0;
+            visit(from, to, [&n]<field_c G>(std::type_identity<G>, delta_op op, const auto& a, const auto&) {
+                if(cleared<G>(op, a)) {
+                    n += varint_size(G::number);
+                }
+            });
+
+            return n;
+        }
+
+        /// Empty the field with number `n` of `v`
+        static constexpr void clear_number(T& v, uint<4> n) {
+            ([&] {
+                if(field_has_number<F>(n)) {
+                    auto&& f = v.template get<F::number>();
+                    clear_field(f);
+                }
+            }(), ...);
+        }
+
+        /// Apply the nested delta from `b` of the embedded message field with key `k` of `v` if any,
+        /// returns whether the key refers to such a field
+        template <bool Checked>
+        static constexpr bool apply_nested(T& v, uint<4> k, bytes b, checked_result<bytes>& res) {
+            return ([&] {
+                if constexpr (nested_field<F>) {
+                    if(k == F::key) {
+                        auto&& f = v.template get<F::number>();
+                        if(!f.has_value()) {
+                            f.emplace();
+                        }
+
+                        using M = typename F::coder::value_type;
+
+                        if constexpr (Checked) {
+                            auto lr = varint_coder<uint<8>>::checked_decode(b);
+                            if(!lr) {
+                                res = lr.error();
+                                return true;
+                            }
+
+                            auto [len, rest] = *lr;
+                            if(len > rest.size()) {
+                                res = decode_error::length_overflow;
+                                return true;
+                            }
+
+                            if(auto r = delta_coder<M>::checked_apply(*f, rest.subspan(0, len)); !r) {
+                                res = r.error();
+                                return true;
+                            }
+
+                            res = rest.subspan(len);
+                        } else {
+                            std::size_t len = 0;
+                            std::tie(len, b) = varint_coder<uint<8>>::decode(b);
+
+                            delta_coder<M>::apply(*f, b.subspan(0, len));
+                            res = b.subspan(len);
+                        }
+
+                        return true;
+                    }
+                }
+
+                return false;
+            }() || ...);
+        }
+
+    public:
+        using value_type = T;
+
+        delta_coder() = delete;
+
+        /// Get the encoded length of the delta from `from` to `to`, which is 0 if they are equal
+        static constexpr std::size_t encode_skip(const T& from, const T& to) {
+            std::size_t n = 0;
+            if(auto len = cleared_skip(from, to); len > 0) {
+                n += varint_size(clear_key) + varint_size(len) + len;
+            }
+
+            visit(from, to, [&n]<field_c G>(std::type_identity<G>, delta_op op, const auto& a, const auto& b) {
+                n += field_skip<G>(op, a, b);
+            });
+
+            return n;
+        }
+
+        /// Encode the delta from `from` to `to` into `b`, which must hold at least `encode_skip(from, to)` bytes
+        static constexpr bytes encode(const T& from, const T& to, bytes b) {
+            if(auto len = cleared_skip(from, to); len > 0) {
+                b = encode_constant_varint<clear_key>(b);
+                b = varint_coder<uint<8>>::encode(len, b);
+
+                visit(from, to, [&b]<field_c G>(std::type_identity<G>, delta_op op, const auto& a, const auto&) {
+                    if(cleared<G>(op, a)) {
+                        b = varint_coder<uint<4>>::encode(G::number, b);
+                    }
+                });
+            }
+
+            visit(from, to, [&b]<field_c G>(std::type_identity<G>, delta_op op, const auto& x, const auto& y) {
+                b = field_encode<G>(op, x, y, b);
+            });
+
+            return b;
+        }
+
+        /// Encode the delta from `from` to `to` into a new byte vector
+        static std::vector<std::byte> encode(const T& from, const T& to) {
+            std::vector<std::byte> res(encode_skip(from, to));
+            encode(from, to, res);
+
+            return res;
+        }
+
+        /// @brief Apply the delta from `b` onto `v`, which must equal to the message the delta is computed from,
+        /// returns the remaining bytes
+        static constexpr bytes apply(T& v, bytes b) {
+            std::size_t hint = 0;
+            while(b.end() > b.begin()) {
+                const auto &[k, kb] = varint_coder<uint<4>>::decode(b);
+
+                if(k == clear_key) {
+                    std::size_t len = 0;
+                    std::tie(len, b) = varint_coder<uint<8>>::decode(kb);
+
+                    for(bytes s = b.subspan(0, len); s.end() > s.begin();) {
+                        uint<4> n = 0;
+                        std::tie(n, s) = varint_coder<uint<4>>::decode(s);
+                        clear_number(v, n);
+                    }
+
+                    b = b.subspan(len);
+                    continue;
+                }
+
+                if(checked_result<bytes> r = b; apply_nested<false>(v, k, kb, r)) {
+                    b = *r;
+                    continue;
+                }
+
+                bool next = true;
+                std::tie(b, next) = decode_map<T>.decode(v, b, hint);
+
+                if(!next) break;
+            }
+
+            decode_map<T>.finish(v);
+            return b;
+        }
+
+        /// Same as `apply(v, b)`, but never reads past the end of `b`, `v` is unspecified if the delta is malformed
+        /// @returns a @ref checked_result holding the remaining bytes, or the @ref decode_error
+        static constexpr checked_result<bytes> checked_apply(T& v, bytes b) {
+            std::size_t hint = 0;
+            while(b.end() > b.begin()) {
+                auto kr = varint_coder<uint<4>>::checked_decode(b);
+                if(!kr) {
+                    return kr.error();
+                }
+
+                const auto &[k, kb] = *kr;
+
+                if(k == clear_key) {
+                    auto lr = varint_coder<uint<8>>::checked_decode(kb);
+                    if(!lr) {
+                        return lr.error();
+                    }
+
+                    auto [len, rest] = *lr;
+                    if(len > rest.size()) {
+                        return decode_error::length_overflow;
+                    }
+
+                    for(bytes s = rest.subspan(0, len); s.end() > s.begin();) {
+                        auto nr = varint_coder<uint<4>>::checked_decode(s);
+                        if(!nr) {
+                            return nr.error();
+                        }
+
+                        clear_number(v, nr->first);
+                        s = nr->second;
+                    }
+
+                    b = rest.subspan(len);
+                    continue;
+                }
+
+                if(checked_result<bytes> r = b; apply_nested<true>(v, k, kb, r)) {
+                    if(!r) {
+                        return r.error();
+                    }
+
+                    b = *r;
+                    continue;
+                }
+
+                auto r = decode_map<T>.checked_decode(v, b, hint);
+                if(!r) {
+                    return r.error();
+                }
+
+                bool next = true;
+                std::tie(b, next) = *r;
+
+                if(!next) break;
+            }
+
+            decode_map<T>.finish(v);
+            return b;
+        }
+    };
+
+}
+
+#endif //PROTOPUF_DELTA_H
@@ -40,6 +40,15 @@ namespace pp {
             auto [res, bytes] = varint_coder<std::underlying_type_t<T>>::decode(b);
             return {static_cast<T>(res), bytes};
         }
+
+        static constexpr checked_decode_result<T> checked_decode(bytes b) {
+            auto p = varint_coder<std::underlying_type_t<T>>::checked_decode(b);
+            if(!p) {
+                return p.error();
+            }
+
+            return decode_result<T>{static_cast<T>(p->first), p->second};
+        }
     };
 
 }
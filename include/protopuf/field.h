@@ -22,7 +22,11 @@
 #include "varint.h"
 #include "bool.h"
 #include "fixed_string.h"
+#include "view.h"
+#include "constant.h"
+#include <array>
 #include <optional>
+#include <variant>
 
 namespace pp {
 
@@ -47,6 +51,12 @@ namespace pp {
     template <floating_point32 T>
     struct wire_type_impl<float_coder<T>> : std::integral_constant<uint<1>, 5> {};
 
+    template <typename T>
+    struct wire_type_impl<basic_string_view_coder<T>> : std::integral_constant<uint<1>, 2> {};
+
+    template <>
+    struct wire_type_impl<bytes_view_coder> : std::integral_constant<uint<1>, 2> {};
+
     template <>
     struct wire_type_impl<bool_coder> : std::integral_constant<uint<1>, 0> {};
 
@@ -66,24 +76,27 @@ namespace pp {
         /// Represents a singular field, which can appear zero times or once in a message
         singular,
         /// Represents a repeated field, which can appear zero times, once or many times in a message
-        repeated
+        repeated,
+        /// @brief Represents a repeated field of scalar type, which is encoded as one length-delimited record
+        /// with all elements back to back, ref to https://developers.google.com/protocol-buffers/docs/encoding#packed
+        packed
     };
 
-    template <attribute, typename T, typename>
+    template <attribute, typename T, typename C>
     struct field_container_impl {
-        using type = std::optional<T>;
+        using type = C;
     };
 
     template <typename T, typename C>
-    struct field_container_impl<repeated, T, C> {
-        using type = C;
+    struct field_container_impl<singular, T, C> {
+        using type = std::optional<T>;
     };
 
     /// @brief The underlying container type of a field
     /// @param A the @ref attribute of the field
     /// @param T the underlying object type (to store data) of the field
     /// @param Container the underlying container to store repeated objects, 
-    /// it will be used while the attribute `A` is @ref repeated
+    /// it will be used while the attribute `A` is @ref repeated or @ref packed
     template <attribute A, typename T, std::ranges::sized_range Container = std::vector<T>>
     using field_container = typename field_container_impl<A, T, Container>::type;
 
@@ -92,8 +105,9 @@ namespace pp {
     /// @param N the field number, ref to https://developers.google.com/protocol-buffers/docs/encoding#structure
     /// @param C the @ref coder of the field
     /// @param A the @ref attribute of the field
-    /// @param Container the container used in @ref field_container, enabled while `A` is @ref repeated.
+    /// @param Container the container used in @ref field_container, enabled while `A` is @ref repeated or @ref packed.
     template <basic_fixed_string S, uint<4> N, coder C, attribute A = singular, std::ranges::sized_range Container = std::vector<typename C::value_type>>
+        requires (A != packed || wire_type<C> != 2)
     struct field : field_container<A, typename C::value_type, Container>{
         /// name of the field
         static constexpr basic_fixed_string name = S;
@@ -105,7 +119,10 @@ namespace pp {
         static constexpr uint<4> number = N;
 
         /// key of the field, ref to https://developers.google.com/protocol-buffers/docs/encoding#structure
-        static constexpr uint<4> key = (N << 3u) | wire_type<C>;
+        static constexpr uint<4> key = (N << 3u) | (A == packed ? 2u : wire_type<C>);
+
+        /// key of each element of the field in the unpacked form, which equals to @ref key unless the field is @ref packed
+        static constexpr uint<4> element_key = (N << 3u) | wire_type<C>;
 
         /// @ref coder of the field 
         using coder = C;
@@ -118,8 +135,8 @@ namespace pp {
 
         using base_type::base_type;
 
-        field(const base_type& base) : base_type(base) {}
-        field(base_type&& base) : base_type(std::move(base)) {}
+        constexpr field(const base_type& base) : base_type(base) {}
+        constexpr field(base_type&& base) : base_type(std::move(base)) {}
 
         /// cast the field to @ref base_type
         constexpr decltype(auto) cast_to_base() {
@@ -211,9 +228,25 @@ namespace pp {
     using string_field = field<S, N, string_coder, A, Container>;
 
     /// Type alias for bytes fields
-    template <basic_fixed_string S, uint<4> N, attribute A = singular, typename Container = std::vector<std::vector<std::byte>>>
+    template <basic_fixed_string S, uint<4> N, attribute A = singular, typename Container = std::vector<typename bytes_coder::value_type>>
     using bytes_field = field<S, N, bytes_coder, A, Container>;
 
+    /// Type alias for `std::pmr::string` fields, which allocate from the memory resource passed to decoding
+    template <basic_fixed_string S, uint<4> N, attribute A = singular, typename Container = std::pmr::vector<std::pmr::string>>
+    using pmr_string_field = field<S, N, pmr_string_coder, A, Container>;
+
+    /// Type alias for `std::pmr::vector<uint<1>>` fields, which allocate from the memory resource passed to decoding
+    template <basic_fixed_string S, uint<4> N, attribute A = singular, typename Container = std::pmr::vector<std::pmr::vector<uint<1>>>>
+    using pmr_bytes_field = field<S, N, pmr_bytes_coder, A, Container>;
+
+    /// Type alias for `std::string_view` fields, decoded as views into the input bytes (see @ref basic_string_view_coder)
+    template <basic_fixed_string S, uint<4> N, attribute A = singular, typename Container = std::vector<std::string_view>>
+    using string_view_field = field<S, N, string_view_coder, A, Container>;
+
+    /// Type alias for @ref const_bytes fields, decoded as views into the input bytes (see @ref bytes_view_coder)
+    template <basic_fixed_string S, uint<4> N, attribute A = singular, typename Container = std::vector<const_bytes>>
+    using bytes_view_field = field<S, N, bytes_view_coder, A, Container>;
+
     /// Type alias for boolean fields
     template <basic_fixed_string S, uint<4> N, attribute A = singular, typename Container = std::vector<bool>>
     using bool_field = field<S, N, bool_coder, A, Container>;
@@ -233,6 +266,29 @@ namespace pp {
     template <typename T>
     concept field_c = is_field<T>;
 
+    /// Checks whether the type is a @ref oneof_field type
+    template <typename>
+    constexpr bool is_oneof = false;
+
+    template <basic_fixed_string S, field_c... F> requires (sizeof...(F) > 0 && ((F::attr == singular && !is_oneof<F>) && ...))
+    struct oneof_field;
+
+    template <basic_fixed_string S, field_c... F>
+    constexpr bool is_oneof <oneof_field<S, F...>> = true;
+
+    template <basic_fixed_string S, field_c... F>
+    constexpr bool is_field <oneof_field<S, F...>> = true;
+
+    /// Checks whether field `F` has the field number `n`, where a @ref oneof_field has the field numbers of all its alternatives
+    template <field_c F>
+    constexpr bool field_has_number(uint<4> n) {
+        if constexpr (is_oneof<F>) {
+            return F::has_number(n);
+        } else {
+            return F::number == n;
+        }
+    }
+
     /// Represents the specific field is not found, used in @ref field_number_selector and @ref field_name_selector
     struct field_not_found;
 
@@ -241,7 +297,7 @@ namespace pp {
 
     template <uint<4> I, field_c C, field_c... D>
     struct field_number_selector_impl<I, C, D...> {
-        using type = std::conditional_t<I == C::number, C, typename field_number_selector_impl<I, D...>::type>;
+        using type = std::conditional_t<field_has_number<C>(I), C, typename field_number_selector_impl<I, D...>::type>;
     };
 
     template <uint<4> I>
@@ -249,7 +305,7 @@ namespace pp {
         using type = field_not_found;
     };
 
-    /// Find the first field in `C...` whose field number is `I`
+    /// Find the first field in `C...` whose field number is `I`, ref to @ref field_has_number
     template <uint<4> I, field_c... C>
     using field_number_selector = typename field_number_selector_impl<I, C...>::type;
 
@@ -270,6 +326,188 @@ namespace pp {
     template <basic_fixed_string S, field_c... C>
     using field_name_selector = typename field_name_selector_impl<S, C...>::type;
 
+    /// @brief A group of singular fields where at most one field is set at a time,
+    /// ref to https://developers.google.com/protocol-buffers/docs/proto3#oneof
+    ///
+    /// Values of all alternatives `F...` share one storage `std::variant<std::monostate, typename F::coder::value_type...>`,
+    /// where the `i`-th alternative is held at index `i + 1` and `std::monostate` represents that no alternative is set.
+    /// While decoding, setting an alternative discards the others, so the last one wins;
+    /// while encoding, only the set alternative is written.
+    /// The group is found in a message by its name `S`, or by the field number of any alternative.
+    /// @param S the name of the group
+    /// @param F the singular fields as alternatives
+    template <basic_fixed_string S, field_c... F> requires (sizeof...(F) > 0 && ((F::attr == singular && !is_oneof<F>) && ...))
+    struct oneof_field : std::variant<std::monostate, typename F::coder::value_type...> {
+        /// name of the group
+        static constexpr basic_fixed_string name = S;
+
+        /// type of name of the group
+        using name_type = decltype(name);
+
+        /// the field number of the first alternative, which refers to the group
+        static constexpr uint<4> number = type_get<0, F...>::number;
+
+        /// the group is set at most once, like a singular field
+        static constexpr attribute attr = singular;
+
+        /// the number of alternatives
+        static constexpr std::size_t alternative_count = sizeof...(F);
+
+        /// the underlying type (to store data of the group), which the group is derived from
+        using base_type = std::variant<std::monostate, typename F::coder::value_type...>;
+
+        /// get the alternative field type by the index in `F...`
+        template <std::size_t I>
+        using alternative = type_get<I, F...>;
+
+        /// get the alternative field type by the specific field number
+        template <uint<4> N>
+        using get_type_by_number = field_number_selector<N, F...>;
+
+        /// get the alternative field type by the specific field name
+        template <basic_fixed_string N>
+        using get_type_by_name = field_name_selector<N, F...>;
+
+    private:
+        /// index in @ref base_type of the first alternative satisfying `pred`, or 0 if not found
+        template <typename P>
+        static constexpr std::size_t index_where(P pred) {
+            std::size_t i = 0, res = 0;
+            ((++i, res = res == 0 && pred(std::type_identity<F>{}) ? i : res), ...);
+            return res;
+        }
+
+    public:
+        /// index in @ref base_type of the alternative with field number `N`
+        template <uint<4> N>
+        static constexpr std::size_t index_of_number = index_where([]<typename G>(std::type_identity<G>) { return G::number == N; });
+
+        /// index in @ref base_type of the alternative with field name `N`
+        template <basic_fixed_string N>
+        static constexpr std::size_t index_of_name = index_where([]<typename G>(std::type_identity<G>) { return G::name == N; });
+
+        /// Checks whether any alternative has the field number `n`
+        static constexpr bool has_number(uint<4> n) {
+            return ((F::number == n) || ...);
+        }
+
+        using base_type::base_type;
+
+        constexpr oneof_field(const base_type& base) : base_type(base) {}
+        constexpr oneof_field(base_type&& base) : base_type(std::move(base)) {}
+
+        /// cast the group to @ref base_type
+        constexpr decltype(auto) cast_to_base() {
+            return static_cast<base_type&>(*this);
+        }
+
+        /// cast the const group to const @ref base_type
+        constexpr decltype(auto) cast_to_base() const {
+            return static_cast<const base_type&>(*this);
+        }
+
+        /// Checks whether any alternative is set
+        constexpr bool has_value() const {
+            return this->index() != 0;
+        }
+
+        /// Unset the alternative
+        constexpr void reset() {
+            cast_to_base().template emplace<0>();
+        }
+
+        /// the field number of the alternative which is set, or 0 if no alternative is set
+        constexpr uint<4> active_number() const {
+            constexpr std::array<uint<4>, sizeof...(F) + 1> numbers{0, F::number...};
+            return numbers[this->index()];
+        }
+
+        /// Checks whether the alternative with field number `N` is set
+        template <uint<4> N> requires (index_of_number<N> != 0)
+        constexpr bool holds() const {
+            return this->index() == index_of_number<N>;
+        }
+
+        /// Checks whether the alternative with field name `N` is set
+        template <basic_fixed_string N> requires (index_of_name<N> != 0)
+        constexpr bool holds() const {
+            return this->index() == index_of_name<N>;
+        }
+
+        /// get the value of alternative by the field number, throws `std::bad_variant_access` if it is not set
+        template <uint<4> N> requires (index_of_number<N> != 0)
+        constexpr decltype(auto) get() const {
+            return std::get<index_of_number<N>>(cast_to_base());
+        }
+
+        /// get the value of alternative by the field name, throws `std::bad_variant_access` if it is not set
+        template <basic_fixed_string N> requires (index_of_name<N> != 0)
+        constexpr decltype(auto) get() const {
+            return std::get<index_of_name<N>>(cast_to_base());
+        }
+
+        /// get the value of alternative by the field number, throws `std::bad_variant_access` if it is not set
+        template <uint<4> N> requires (index_of_number<N> != 0)
+        constexpr decltype(auto) get() {
+            return std::get<index_of_number<N>>(cast_to_base());
+        }
+
+        /// get the value of alternative by the field name, throws `std::bad_variant_access` if it is not set
+        template <basic_fixed_string N> requires (index_of_name<N> != 0)
+        constexpr decltype(auto) get() {
+            return std::get<index_of_name<N>>(cast_to_base());
+        }
+
+        /// get a pointer to the value of alternative by the field number, or null if it is not set
+        template <uint<4> N> requires (index_of_number<N> != 0)
+        constexpr auto get_if() const {
+            return std::get_if<index_of_number<N>>(&cast_to_base());
+        }
+
+        /// get a pointer to the value of alternative by the field name, or null if it is not set
+        template <basic_fixed_string N> requires (index_of_name<N> != 0)
+        constexpr auto get_if() const {
+            return std::get_if<index_of_name<N>>(&cast_to_base());
+        }
+
+        /// get a pointer to the value of alternative by the field number, or null if it is not set
+        template <uint<4> N> requires (index_of_number<N> != 0)
+        constexpr auto get_if() {
+            return std::get_if<index_of_number<N>>(&cast_to_base());
+        }
+
+        /// get a pointer to the value of alternative by the field name, or null if it is not set
+        template <basic_fixed_string N> requires (index_of_name<N> != 0)
+        constexpr auto get_if() {
+            return std::get_if<index_of_name<N>>(&cast_to_base());
+        }
+
+        /// set the alternative with field number `N` to a value constructed from `args`, discarding the previous alternative
+        template <uint<4> N, typename... Args> requires (index_of_number<N> != 0)
+        constexpr decltype(auto) emplace(Args&&... args) {
+            return cast_to_base().template emplace<index_of_number<N>>(std::forward<Args>(args)...);
+        }
+
+        /// set the alternative with field name `N` to a value constructed from `args`, discarding the previous alternative
+        template <basic_fixed_string N, typename... Args> requires (index_of_name<N> != 0)
+        constexpr decltype(auto) emplace(Args&&... args) {
+            return cast_to_base().template emplace<index_of_name<N>>(std::forward<Args>(args)...);
+        }
+
+        /// @brief Apply `f(std::type_identity<A>{}, v)` to the value `v` of alternative field `A` which is set,
+        /// returns whether any alternative is set
+        template <typename V>
+        constexpr bool visit_alternative(V&& f) const {
+            return visit_impl(f, std::index_sequence_for<F...>{});
+        }
+
+    private:
+        template <typename V, std::size_t... I>
+        constexpr bool visit_impl(V& f, std::index_sequence<I...>) const {
+            return ((this->index() == I + 1 ? (f(std::type_identity<F>{}, std::get<I + 1>(cast_to_base())), true) : false) || ...);
+        }
+    };
+
     /// Checks whether a field is empty
     template <field_c T>
     constexpr bool empty_field(const T& v) {
@@ -280,6 +518,16 @@ namespace pp {
         }
     }
 
+    /// Empty a field: reset if it is singular, clear the container (keeping its capacity) otherwise
+    template <field_c F>
+    constexpr void clear_field(F& f) {
+        if constexpr (F::attr == singular) {
+            f.reset();
+        } else {
+            f.clear();
+        }
+    }
+
     /// Push a value into a field: overwrite if it is singular, insert to end otherwise
     template <field_c F, typename T>
     constexpr void push_field(F& f, T&& v) {
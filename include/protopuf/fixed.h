@@ -0,0 +1,271 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_FIXED_H
+#define PROTOPUF_FIXED_H
+
+#include <algorithm>
+#include <array>
+#include <type_traits>
+#include "message.h"
+
+namespace pp {
+
+    /// @brief The maximum encoded length of a value of @ref coder `C` as member `value`,
+    /// which is absent if the length is unbounded, i.e. strings and containers
+    template <typename C>
+    struct max_value_size {};
+
+    template <typename T>
+    struct max_value_size<integer_coder<T>> : std::integral_constant<std::size_t, sizeof(T)> {};
+
+    template <typename T>
+    struct max_value_size<float_coder<T>> : std::integral_constant<std::size_t, sizeof(T)> {};
+
+    template <>
+    struct max_value_size<bool_coder> : std::integral_constant<std::size_t, 1> {};
+
+    template <typename T>
+    struct max_value_size<varint_coder<T>> : std::integral_constant<std::size_t, (8 * sizeof(T) + 6) / 7> {};
+
+    template <typename T>
+    struct max_value_size<enum_coder<T>> : max_value_size<varint_coder<std::underlying_type_t<T>>> {};
+
+    /// The maximum encoded length of field `F` with its key as member `value`, which is absent if the length is unbounded
+    template <typename F>
+    struct max_field_size {};
+
+    template <field_c F> requires (F::attr == singular && !is_oneof<F> && requires { max_value_size<typename F::coder>::value; })
+    struct max_field_size<F> :
+        std::integral_constant<std::size_t, varint_size(F::key) + max_value_size<typename F::coder>::value> {};
+
+    template <basic_fixed_string S, field_c... F> requires (requires { max_field_size<F>::value; } && ...)
+    struct max_field_size<oneof_field<S, F...>> : std::integral_constant<std::size_t, std::max({max_field_size<F>::value...})> {};
+
+    /// The maximum encoded length of message type `T` as member `value`, which is absent if it is not a @ref fixed_shape message
+    template <typename T>
+    struct max_message_size {};
+
+    template <field_c... F> requires (requires { max_field_size<F>::value; } && ...)
+    struct max_message_size<message<F...>> : std::integral_constant<std::size_t, (max_field_size<F>::value + ... + 0)> {};
+
+    /// @brief A concept satisfied while `T` is a message type of fixed shape,
+    /// i.e. all fields are singular with bounded encoded lengths (integers, floating points, booleans, enums and such messages),
+    /// without strings or repeated fields
+    template <typename T>
+    concept fixed_shape = message_c<T> && requires { max_message_size<T>::value; };
+
+    template <fixed_shape T>
+    struct max_value_size<embedded_message_coder<T>> :
+        std::integral_constant<std::size_t, varint_size(max_message_size<T>::value) + max_message_size<T>::value> {};
+
+    /// The maximum encoded length of @ref fixed_shape message type `T`, known at compile time
+    template <fixed_shape T>
+    constexpr std::size_t max_encoded_size = max_message_size<T>::value;
+
+    /// Bytes of an encoded message in a stack buffer of `N` bytes, ref to @ref fixed_coder
+    template <std::size_t N>
+    struct fixed_buffer {
+        std::array<std::byte, N> storage{};
+        std::size_t length = 0;
+
+        constexpr bytes view() {
+            return {storage.data(), length};
+        }
+
+        constexpr const_bytes view() const {
+            return {storage.data(), length};
+        }
+
+        constexpr std::byte* data() {
+            return storage.data();
+        }
+
+        constexpr const std::byte* data() const {
+            return storage.data();
+        }
+
+        constexpr std::size_t size() const {
+            return length;
+        }
+
+        constexpr auto begin() const {
+            return storage.begin();
+        }
+
+        constexpr auto end() const {
+            return storage.begin() + length;
+        }
+    };
+
+    template <fixed_shape>
+    struct fixed_coder;
+
+    /// @brief A coder of @ref fixed_shape message type, which produces and accepts the same bytes as @ref message_coder,
+    /// in straight-line code per field.
+    ///
+    /// - encoding writes into a buffer of @ref max_encoded_size bytes without a sizing pass or length checks,
+    ///   where an embedded message is written after its length byte directly if its length always fits in one byte,
+    ///   or is moved after its length otherwise
+    /// - decoding takes fields in declaration order by comparing their precomputed keys,
+    ///   skipping absent fields, and falls back to `message_coder<T>::decode` for the bytes left after the last field
+    ///   (i.e. fields out of order, unknown fields and alternatives of oneof fields).
+    ///   Values are not bounds-checked, so the input must be trusted, ref to `message_coder<T>::checked_decode` otherwise.
+    ///
+    /// Instrumentation hooks (ref to @ref message_instrument) are not called on this path.
+    template <field_c... F>
+    struct fixed_coder<message<F...>> {
+    private:
+        using T = message<F...>;
+
+        template <field_c G>
+        static constexpr bytes encode_value(const typename G::coder::value_type& v, bytes b) {
+            using C = typename G::coder;
+
+            if constexpr (is_embedded_coder<C>) {
+                using M = typename C::value_type;
+
+                if constexpr (varint_size(max_encoded_size<M>) == 1) {
+                    auto e = fixed_coder<M>::encode(v, b.subspan(1));
+                    b[0] = std::byte(e.data() - b.data() - 1);
+
+                    return e;
+                } else {
+                    constexpr std::size_t reserved = varint_size(max_encoded_size<M>);
+
+                    auto e = fixed_coder<M>::encode(v, b.subspan(reserved));
+                    std::size_t len = e.data() - b.data() - reserved;
+                    auto p = varint_coder<uint<8>>::encode(len, b);
+                    std::copy_n(b.begin() + reserved, len, p.begin());
+
+                    return p.subspan(len);
+                }
+            } else {
+                return C::encode(v, b);
+            }
+        }
+
+        template <field_c G>
+        static constexpr decltype(auto) field_of(auto& msg) {
+            if constexpr (is_oneof<G>) {
+                return msg.template get<G::name>();
+            } else {
+                return msg.template get<G::number>();
+            }
+        }
+
+        template <field_c G>
+        static constexpr bytes encode_field(const T& msg, bytes b) {
+            decltype(auto) f = field_of<G>(msg);
+
+            if constexpr (is_oneof<G>) {
+                f.visit_alternative([&b]<field_c A>(std::type_identity<A>, const auto& v) {
+                    b = encode_constant_varint<A::key>(b);
+                    b = encode_value<A>(v, b);
+                });
+            } else if(f.has_value()) {
+                b = encode_constant_varint<G::key>(b);
+                b = encode_value<G>(*f, b);
+            }
+
+            return b;
+        }
+
+        template <field_c G>
+        static constexpr typename G::coder::value_type decode_value(bytes& b) {
+            using C = typename G::coder;
+
+            if constexpr (is_embedded_coder<C>) {
+                std::size_t len = 0;
+                std::tie(len, b) = varint_coder<uint<8>>::decode(b);
+
+                typename C::value_type v;
+                fixed_coder<typename C::value_type>::decode(v, b.subspan(0, len));
+                b = b.subspan(len);
+
+                return v;
+            } else {
+                auto [v, rest] = C::decode(b);
+                b = rest;
+
+                return v;
+            }
+        }
+
+        /// Decode field `G` from `b` if the next key is its key, returns whether the field is decoded
+        template <field_c G>
+        static constexpr bool decode_field(T& v, bytes& b) {
+            if constexpr (is_oneof<G>) {
+                return false;
+            } else {
+                constexpr auto& key = varint_bytes<G::key>;
+
+                if(b.size() < key.size() || !std::equal(key.begin(), key.end(), b.begin())) {
+                    return false;
+                }
+
+                b = b.subspan(key.size());
+                v.template get<G::number>() = decode_value<G>(b);
+
+                return true;
+            }
+        }
+
+    public:
+        using value_type = T;
+
+        fixed_coder() = delete;
+
+        /// the maximum encoded length of the message
+        static constexpr std::size_t max_size = max_encoded_size<T>;
+
+        /// Encode `msg` into `b`, which must hold at least @ref max_size bytes (not checked), returns the remaining bytes
+        static constexpr bytes encode(const T& msg, bytes b) {
+            ((b = encode_field<F>(msg, b)), ...);
+
+            return b;
+        }
+
+        /// Encode `msg` into a stack buffer of @ref max_size bytes
+        static constexpr fixed_buffer<max_size> encode(const T& msg) {
+            fixed_buffer<max_size> res;
+            res.length = max_size - encode(msg, res.storage).size();
+
+            return res;
+        }
+
+        /// @brief Decode fields from `b` into an existing message `v` in place, returns the remaining bytes,
+        /// ref to `message_coder<T>::decode(v, b)`
+        static constexpr bytes decode(T& v, bytes b) {
+            (decode_field<F>(v, b), ...);
+
+            if(!b.empty()) {
+                b = message_coder<T>::decode(v, b);
+            }
+
+            return b;
+        }
+
+        /// Decode a message from `b`, ref to `message_coder<T>::decode(b)`
+        static constexpr decode_result<T> decode(bytes b) {
+            T v;
+            b = decode(v, b);
+
+            return {std::move(v), b};
+        }
+    };
+
+}
+
+#endif //PROTOPUF_FIXED_H
@@ -0,0 +1,453 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_FLAT_MAP_H
+#define PROTOPUF_FLAT_MAP_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <bit>
+
+namespace pp {
+
+    /// @brief An open-addressing hash map, which stores entries contiguously in insertion order.
+    ///
+    /// Entries live in a dense `std::vector<std::pair<K, V>>`, and a power-of-two table of slots (indices of entries)
+    /// is probed linearly, so that neither insertion nor iteration chases pointers and no node is allocated per entry.
+    /// Same as `std::map::emplace`, inserting a key which already exists keeps the existing entry.
+    /// Keys must not be modified through iterators, and any insertion or erasure invalidates iterators.
+    template <typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+    class flat_hash_map {
+    public:
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<K, V>;
+        using size_type = std::size_t;
+        using iterator = typename std::vector<value_type>::iterator;
+        using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    private:
+        std::vector<value_type> entries;
+
+        /// index of entry plus one for each slot, or 0 for an empty slot
+        std::vector<std::size_t> slots;
+
+        [[no_unique_address]] Hash hash;
+        [[no_unique_address]] KeyEqual equal;
+
+        /// the minimum number of slots of a non-empty table
+        static constexpr std::size_t min_slots = 16;
+
+        std::size_t home(const K& k) const {
+            return hash(k) & (slots.size() - 1);
+        }
+
+        /// find the slot holding key `k`, or the empty slot where `k` should be inserted
+        std::size_t probe(const K& k) const {
+            std::size_t i = home(k);
+            while(slots[i] != 0 && !equal(entries[slots[i] - 1].first, k)) {
+                i = (i + 1) & (slots.size() - 1);
+            }
+
+            return i;
+        }
+
+        void rehash(std::size_t n) {
+            slots.assign(n, 0);
+
+            for(std::size_t j = 0; j < entries.size(); ++j) {
+                std::size_t i = home(entries[j].first);
+                while(slots[i] != 0) {
+                    i = (i + 1) & (n - 1);
+                }
+
+                slots[i] = j + 1;
+            }
+        }
+
+        /// grow the table while the load factor would exceed 7/8 for `n` entries
+        void grow_for(std::size_t n) {
+            if(n * 8 > slots.size() * 7) {
+                rehash(std::bit_ceil(std::max(min_slots, n * 8 / 7 + 1)));
+            }
+        }
+
+    public:
+        flat_hash_map() = default;
+
+        flat_hash_map(std::initializer_list<value_type> list) {
+            reserve(list.size());
+            for(const auto& v : list) {
+                insert(v);
+            }
+        }
+
+        iterator begin() {
+            return entries.begin();
+        }
+
+        iterator end() {
+            return entries.end();
+        }
+
+        const_iterator begin() const {
+            return entries.begin();
+        }
+
+        const_iterator end() const {
+            return entries.end();
+        }
+
+        std::size_t size() const {
+            return entries.size();
+        }
+
+        bool empty() const {
+            return entries.empty();
+        }
+
+        /// Remove all entries, keeping the capacity of storage
+        void clear() {
+            entries.clear();
+            std::fill(slots.begin(), slots.end(), 0);
+        }
+
+        /// Reserve storage for `n` entries, so that inserting them neither reallocates nor rehashes
+        void reserve(std::size_t n) {
+            entries.reserve(n);
+            grow_for(n);
+        }
+
+        iterator find(const K& k) {
+            if(entries.empty()) {
+                return end();
+            }
+
+            auto s = slots[probe(k)];
+            return s != 0 ? begin() + (s - 1) : end();
+        }
+
+        const_iterator find(const K& k) const {
+            if(entries.empty()) {
+                return end();
+            }
+
+            auto s = slots[probe(k)];
+            return s != 0 ? begin() + (s - 1) : end();
+        }
+
+        bool contains(const K& k) const {
+            return find(k) != end();
+        }
+
+        /// get the value of key `k`, throws `std::out_of_range` if it does not exist
+        V& at(const K& k) {
+            if(auto iter = find(k); iter != end()) {
+                return iter->second;
+            }
+
+            throw std::out_of_range("pp::flat_hash_map::at");
+        }
+
+        /// get the value of key `k`, throws `std::out_of_range` if it does not exist
+        const V& at(const K& k) const {
+            if(auto iter = find(k); iter != end()) {
+                return iter->second;
+            }
+
+            throw std::out_of_range("pp::flat_hash_map::at");
+        }
+
+        /// Insert an entry constructed from `k` and `v` if key `k` does not exist
+        template <typename KK, typename VV>
+        std::pair<iterator, bool> emplace(KK&& k, VV&& v) {
+            grow_for(entries.size() + 1);
+
+            std::size_t i = probe(k);
+            if(slots[i] != 0) {
+                return {begin() + (slots[i] - 1), false};
+            }
+
+            entries.emplace_back(std::forward<KK>(k), std::forward<VV>(v));
+            slots[i] = entries.size();
+
+            return {end() - 1, true};
+        }
+
+        std::pair<iterator, bool> insert(const value_type& v) {
+            return emplace(v.first, v.second);
+        }
+
+        std::pair<iterator, bool> insert(value_type&& v) {
+            return emplace(std::move(v.first), std::move(v.second));
+        }
+
+        /// same as `insert(v)`, where the hint is ignored
+        iterator insert(const_iterator, const value_type& v) {
+            return insert(v).first;
+        }
+
+        /// same as `insert(v)`, where the hint is ignored
+        iterator insert(const_iterator, value_type&& v) {
+            return insert(std::move(v)).first;
+        }
+
+        V& operator[](const K& k) {
+            return emplace(k, V{}).first->second;
+        }
+
+        /// Remove the entry of key `k`, where the last entry is moved into its position, returns the number of removed entries
+        std::size_t erase(const K& k) {
+            if(entries.empty()) {
+                return 0;
+            }
+
+            std::size_t i = probe(k);
+            if(slots[i] == 0) {
+                return 0;
+            }
+
+            std::size_t j = slots[i] - 1, mask = slots.size() - 1;
+
+            // backward shift deletion: move following entries of the probe sequence into the hole
+            slots[i] = 0;
+            for(std::size_t n = (i + 1) & mask; slots[n] != 0; n = (n + 1) & mask) {
+                std::size_t h = home(entries[slots[n] - 1].first);
+                if(((n - h) & mask) >= ((n - i) & mask)) {
+                    slots[i] = slots[n];
+                    slots[n] = 0;
+                    i = n;
+                }
+            }
+
+            if(std::size_t last = entries.size() - 1; j != last) {
+                slots[probe(entries[last].first)] = j + 1;
+                entries[j] = std::move(entries[last]);
+            }
+
+            entries.pop_back();
+            return 1;
+        }
+
+        bool operator==(const flat_hash_map& other) const {
+            return size() == other.size() && std::ranges::all_of(entries, [&other](const value_type& v) {
+                auto iter = other.find(v.first);
+                return iter != other.end() && iter->second == v.second;
+            });
+        }
+    };
+
+    /// @brief A map stored in a `std::vector<std::pair<K, V>>` sorted by keys, which is looked up by binary search.
+    ///
+    /// Besides inserting in order (`emplace`, `insert`), entries can be appended by `append_unordered` in bulk
+    /// and sorted at once by `restore_order`, which is done by decoding (ref to @ref emplace_decoder).
+    /// Same as `std::map::emplace`, inserting a key which already exists keeps the existing entry.
+    /// Keys must not be modified through iterators, and any insertion or erasure invalidates iterators.
+    template <typename K, typename V, typename Compare = std::less<K>>
+    class sorted_vector_map {
+    public:
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<K, V>;
+        using size_type = std::size_t;
+        using iterator = typename std::vector<value_type>::iterator;
+        using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    private:
+        std::vector<value_type> entries;
+
+        /// the length of prefix of entries which is sorted and free of duplicate keys
+        std::size_t ordered = 0;
+
+        [[no_unique_address]] Compare less;
+
+        bool key_less(const value_type& a, const value_type& b) const {
+            return less(a.first, b.first);
+        }
+
+        const_iterator lower_bound(const K& k) const {
+            return std::lower_bound(entries.begin(), entries.end(), k, [this](const value_type& v, const K& key) {
+                return less(v.first, key);
+            });
+        }
+
+        iterator lower_bound(const K& k) {
+            return entries.begin() + (std::as_const(*this).lower_bound(k) - entries.cbegin());
+        }
+
+    public:
+        sorted_vector_map() = default;
+
+        sorted_vector_map(std::initializer_list<value_type> list) : entries(list) {
+            restore_order();
+        }
+
+        iterator begin() {
+            return entries.begin();
+        }
+
+        iterator end() {
+            return entries.end();
+        }
+
+        const_iterator begin() const {
+            return entries.begin();
+        }
+
+        const_iterator end() const {
+            return entries.end();
+        }
+
+        std::size_t size() const {
+            return entries.size();
+        }
+
+        bool empty() const {
+            return entries.empty();
+        }
+
+        /// Remove all entries, keeping the capacity of storage
+        void clear() {
+            entries.clear();
+            ordered = 0;
+        }
+
+        void reserve(std::size_t n) {
+            entries.reserve(n);
+        }
+
+        /// @brief Append an entry without keeping entries sorted, which takes O(1).
+        ///
+        /// Lookups and ordered insertions are invalid until `restore_order()` is called.
+        template <typename KK, typename VV>
+        void append_unordered(KK&& k, VV&& v) {
+            entries.emplace_back(std::forward<KK>(k), std::forward<VV>(v));
+        }
+
+        /// @brief Sort entries appended by `append_unordered` into the map,
+        /// where the earliest entry of each key is kept, same as inserting them one by one
+        void restore_order() {
+            if(ordered == entries.size()) {
+                return;
+            }
+
+            auto cmp = [this](const value_type& a, const value_type& b) { return key_less(a, b); };
+            auto mid = entries.begin() + ordered;
+
+            std::stable_sort(mid, entries.end(), cmp);
+            std::inplace_merge(entries.begin(), mid, entries.end(), cmp);
+
+            auto last = std::unique(entries.begin(), entries.end(), [this](const value_type& a, const value_type& b) {
+                return !key_less(a, b) && !key_less(b, a);
+            });
+            entries.erase(last, entries.end());
+
+            ordered = entries.size();
+        }
+
+        iterator find(const K& k) {
+            auto iter = lower_bound(k);
+            return iter != end() && !less(k, iter->first) ? iter : end();
+        }
+
+        const_iterator find(const K& k) const {
+            auto iter = lower_bound(k);
+            return iter != end() && !less(k, iter->first) ? iter : end();
+        }
+
+        bool contains(const K& k) const {
+            return find(k) != end();
+        }
+
+        /// get the value of key `k`, throws `std::out_of_range` if it does not exist
+        V& at(const K& k) {
+            if(auto iter = find(k); iter != end()) {
+                return iter->second;
+            }
+
+            throw std::out_of_range("pp::sorted_vector_map::at");
+        }
+
+        /// get the value of key `k`, throws `std::out_of_range` if it does not exist
+        const V& at(const K& k) const {
+            if(auto iter = find(k); iter != end()) {
+                return iter->second;
+            }
+
+            throw std::out_of_range("pp::sorted_vector_map::at");
+        }
+
+        /// Insert an entry constructed from `k` and `v` at its sorted position if key `k` does not exist, which takes O(N)
+        template <typename KK, typename VV>
+        std::pair<iterator, bool> emplace(KK&& k, VV&& v) {
+            restore_order();
+
+            auto iter = lower_bound(k);
+            if(iter != end() && !less(k, iter->first)) {
+                return {iter, false};
+            }
+
+            iter = entries.emplace(iter, std::forward<KK>(k), std::forward<VV>(v));
+            ordered = entries.size();
+
+            return {iter, true};
+        }
+
+        std::pair<iterator, bool> insert(const value_type& v) {
+            return emplace(v.first, v.second);
+        }
+
+        std::pair<iterator, bool> insert(value_type&& v) {
+            return emplace(std::move(v.first), std::move(v.second));
+        }
+
+        /// same as `insert(v)`, where the hint is ignored
+        iterator insert(const_iterator, const value_type& v) {
+            return insert(v).first;
+        }
+
+        /// same as `insert(v)`, where the hint is ignored
+        iterator insert(const_iterator, value_type&& v) {
+            return insert(std::move(v)).first;
+        }
+
+        V& operator[](const K& k) {
+            return emplace(k, V{}).first->second;
+        }
+
+        /// Remove the entry of key `k`, returns the number of removed entries
+        std::size_t erase(const K& k) {
+            restore_order();
+
+            if(auto iter = find(k); iter != end()) {
+                entries.erase(iter);
+                ordered = entries.size();
+                return 1;
+            }
+
+            return 0;
+        }
+
+        bool operator==(const sorted_vector_map& other) const {
+            return entries == other.entries;
+        }
+    };
+
+}
+
+#endif //PROTOPUF_FLAT_MAP_H
@@ -15,6 +15,7 @@
 #ifndef PROTOPUF_FLOAT_H
 #define PROTOPUF_FLOAT_H
 
+#include <bit>
 #include <concepts>
 #include "coder.h"
 #include "int.h"
@@ -30,11 +31,11 @@ namespace pp {
         using underlying_type = uint<sizeof(T)>;
 
         static constexpr underlying_type underlying_cast(value_type t) {
-            return *(underlying_type*)&t;
+            return std::bit_cast<underlying_type>(t);
         }
 
         static constexpr value_type value_cast(underlying_type t) {
-            return *(value_type*)&t;
+            return std::bit_cast<value_type>(t);
         }
 
     public:
@@ -49,6 +50,15 @@ namespace pp {
 
             return {value_cast(p.first), p.second};
         }
+
+        static constexpr checked_decode_result<T> checked_decode(bytes b) {
+            auto p = integer_coder<underlying_type>::checked_decode(b);
+            if(!p) {
+                return p.error();
+            }
+
+            return decode_result<T>{value_cast(p->first), p->second};
+        }
     };
 
     template <std::size_t N>
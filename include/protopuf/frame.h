@@ -0,0 +1,379 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_FRAME_H
+#define PROTOPUF_FRAME_H
+
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "batch.h"
+#include "message.h"
+#include "sink.h"
+
+#if __has_include(<sys/mman.h>) && __has_include(<fcntl.h>) && __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PROTOPUF_HAS_MMAP 1
+#endif
+
+namespace pp {
+
+    /// @brief Get the number of bytes still missing from `b` to hold the first whole frame, i.e. a varint length followed by the message.
+    /// @returns `0` if the first frame is complete in `b`, otherwise a lower bound of the missing bytes (exact once the length is complete),
+    /// or the @ref decode_error if the length is malformed or exceeds `max_size`
+    inline constexpr checked_result<std::size_t> missing_frame_bytes(bytes b, std::size_t max_size = std::numeric_limits<std::size_t>::max()) {
+        auto r = varint_coder<uint<8>>::checked_decode(b);
+        if(!r) {
+            return r.error() == decode_error::truncated ? checked_result<std::size_t>(1) : r.error();
+        }
+
+        const auto& [len, payload] = *r;
+        if(len > max_size) {
+            return decode_error::length_overflow;
+        }
+
+        return len > payload.size() ? std::size_t(len - payload.size()) : 0;
+    }
+
+    /// @brief A writer of messages of type `T` as length-delimited frames into a @ref sink `S`,
+    /// where every frame is a varint length followed by the message, same as `writeDelimitedTo` of protobuf.
+    ///
+    /// Every frame is sized into a reused @ref size_cache and written with one reservation of the sink,
+    /// so writes are batched by the sink, i.e. a @ref callback_sink hands whole buffers to a file or socket.
+    template <message_c T, sink S>
+    class frame_writer {
+        S& out;
+        size_cache cache;
+        std::size_t frames = 0;
+        std::size_t total = 0;
+
+    public:
+        /// Construct a writer appending frames to `out`, which must outlive the writer
+        explicit frame_writer(S& out) : out(out) {}
+
+        /// Write `msg` as a frame, returns the number of bytes written
+        std::size_t write(const T& msg) {
+            cache.clear();
+            auto n = skipper<embedded_message_coder<T>>::encode_skip(msg, cache);
+
+            embedded_message_coder<T>::encode(msg, out.reserve(n), cache);
+            out.commit(n);
+
+            ++frames;
+            total += n;
+            return n;
+        }
+
+        /// Write all messages in `r` as frames with one reservation, returns the number of bytes written
+        template <message_range<T> R>
+        std::size_t write_all(const R& r) {
+            auto n = batch_coder<T>::encode(r, out);
+
+            frames += std::ranges::distance(r);
+            total += n;
+            return n;
+        }
+
+        /// The number of frames written
+        std::size_t count() const {
+            return frames;
+        }
+
+        /// The number of bytes written
+        std::size_t size() const {
+            return total;
+        }
+    };
+
+    /// @brief A reader of length-delimited frames of messages of type `T` from a contiguous buffer, i.e. a file loaded or mapped into memory.
+    ///
+    /// Messages are decoded directly from the buffer without copying frames,
+    /// so that view fields (ref to @ref basic_string_view_coder) refer to the buffer, which must outlive decoded messages.
+    /// Reading stops at the first malformed or truncated frame, ref to `error()`.
+    template <message_c T>
+    class frame_reader {
+        bytes rest;
+        std::pmr::memory_resource* mr;
+        std::optional<decode_error> err;
+
+    public:
+        /// Construct a reader over frames in `b`, where decoded values allocate from `mr` if not null
+        explicit frame_reader(bytes b, std::pmr::memory_resource* mr = nullptr) : rest(b), mr(mr) {}
+
+        /// Get the bytes of the next message without decoding it, or `std::nullopt` at the end or error
+        std::optional<bytes> next_frame() {
+            if(err || rest.empty()) {
+                return std::nullopt;
+            }
+
+            auto r = varint_coder<uint<8>>::checked_decode(rest);
+            if(!r) {
+                err = r.error();
+                return std::nullopt;
+            }
+
+            auto [len, payload] = *r;
+            if(len > payload.size()) {
+                err = decode_error::length_overflow;
+                return std::nullopt;
+            }
+
+            rest = payload.subspan(len);
+            return payload.subspan(0, len);
+        }
+
+        /// Decode the next message, or `std::nullopt` at the end or error
+        std::optional<T> next() {
+            auto f = next_frame();
+            if(!f) {
+                return std::nullopt;
+            }
+
+            T v = make_with_resource<T>(mr);
+            if(auto r = message_coder<T>::checked_decode(v, *f, mr); !r) {
+                err = r.error();
+                return std::nullopt;
+            }
+
+            return v;
+        }
+
+        /// Decode the next message into `v` reusing its storage (ref to `message_coder<T>::decode_reuse`), returns `false` at the end or error
+        bool next(T& v) {
+            auto f = next_frame();
+            if(!f) {
+                return false;
+            }
+
+            if(auto r = message_coder<T>::checked_decode_reuse(v, *f, mr); !r) {
+                err = r.error();
+                return false;
+            }
+
+            return true;
+        }
+
+        /// Whether all frames are read without error
+        bool done() const {
+            return !err && rest.empty();
+        }
+
+        /// The bytes not read yet
+        bytes remaining() const {
+            return rest;
+        }
+
+        /// The error which stopped reading, if any
+        std::optional<decode_error> error() const {
+            return err;
+        }
+    };
+
+    /// @brief A resumable reader of length-delimited frames of messages of type `T` over incremental input, i.e. partial reads from a socket.
+    ///
+    /// Complete frames are decoded directly from the fed segments,
+    /// and only a frame straddling segment boundaries is copied into an internal buffer until it is complete (ref to @ref stream_decoder).
+    /// Since fed bytes are not referenced after `feed` returns, `T` should not contain view fields.
+    template <message_c T>
+    class frame_stream {
+        std::vector<std::byte> pending;
+        std::size_t max_size;
+        std::optional<decode_error> err;
+
+        template <typename F>
+        bool decode_frame(bytes b, F& f) {
+            auto r = embedded_message_coder<T>::checked_decode(b);
+            if(!r) {
+                err = r.error();
+                return false;
+            }
+
+            f(std::move(r->first));
+            return true;
+        }
+
+    public:
+        /// Construct a reader rejecting frames longer than `max_size` bytes, i.e. to bound memory of a malformed length
+        explicit frame_stream(std::size_t max_size = std::numeric_limits<std::size_t>::max()) : max_size(max_size) {}
+
+        /// @brief Feed the next segment of input bytes `b`, invoking `f` with every completed message (as an rvalue) in order.
+        /// @returns `false` if the input is malformed, ref to `error()`
+        template <std::invocable<T&&> F>
+        bool feed(bytes b, F&& f) {
+            if(err) {
+                return false;
+            }
+
+            while(!pending.empty() && !b.empty()) {
+                auto need = missing_frame_bytes(pending, max_size);
+                if(!need) {
+                    err = need.error();
+                    return false;
+                }
+
+                auto take = std::min(*need, b.size());
+                pending.insert(pending.end(), b.begin(), b.begin() + take);
+                b = b.subspan(take);
+
+                need = missing_frame_bytes(pending, max_size);
+                if(!need) {
+                    err = need.error();
+                    return false;
+                }
+
+                if(*need == 0) {
+                    if(!decode_frame(pending, f)) {
+                        return false;
+                    }
+
+                    pending.clear();
+                }
+            }
+
+            while(!b.empty()) {
+                auto need = missing_frame_bytes(b, max_size);
+                if(!need) {
+                    err = need.error();
+                    return false;
+                }
+
+                if(*need > 0) {
+                    pending.assign(b.begin(), b.end());
+                    break;
+                }
+
+                auto len = varint_coder<uint<8>>::decode(b);
+                auto size = b.size() - len.second.size() + len.first;
+
+                if(!decode_frame(b.subspan(0, size), f)) {
+                    return false;
+                }
+
+                b = b.subspan(size);
+            }
+
+            return true;
+        }
+
+        /// Whether all fed bytes are decoded, i.e. the input may end here
+        bool at_boundary() const {
+            return !err && pending.empty();
+        }
+
+        /// The number of bytes buffered for a frame straddling segment boundaries
+        std::size_t buffered() const {
+            return pending.size();
+        }
+
+        /// The error which stopped reading, if any
+        std::optional<decode_error> error() const {
+            return err;
+        }
+    };
+
+#ifdef PROTOPUF_HAS_MMAP
+
+    /// @brief A file mapped into memory (POSIX `mmap`), i.e. to replay a large capture file with @ref frame_reader at disk speed.
+    ///
+    /// The file is opened read-only, but the mapping is a writable private (copy-on-write) view,
+    /// since decoders take mutable @ref bytes: writes through `data()` copy the touched pages and never reach the file.
+    class mapped_file {
+        std::byte* ptr = nullptr;
+        std::size_t len = 0;
+        bool ok = false;
+
+        void reset() {
+            if(ptr) {
+                ::munmap(ptr, len);
+            }
+
+            ptr = nullptr;
+            len = 0;
+            ok = false;
+        }
+
+    public:
+        mapped_file() = default;
+
+        /// Map the whole file at `path`, check `is_open()` for failure
+        explicit mapped_file(const char* path) {
+            int fd = ::open(path, O_RDONLY);
+            if(fd < 0) {
+                return;
+            }
+
+            struct ::stat st{};
+            if(::fstat(fd, &st) == 0) {
+                len = std::size_t(st.st_size);
+
+                if(len == 0) {
+                    ok = true;
+                } else if(void* p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0); p != MAP_FAILED) {
+                    ptr = static_cast<std::byte*>(p);
+                    ok = true;
+                    ::madvise(p, len, MADV_SEQUENTIAL);
+                } else {
+                    len = 0;
+                }
+            }
+
+            ::close(fd);
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        mapped_file(mapped_file&& other) noexcept
+            : ptr(std::exchange(other.ptr, nullptr)), len(std::exchange(other.len, 0)), ok(std::exchange(other.ok, false)) {}
+
+        mapped_file& operator=(mapped_file&& other) noexcept {
+            if(this != &other) {
+                reset();
+                ptr = std::exchange(other.ptr, nullptr);
+                len = std::exchange(other.len, 0);
+                ok = std::exchange(other.ok, false);
+            }
+
+            return *this;
+        }
+
+        ~mapped_file() {
+            reset();
+        }
+
+        /// Whether the file is mapped successfully
+        bool is_open() const {
+            return ok;
+        }
+
+        /// Bytes of the whole file
+        bytes data() const {
+            return {ptr, len};
+        }
+
+        /// The length of the file
+        std::size_t size() const {
+            return len;
+        }
+    };
+
+#endif
+
+}
+
+#endif //PROTOPUF_FRAME_H
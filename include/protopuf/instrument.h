@@ -0,0 +1,190 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_INSTRUMENT_H
+#define PROTOPUF_INSTRUMENT_H
+
+#include "reflection.h"
+
+#include <array>
+#include <chrono>
+#include <memory_resource>
+
+namespace pp {
+
+    /// Counters of encoding and decoding a message type, collected by @ref counting_instrument
+    struct instrument_counters {
+        /// the number of messages encoded
+        std::size_t encoded = 0;
+
+        /// the number of messages decoded
+        std::size_t decoded = 0;
+
+        /// the number of bytes written while encoding
+        std::size_t bytes_encoded = 0;
+
+        /// the number of bytes consumed while decoding
+        std::size_t bytes_decoded = 0;
+
+        /// the number of fields decoded
+        std::size_t fields_decoded = 0;
+
+        /// the number of fields skipped, i.e. unknown fields and fields not selected by `decode_only`
+        std::size_t fields_skipped = 0;
+
+        /// the number of allocations from @ref counting_resource
+        std::size_t allocations = 0;
+
+        /// the number of bytes allocated from @ref counting_resource
+        std::size_t bytes_allocated = 0;
+
+        /// time spent in encoding, including embedded messages
+        std::chrono::nanoseconds encode_time{};
+
+        /// time spent in decoding, including embedded messages
+        std::chrono::nanoseconds decode_time{};
+    };
+
+    /// Statistics of message type `T` collected by @ref counting_instrument, with per-field counters
+    template <message_c T>
+    struct message_stats;
+
+    template <field_c... F>
+    struct message_stats<message<F...>> {
+        /// counters of the message type
+        instrument_counters counters;
+
+        /// the number of times each field (in declaration order) is decoded
+        std::array<std::size_t, sizeof...(F)> field_decoded{};
+
+        /// the number of bytes each field (in declaration order) is decoded from, including keys
+        std::array<std::size_t, sizeof...(F)> field_bytes{};
+
+        /// get the index of field by field `name` in declaration order via @ref dynamic_lookup, or `sizeof...(F)` if not found
+        static constexpr std::size_t index_of(const auto& name) {
+            return dynamic_lookup<field_name, F...>::find(name);
+        }
+
+        /// get the number of times the field named `name` is decoded
+        constexpr std::size_t decoded_count(const auto& name) const {
+            auto i = index_of(name);
+            return i < sizeof...(F) ? field_decoded[i] : 0;
+        }
+
+        /// get the number of bytes the field named `name` is decoded from
+        constexpr std::size_t decoded_bytes(const auto& name) const {
+            auto i = index_of(name);
+            return i < sizeof...(F) ? field_bytes[i] : 0;
+        }
+    };
+
+    /// @brief An instrumentation policy counting bytes, fields, allocations and time per message type into @ref message_stats,
+    /// where statistics are thread-local.
+    ///
+    /// Select it for message types via @ref message_instrument, i.e.
+    /// `template <> struct pp::message_instrument<Class> { using type = pp::counting_instrument; };`.
+    struct counting_instrument : no_instrument {
+        using clock = std::chrono::steady_clock;
+
+        struct scope {
+            clock::time_point start;
+            instrument_counters* parent;
+        };
+
+        /// get the statistics of message type `T` in the current thread
+        template <message_c T>
+        static message_stats<T>& stats() {
+            thread_local message_stats<T> res;
+            return res;
+        }
+
+        /// get the counters of the innermost message being encoded or decoded in the current thread, or null if none
+        static instrument_counters*& current() {
+            thread_local instrument_counters* res = nullptr;
+            return res;
+        }
+
+        template <message_c T>
+        static scope enter(instrument_event) {
+            scope s{clock::now(), current()};
+            current() = &stats<T>().counters;
+
+            return s;
+        }
+
+        template <message_c T>
+        static void exit(instrument_event e, scope s, std::size_t n) {
+            auto& c = stats<T>().counters;
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - s.start);
+
+            if(e == instrument_event::encode) {
+                ++c.encoded;
+                c.bytes_encoded += n;
+                c.encode_time += elapsed;
+            } else {
+                ++c.decoded;
+                c.bytes_decoded += n;
+                c.decode_time += elapsed;
+            }
+
+            current() = s.parent;
+        }
+
+        template <message_c T>
+        static void field_decoded(std::size_t i, std::size_t n) {
+            auto& s = stats<T>();
+
+            ++s.counters.fields_decoded;
+            ++s.field_decoded[i];
+            s.field_bytes[i] += n;
+        }
+
+        template <message_c T>
+        static void field_skipped(uint<4>, std::size_t) {
+            ++stats<T>().counters.fields_skipped;
+        }
+    };
+
+    /// @brief A memory resource which counts allocations into the innermost message being decoded by @ref counting_instrument,
+    /// and allocates from an upstream resource.
+    ///
+    /// Only values allocating from the memory resource passed to decoding are counted, i.e. @ref pmr_string_field.
+    class counting_resource : public std::pmr::memory_resource {
+        std::pmr::memory_resource* upstream;
+
+    public:
+        explicit counting_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) : upstream(upstream) {}
+
+    private:
+        void* do_allocate(std::size_t n, std::size_t align) override {
+            if(auto c = counting_instrument::current()) {
+                ++c->allocations;
+                c->bytes_allocated += n;
+            }
+
+            return upstream->allocate(n, align);
+        }
+
+        void do_deallocate(void* p, std::size_t n, std::size_t align) override {
+            upstream->deallocate(p, n, align);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+}
+
+#endif //PROTOPUF_INSTRUMENT_H
@@ -17,6 +17,10 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
+#include <array>
+#include <bit>
+#include <concepts>
 #include "coder.h"
 #include "byte.h"
 
@@ -107,61 +111,104 @@ namespace pp {
     template <typename T>
     concept integral64 = sized_integral<T, 8>;
 
-    /// Construct a `std::array<T, N>` from values of a `std::span<T, N>`
-    template <typename T, std::size_t N>
-    constexpr auto make_array(std::span<T, N> s) {
-        return [&s] <std::size_t ...I> (std::index_sequence<I...>) {
-            return std::array<T, N> { s[I]... };
-        }(std::make_index_sequence<N>{});
+    static_assert(std::endian::native == std::endian::little || std::endian::native == std::endian::big,
+        "mixed-endian targets are not supported");
+
+    /// Whether the in-memory representation of integers differs from the little-endian wire format
+    inline constexpr bool needs_byteswap = std::endian::native == std::endian::big;
+
+    /// Reverse the byte order of an unsigned integer, i.e. `0x1122` to `0x2211`
+    template <std::unsigned_integral T>
+    constexpr T byteswap(T i) {
+    #if __cpp_lib_byteswap >= 202110L
+        return std::byteswap(i);
+    #elif defined(__GNUC__) || defined(__clang__)
+        if constexpr (sizeof(T) == 1) {
+            return i;
+        } else if constexpr (sizeof(T) == 2) {
+            return __builtin_bswap16(i);
+        } else if constexpr (sizeof(T) == 4) {
+            return __builtin_bswap32(i);
+        } else {
+            return __builtin_bswap64(i);
+        }
+    #else
+        T r = 0;
+        for(std::size_t k = 0; k < sizeof(T); ++k) {
+            r = static_cast<T>(r << 8 | (i & 0xff));
+            i >>= 8;
+        }
+
+        return r;
+    #endif
     }
 
-    /// Copy values of a `std::array<T, N>` to a `std::span<T, N>`
-    template <typename T, std::size_t N>
-    constexpr void copy_to_span(const std::array<T, N>& a, std::span<T, N> s) {
-        [&a, &s] <std::size_t ...I> (std::index_sequence<I...>) {
-            ((s[I] = a[I]), ...);
-        }(std::make_index_sequence<N>{});
+    /// Convert an unsigned integer between the host byte order and little endian (in either direction)
+    template <std::unsigned_integral T>
+    constexpr T to_little_endian(T i) {
+        if constexpr (needs_byteswap) {
+            return byteswap(i);
+        } else {
+            return i;
+        }
+    }
+
+    /// @brief Reverse the byte order of each `N`-byte integer stored back to back in `b`, in place.
+    ///
+    /// `b` may be unaligned and its size should be a multiple of `N`.
+    /// The loop has no dependency between elements, so optimizing compilers vectorize it into byte shuffles.
+    template <std::size_t N>
+    inline void byteswap_elements(bytes b) {
+        if constexpr (N > 1) {
+            auto p = b.data();
+            for(auto end = p + b.size() / N * N; p != end; p += N) {
+                uint<N> i;
+                std::memcpy(&i, p, N);
+                i = byteswap(i);
+                std::memcpy(p, &i, N);
+            }
+        }
     }
 
-    /// @brief Convert some bytes (with length `N`) to an unsigned integer `uint<N>`.
+    /// @brief Convert some bytes (with length `N`, in little endian) to an unsigned integer `uint<N>`.
     ///
+    /// It is a single load (followed by a byte swap on big-endian targets) while not in constant evaluation.
     /// @param bytes the input bytes (with length `N`) to be coverted
     /// @returns the coverted unsigned integer `uint<N>`
     template <std::size_t N>
     constexpr uint<N> bytes_to_int(sized_bytes<N> bytes) {
-    #if defined(INT_CONVERSION_RECURSIVE_IMPL) || !(__cpp_lib_bit_cast >= 201806L)
-        return bytes_to_int(bytes.template subspan<0, N/2>()) | bytes_to_int(bytes.template subspan<N/2>()) << N*4;
-    #elif defined(INT_CONVERSION_UB_IMPL)
-        return *reinterpret_cast<uint<N>*>(bytes.data());
-    #else
-        auto arr = make_array(bytes);
-        return std::bit_cast<uint<N>>(arr);
-    #endif
-    }
-    template <>
-    constexpr uint<1> bytes_to_int(sized_bytes<1> bytes) {
-        return static_cast<uint<1>>(bytes.front());
+        if(std::is_constant_evaluated()) {
+            uint<N> i = 0;
+            for(std::size_t k = 0; k < N; ++k) {
+                i |= static_cast<uint<N>>(std::to_integer<uint<N>>(bytes[k]) << k * 8);
+            }
+
+            return i;
+        }
+
+        uint<N> i;
+        std::memcpy(&i, bytes.data(), N);
+
+        return to_little_endian(i);
     }
 
-    /// @brief Convert an unsigned integer (with byte length `N`) into a byte sequence with length `N` (no ownership).
+    /// @brief Convert an unsigned integer (with byte length `N`) into a byte sequence with length `N` (no ownership), in little endian.
     ///
+    /// It is a single store (preceded by a byte swap on big-endian targets) while not in constant evaluation.
     /// @param i the unsigned integer to be converted
     /// @param bytes the byte sequence which the integer is converted into (with length `N`)
     template <std::size_t N>
     constexpr void int_to_bytes(uint<N> i, sized_bytes<N> bytes) {
-    #if defined(INT_CONVERSION_RECURSIVE_IMPL) || !(__cpp_lib_bit_cast >= 201806L)
-        int_to_bytes<N/2>(i, bytes.template subspan<0, N/2>());
-        int_to_bytes<N/2>(i >> N*4, bytes.template subspan<N/2>());
-    #elif defined(INT_CONVERSION_UB_IMPL)
-        *reinterpret_cast<uint<N>*>(bytes.data()) = i;
-    #else
-        auto arr = std::bit_cast<std::array<std::byte, N>>(i);
-        copy_to_span(arr, bytes);
-    #endif
-    }
-    template <>
-    constexpr void int_to_bytes(uint<1> i, sized_bytes<1> bytes) {
-        bytes.front() = static_cast<std::byte>(i);
+        if(std::is_constant_evaluated()) {
+            for(std::size_t k = 0; k < N; ++k) {
+                bytes[k] = static_cast<std::byte>(i >> k * 8);
+            }
+
+            return;
+        }
+
+        i = to_little_endian(i);
+        std::memcpy(bytes.data(), &i, N);
     }
 
     /// @brief Convert an unsigned integer (with byte length `N`) into an byte array with length `N` (with ownership).
@@ -169,13 +216,10 @@ namespace pp {
     /// @returns a byte array which contains the coverted integer (with length `N` and ownership)
     template <std::size_t N>
     constexpr auto int_to_bytes(uint<N> i) {
-    #if __cpp_lib_bit_cast >= 201806L && !(defined(INT_CONVERSION_RECURSIVE_IMPL) || defined(INT_CONVERSION_UB_IMPL))
-        return std::bit_cast<std::array<std::byte, N>>(i);
-    #else
-        std::array<std::byte, N> a;
-        int_to_bytes(i, std::span(a));
+        std::array<std::byte, N> a{};
+        int_to_bytes<N>(i, std::span(a));
+
         return a;
-    #endif
     }
 
     /// A @ref coder for fixed-length signed/unsigned integer
@@ -199,6 +243,14 @@ namespace pp {
         static constexpr decode_result<T> decode(bytes b) {
             return {bytes_to_int<N>(b.subspan<0, N>()), b.subspan<N>()};
         }
+
+        static constexpr checked_decode_result<T> checked_decode(bytes b) {
+            if(b.size() < N) {
+                return decode_error::truncated;
+            }
+
+            return decode(b);
+        }
     };
 
     template <std::signed_integral T>
@@ -215,6 +267,10 @@ namespace pp {
         static constexpr decode_result<T> decode(bytes b) {
             return integer_coder<std::make_unsigned_t<T>>::decode(b);
         }
+
+        static constexpr checked_decode_result<T> checked_decode(bytes b) {
+            return integer_coder<std::make_unsigned_t<T>>::checked_decode(b);
+        }
     };
 
 }
@@ -0,0 +1,198 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_LAZY_H
+#define PROTOPUF_LAZY_H
+
+#include <optional>
+#include "message.h"
+#include "view.h"
+
+namespace pp {
+
+    /// @brief An embedded message of type `T` which is parsed on first access.
+    ///
+    /// A lazy message decoded by @ref lazy_message_coder only records the encoded bytes of the sub-message,
+    /// which are parsed (with bounds checking) while `value()` is called the first time.
+    /// While it is not modified through non-const access, re-encoding copies the recorded bytes verbatim.
+    ///
+    /// Lifetime: same as @ref bytes_view_coder, the recorded bytes refer to the input bytes of decoding,
+    /// so the input buffer must be alive and unmodified until the message is parsed or no longer encoded.
+    /// Parsing on const access mutates internal state, so it is not thread-safe.
+    template <message_c T>
+    class lazy_message {
+        mutable std::optional<T> parsed;
+        mutable std::optional<decode_error> err;
+        std::optional<const_bytes> raw;
+
+        constexpr void parse() const {
+            if(parsed) {
+                return;
+            }
+
+            auto b = bytes(const_cast<std::byte*>(raw->data()), raw->size());
+            if(auto r = message_coder<T>::checked_decode(b)) {
+                parsed = std::move(r->first);
+            } else {
+                parsed.emplace();
+                err = r.error();
+            }
+        }
+
+    public:
+        /// Construct an empty (parsed) message
+        constexpr lazy_message() : parsed(std::in_place) {}
+
+        /// Construct from a parsed message
+        constexpr lazy_message(T v) : parsed(std::move(v)) {}
+
+        /// Construct from the encoded bytes (without the length prefix) of a message, which are not parsed until accessed
+        static constexpr lazy_message from_bytes(const_bytes b) {
+            lazy_message res;
+            res.parsed.reset();
+            res.raw = b;
+            return res;
+        }
+
+        /// Checks whether the message is parsed
+        constexpr bool is_parsed() const {
+            return parsed.has_value();
+        }
+
+        /// The recorded encoded bytes, unless the message is constructed from a parsed one or modified
+        constexpr std::optional<const_bytes> raw_bytes() const {
+            return raw;
+        }
+
+        /// The error while parsing the recorded bytes, in which case the parsed message is empty
+        constexpr std::optional<decode_error> parse_error() const {
+            parse();
+            return err;
+        }
+
+        /// Get the message, parse it if it is not parsed yet
+        constexpr const T& value() const {
+            parse();
+            return *parsed;
+        }
+
+        /// Get the message for modification, so the recorded bytes are dropped and re-encoding encodes the message
+        constexpr T& value() {
+            parse();
+            raw.reset();
+            return *parsed;
+        }
+
+        constexpr const T& operator*() const {
+            return value();
+        }
+
+        constexpr T& operator*() {
+            return value();
+        }
+
+        constexpr const T* operator->() const {
+            return &value();
+        }
+
+        constexpr T* operator->() {
+            return &value();
+        }
+
+        constexpr bool operator==(const lazy_message& other) const {
+            return value() == other.value();
+        }
+    };
+
+    /// @brief A @ref coder for @ref lazy_message, which is compatible with @ref embedded_message_coder in the encoded form.
+    template <message_c T>
+    struct lazy_message_coder {
+        using value_type = lazy_message<T>;
+
+        lazy_message_coder() = delete;
+
+        static constexpr bytes encode(const value_type& v, bytes b) {
+            if(auto raw = v.raw_bytes()) {
+                b = varint_coder<uint<8>>::encode(raw->size(), b);
+                return copy_bytes(raw->data(), raw->size(), b);
+            }
+
+            return embedded_message_coder<T>::encode(v.value(), b);
+        }
+
+        /// Encode `v` using sizes recorded by `skipper<lazy_message_coder<T>>::encode_skip(v, cache)`
+        static constexpr bytes encode(const value_type& v, bytes b, size_cache& cache) {
+            if(v.raw_bytes()) {
+                return encode(v, b);
+            }
+
+            return embedded_message_coder<T>::encode(v.value(), b, cache);
+        }
+
+        static constexpr decode_result<value_type> decode(bytes b) {
+            auto [r, n] = bytes_view_coder::decode(b);
+            return {value_type::from_bytes(r), n};
+        }
+
+        static constexpr checked_decode_result<value_type> checked_decode(bytes b) {
+            auto r = bytes_view_coder::checked_decode(b);
+            if(!r) {
+                return r.error();
+            }
+
+            return decode_result<value_type>{value_type::from_bytes(r->first), r->second};
+        }
+    };
+
+    template <message_c T>
+    struct skipper<lazy_message_coder<T>> {
+        using coder = lazy_message_coder<T>;
+        using value_type = lazy_message<T>;
+
+        static constexpr std::size_t encode_skip(const value_type& v) {
+            if(auto raw = v.raw_bytes()) {
+                return skipper<bytes_view_coder>::encode_skip(*raw);
+            }
+
+            return skipper<embedded_message_coder<T>>::encode_skip(v.value());
+        }
+
+        /// Same as `encode_skip(v)`, but records sizes of a parsed message into `cache`
+        static constexpr std::size_t encode_skip(const value_type& v, size_cache& cache) {
+            if(auto raw = v.raw_bytes()) {
+                return skipper<bytes_view_coder>::encode_skip(*raw);
+            }
+
+            return skipper<embedded_message_coder<T>>::encode_skip(v.value(), cache);
+        }
+
+        static constexpr bytes decode_skip(bytes b) {
+            return skipper<bytes_view_coder>::decode_skip(b);
+        }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            return skipper<bytes_view_coder>::checked_decode_skip(b);
+        }
+    };
+
+    template <message_c T>
+    struct wire_type_impl<lazy_message_coder<T>> : std::integral_constant<uint<1>, 2> {};
+
+    /// Type alias for embedded message fields which are parsed on first access, ref to @ref lazy_message
+    template <basic_fixed_string S, uint<4> N, typename T, attribute A = singular, typename Container = std::vector<lazy_message<T>>>
+    using lazy_message_field = field<S, N, lazy_message_coder<T>, A, Container>;
+
+}
+
+#endif //PROTOPUF_LAZY_H
@@ -15,7 +15,9 @@
 #ifndef PROTOPUF_MAP_H
 #define PROTOPUF_MAP_H
 
+#include <map>
 #include "message.h"
+#include "flat_map.h"
 
 namespace pp {
 
@@ -42,15 +44,27 @@ namespace pp {
             static_cast<const first_field &>(v.first), static_cast<const second_field &>(v.second)
         ) {}
 
+        /// construct from an entry of maps with mutable keys, i.e. @ref flat_hash_map
+        map_element(const std::pair<first_type, second_type>& v) : base_type(
+            static_cast<const first_field &>(v.first), static_cast<const second_field &>(v.second)
+        ) {}
+
         // workaround for MSVC error C2385
         using base_type_ = base_type;
         using base_type_::base_type_;
 
-        operator pair_type() const {
+        operator pair_type() const & {
             return pair_type { 
                 this->template get<1>(), this->template get<2>() 
             };
         }
+
+        /// move fields into the pair, i.e. while inserting a decoded element into the map
+        operator pair_type() && {
+            return pair_type {
+                std::move(this->template get<1>()), std::move(this->template get<2>())
+            };
+        }
     };
 
     template <typename T1, typename T2>
@@ -59,6 +73,120 @@ namespace pp {
     template <typename T1, typename T2>
     struct message_decode_map<map_element<T1, T2>> : message_decode_map<typename map_element<T1, T2>::base_type> {};
 
+    /// @brief Decode map entries directly into the map, without building an intermediate @ref map_element and `std::pair`.
+    ///
+    /// The key and the value of each entry are decoded and emplaced into the map by `emplace(key, value)`,
+    /// or appended by `append_unordered(key, value)` if the map supports it (i.e. @ref sorted_vector_map),
+    /// which restores its order once after the message is decoded.
+    template <coder K, coder V>
+    struct emplace_decoder<embedded_message_coder<map_element<K, V>>> {
+        using element_type = map_element<K, V>;
+
+        using first_field = typename element_type::first_field;
+        using second_field = typename element_type::second_field;
+
+        using first_type = typename element_type::first_type;
+        using second_type = typename element_type::second_type;
+
+        template <typename M>
+        static constexpr void emplace(M& m, first_type&& k, second_type&& v) {
+            if constexpr (requires { m.append_unordered(std::move(k), std::move(v)); }) {
+                m.append_unordered(std::move(k), std::move(v));
+            } else {
+                m.emplace(std::move(k), std::move(v));
+            }
+        }
+
+        template <typename M> requires requires(M& m, first_type k, second_type v) { m.emplace(std::move(k), std::move(v)); }
+        static constexpr bytes decode(M& m, bytes b, std::pmr::memory_resource* mr = nullptr) {
+            std::size_t len = 0;
+            std::tie(len, b) = varint_coder<uint<8>>::decode(b);
+
+            // constructed on `mr` like the decoded keys and values, so that moving them in never crosses allocators
+            first_type k = make_with_resource<first_type>(mr);
+            second_type v = make_with_resource<second_type>(mr);
+
+            bytes e = b.subspan(0, len);
+            while(e.end() > e.begin()) {
+                const auto &[n, nb] = varint_coder<uint<4>>::decode(e);
+
+                if(n == first_field::key) {
+                    auto [x, r] = resource_decode<K>(nb, mr);
+                    k = std::move(x);
+                    e = r;
+                } else if(n == second_field::key) {
+                    auto [x, r] = resource_decode<V>(nb, mr);
+                    v = std::move(x);
+                    e = r;
+                } else if(auto r = skip_wire(to_wire_key(n), nb); r && to_field_number(n) != 0) {
+                    e = *r;
+                } else {
+                    break;
+                }
+            }
+
+            emplace(m, std::move(k), std::move(v));
+            return b.subspan(len);
+        }
+
+        template <typename M> requires requires(M& m, first_type k, second_type v) { m.emplace(std::move(k), std::move(v)); }
+        static constexpr checked_result<bytes> checked_decode(M& m, bytes b, std::pmr::memory_resource* mr = nullptr) {
+            auto lr = varint_coder<uint<8>>::checked_decode(b);
+            if(!lr) {
+                return lr.error();
+            }
+
+            auto [len, rest] = *lr;
+            if(len > rest.size()) {
+                return decode_error::length_overflow;
+            }
+
+            first_type k = make_with_resource<first_type>(mr);
+            second_type v = make_with_resource<second_type>(mr);
+
+            bytes e = rest.subspan(0, len);
+            while(e.end() > e.begin()) {
+                auto kr = varint_coder<uint<4>>::checked_decode(e);
+                if(!kr) {
+                    return kr.error();
+                }
+
+                const auto &[n, nb] = *kr;
+                if(to_field_number(n) == 0) {
+                    break;
+                }
+
+                if(n == first_field::key) {
+                    auto r = resource_checked_decode<K>(nb, mr);
+                    if(!r) {
+                        return r.error();
+                    }
+
+                    k = std::move(r->first);
+                    e = r->second;
+                } else if(n == second_field::key) {
+                    auto r = resource_checked_decode<V>(nb, mr);
+                    if(!r) {
+                        return r.error();
+                    }
+
+                    v = std::move(r->first);
+                    e = r->second;
+                } else {
+                    auto r = checked_skip_wire(to_wire_key(n), nb);
+                    if(!r) {
+                        return r.error();
+                    }
+
+                    e = *r;
+                }
+            }
+
+            emplace(m, std::move(k), std::move(v));
+            return rest.subspan(len);
+        }
+    };
+
     /// Type alias for map fields
     template<basic_fixed_string S, uint<4> N, coder key_coder, coder value_coder,
         typename Container = std::map<
@@ -68,6 +196,27 @@ namespace pp {
     >
     using map_field = message_field<S, N, map_element<key_coder, value_coder>, repeated, Container>;
 
+    /// Type alias for map fields stored in @ref flat_hash_map
+    template<basic_fixed_string S, uint<4> N, coder key_coder, coder value_coder>
+    using hash_map_field = map_field<S, N, key_coder, value_coder, flat_hash_map<
+        typename map_element<key_coder, value_coder>::first_type,
+        typename map_element<key_coder, value_coder>::second_type
+    >>;
+
+    /// Type alias for map fields stored in @ref sorted_vector_map, which is sorted once after decoding
+    template<basic_fixed_string S, uint<4> N, coder key_coder, coder value_coder>
+    using sorted_map_field = map_field<S, N, key_coder, value_coder, sorted_vector_map<
+        typename map_element<key_coder, value_coder>::first_type,
+        typename map_element<key_coder, value_coder>::second_type
+    >>;
+
+    /// Type alias for map fields stored in `std::pmr::map`
+    template<basic_fixed_string S, uint<4> N, coder key_coder, coder value_coder>
+    using pmr_map_field = map_field<S, N, key_coder, value_coder, std::pmr::map<
+        typename map_element<key_coder, value_coder>::first_type,
+        typename map_element<key_coder, value_coder>::second_type
+    >>;
+
 }
 
 #endif //PROTOPUF_MAP_H
@@ -16,11 +16,16 @@
 #define PROTOPUF_MESSAGE_H
 
 #include "coder.h"
+#include "compact.h"
 #include "field.h"
 #include "float.h"
+#include "sink.h"
 
-#include <unordered_map>
-#include <functional>
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <ranges>
+#include <vector>
 
 namespace pp {
 
@@ -78,28 +83,139 @@ namespace pp {
 
     /// @brief The message type
     /// @param T the field types of the message, where all `T::name_type::value_type` are equal
+    ///
+    /// Fields are stored as (private) bases of the message,
+    /// except @ref compact_storable fields of a message in the compact layout, ref to @ref compact_layout.
     template <field_c ... T> requires are_same<typename T::name_type::value_type...>
-    struct message : private T... {
+    struct message : private field_slot<compact_layout<message<T...>>::value, T>...,
+                     private compact_storage_of<compact_layout<message<T...>>::value, T...> {
+    private:
+        /// whether the message is in the compact layout
+        static constexpr bool compact = compact_layout<message>::value;
+
+        using storage_type = compact_storage_of<compact, T...>;
+
+        /// Checks whether field `F` is stored in @ref compact_storage of the message
+        template <field_c F>
+        static constexpr bool stored_compact = !std::same_as<field_slot<compact, F>, F>;
+
+        /// the index of field `F` in @ref compact_storage of the message
+        template <field_c F>
+        static constexpr std::size_t compact_index = [] {
+            std::size_t i = 0, res = 0;
+            ([&] {
+                if(std::same_as<F, T>) {
+                    res = i;
+                }
+                i += stored_compact<T>;
+            }(), ...);
+
+            return res;
+        }();
+
+        /// get field `F` as a reference to the field, or a @ref compact_field_ref if it is stored compactly
+        template <field_c F>
+        constexpr decltype(auto) field_ref() const {
+            if constexpr (stored_compact<F>) {
+                return compact_field_ref<F, const storage_type, compact_index<F>>(static_cast<const storage_type&>(*this));
+            } else {
+                return static_cast<const F&>(*this);
+            }
+        }
+
+        template <field_c F>
+        constexpr decltype(auto) field_ref() {
+            if constexpr (stored_compact<F>) {
+                return compact_field_ref<F, storage_type, compact_index<F>>(static_cast<storage_type&>(*this));
+            } else {
+                return static_cast<F&>(*this);
+            }
+        }
+
+        /// set the value of field `F` from `v` if it is stored compactly, where other fields are constructed from `v` directly
+        template <field_c F, typename U>
+        constexpr void init_compact(U&& v) {
+            if constexpr (stored_compact<F>) {
+                field_ref<F>() = F(std::forward<U>(v));
+            }
+        }
+
+        template <field_c F>
+        constexpr bool field_equal(const message& other) const {
+            if constexpr (stored_compact<F>) {
+                return field_ref<F>() == other.field_ref<F>();
+            } else {
+                return static_cast<const typename F::base_type&>(field_ref<F>()) ==
+                       static_cast<const typename F::base_type&>(other.field_ref<F>());
+            }
+        }
+
+        template <field_c F>
+        constexpr void clear_slot() {
+            auto&& f = field_ref<F>();
+            clear_field(f);
+        }
+
+        template <field_c F, typename M>
+        constexpr void merge_slot(M&& other) {
+            auto&& f = field_ref<F>();
+
+            if constexpr (stored_compact<F>) {
+                merge_field(f, other.template field_ref<F>());
+            } else {
+                merge_field(f, static_cast<type_forward<F, M&&>>(other));
+            }
+        }
+
+    public:
+        /// the type returned by `get` for field `F`: a reference to the field, or a @ref compact_field_ref if it is stored compactly
+        template <field_c F>
+        using reference = decltype(std::declval<message&>().template field_ref<F>());
+
+        /// the type returned by `get` for field `F` of a const message
+        template <field_c F>
+        using const_reference = decltype(std::declval<const message&>().template field_ref<F>());
 
         constexpr message() = default;
 
-        constexpr explicit message(T&& ...v) : T(std::move(v))... {};
-        constexpr explicit message(const T& ...v) : T(v)... {};
+        constexpr explicit message(T&& ...v) requires (sizeof...(T) > 0) : field_slot<compact, T>(std::move(v))... {
+            (init_compact<T>(std::move(v)), ...);
+        };
+
+        constexpr explicit message(const T& ...v) requires (sizeof...(T) > 0) : field_slot<compact, T>(v)... {
+            (init_compact<T>(v), ...);
+        };
 
-        constexpr message(const message& other) : T(static_cast<const T&>(other))... {}
-        constexpr message(message&& other) noexcept : T(static_cast<T&&>(other))... {}
+        constexpr message(const message& other) :
+            field_slot<compact, T>(static_cast<const field_slot<compact, T>&>(other))...,
+            storage_type(static_cast<const storage_type&>(other)) {}
+
+        constexpr message(message&& other) noexcept :
+            field_slot<compact, T>(static_cast<field_slot<compact, T>&&>(other))...,
+            storage_type(static_cast<storage_type&&>(other)) {}
 
         template <typename... U>
-            requires (sizeof...(T) == sizeof...(U) && !are_same<message, std::remove_reference_t<U>...> )
-        constexpr explicit message(U&& ...v) : T(std::forward<U>(v))... {};
+            requires (sizeof...(T) == sizeof...(U) && !are_same<message, std::remove_reference_t<U>...> &&
+                      (!std::same_as<std::remove_cvref_t<U>, std::allocator_arg_t> && ...))
+        constexpr explicit message(U&& ...v) : field_slot<compact, T>(std::forward<U>(v))... {
+            (init_compact<T>(std::forward<U>(v)), ...);
+        };
+
+        /// @brief Construct an empty message, where every allocator-aware container of fields is constructed with `alloc`,
+        /// ref to uses-allocator construction (`std::make_obj_using_allocator`)
+        template <std::same_as<std::allocator_arg_t> Tag, typename A>
+        constexpr message(Tag, const A& alloc) :
+            field_slot<compact, T>(std::make_obj_using_allocator<typename T::base_type>(alloc))... {}
 
         constexpr message& operator=(const message& other) {
-            ((static_cast<T&>(*this) = static_cast<const T&>(other)), ...);
+            ((static_cast<field_slot<compact, T>&>(*this) = static_cast<const field_slot<compact, T>&>(other)), ...);
+            static_cast<storage_type&>(*this) = static_cast<const storage_type&>(other);
             return *this;
         }
 
         constexpr message& operator=(message&& other) noexcept {
-            ((static_cast<T&>(*this) = static_cast<T&&>(other)), ...);
+            ((static_cast<field_slot<compact, T>&>(*this) = static_cast<field_slot<compact, T>&&>(other)), ...);
+            static_cast<storage_type&>(*this) = static_cast<storage_type&&>(other);
             return *this;
         }
 
@@ -117,25 +233,25 @@ namespace pp {
         /// get a field by the field number
         template <uint<4> N>
         constexpr decltype(auto) get() const {
-            return static_cast<const field_number_selector<N, T...>&>(*this);
+            return field_ref<field_number_selector<N, T...>>();
         }
 
         /// get a field by the field name
         template <basic_fixed_string S>
         constexpr decltype(auto) get() const {
-            return static_cast<const field_name_selector<S, T...>&>(*this);
+            return field_ref<field_name_selector<S, T...>>();
         }
 
         /// get a field by the field number
         template <uint<4> N>
         constexpr decltype(auto) get() {
-            return static_cast<field_number_selector<N, T...>&>(*this);
+            return field_ref<field_number_selector<N, T...>>();
         }
 
         /// get a field by the field name
         template <basic_fixed_string S>
         constexpr decltype(auto) get() {
-            return static_cast<field_name_selector<S, T...>&>(*this);
+            return field_ref<field_name_selector<S, T...>>();
         }
 
         /// get a field by the field number, i.e. `msg[233_i]`
@@ -162,35 +278,32 @@ namespace pp {
             return get<F>();
         }
 
-        /// get a field as its @ref field::base_type by the field number
+        /// get a field as its @ref field::base_type by the field number, or the @ref compact_field_ref if it is stored compactly
         template <uint<4> N>
         constexpr decltype(auto) get_base() const {
-            return static_cast<const typename field_number_selector<N, T...>::base_type&>(get<N>());
+            return base_ref<field_number_selector<N, T...>>(get<N>());
         }
 
-        /// get a field as its @ref field::base_type by the field name
+        /// get a field as its @ref field::base_type by the field name, or the @ref compact_field_ref if it is stored compactly
         template <basic_fixed_string S>
         constexpr decltype(auto) get_base() const {
-            return static_cast<const typename field_name_selector<S, T...>::base_type&>(get<S>());
+            return base_ref<field_name_selector<S, T...>>(get<S>());
         }
 
-        /// get a field as its @ref field::base_type by the field number
+        /// get a field as its @ref field::base_type by the field number, or the @ref compact_field_ref if it is stored compactly
         template <uint<4> N>
         constexpr decltype(auto) get_base() {
-            return static_cast<typename field_number_selector<N, T...>::base_type&>(get<N>());
+            return base_ref<field_number_selector<N, T...>>(get<N>());
         }
 
-        /// get a field as its @ref field::base_type by the field name
+        /// get a field as its @ref field::base_type by the field name, or the @ref compact_field_ref if it is stored compactly
         template <basic_fixed_string S>
         constexpr decltype(auto) get_base() {
-            return static_cast<typename field_name_selector<S, T...>::base_type&>(get<S>());
+            return base_ref<field_name_selector<S, T...>>(get<S>());
         }
 
         constexpr bool operator==(const message & other) const {
-            return ((
-                    static_cast<const typename T::base_type&>(static_cast<const T&>(*this)) ==
-                    static_cast<const typename T::base_type&>(static_cast<const T&>(other))
-                    ) && ...);
+            return (field_equal<T>(other) && ...);
         }
 
         constexpr bool operator!=(const message & other) const {
@@ -198,27 +311,34 @@ namespace pp {
         }
 
         /// iterate all fields and apply function `f` to them
-        template <typename F> requires (std::invocable<F, T> && ...)
+        template <typename F> requires (std::invocable<F, const_reference<T>> && ...)
         constexpr void for_each(F&& f) const {
-            (std::forward<F>(f)(static_cast<const T&>(*this)), ...);
+            (std::forward<F>(f)(field_ref<T>()), ...);
         }
 
         /// iterate all fields and apply function `f` to them
-        template <typename F> requires (std::invocable<F, T> && ...)
+        template <typename F> requires (std::invocable<F, reference<T>> && ...)
         constexpr void for_each(F&& f) {
-            (std::forward<F>(f)(static_cast<T&>(*this)), ...);
+            (std::forward<F>(f)(field_ref<T>()), ...);
         }
 
         /// same as `f(f(...f(f(init, field1), field2), ...), fieldN)`
         template <typename F, typename U>
         constexpr auto fold(F&& f, U&& init) const {
-            return (fold_impl{ std::forward<U>(init), std::forward<F>(f) } + ... + static_cast<const T&>(*this)).v;
+            return (fold_impl{ std::forward<U>(init), std::forward<F>(f) } + ... + field_ref<T>()).v;
         }
 
         /// same as `f(f(...f(f(init, field1), field2), ...), fieldN)`
         template <typename F, typename U>
         constexpr auto fold(F&& f, U&& init) {
-            return (fold_impl{ std::forward<U>(init), std::forward<F>(f) } + ... + static_cast<T&>(*this)).v;
+            return (fold_impl{ std::forward<U>(init), std::forward<F>(f) } + ... + field_ref<T>()).v;
+        }
+
+        /// @brief Empty all fields: singular fields are reset, containers of other fields are cleared while keeping their capacity.
+        ///
+        /// To reuse storage of values (i.e. strings) besides containers, decode into the message by `message_coder<message>::decode_reuse`.
+        constexpr void clear() {
+            (clear_slot<T>(), ...);
         }
 
         /// @brief Merge another message into this message, for all fields: overwrite if it is singular and non-empty, merge to end otherwise
@@ -226,7 +346,17 @@ namespace pp {
         /// same as `merge_field(field1, other.field1), ..., merge_field(fieldN, other.fieldN)`, ref to @ref merge_field
         template <typename M> requires std::same_as<std::remove_cvref_t<M>, message>
         constexpr void merge(M&& other) {
-            (merge_field(static_cast<T&>(*this), static_cast<type_forward<T, M&&>>(other)), ...);
+            (merge_slot<T>(std::forward<M>(other)), ...);
+        }
+
+    private:
+        template <field_c F, typename R>
+        static constexpr decltype(auto) base_ref(R&& f) {
+            if constexpr (stored_compact<F>) {
+                return std::remove_cvref_t<R>(f);
+            } else {
+                return static_cast<type_forward<typename F::base_type, R&&>>(f);
+            }
         }
     };
 
@@ -290,58 +420,1025 @@ namespace pp {
     template <uint<1> N>
     using wire_skip = typename wire_skip_impl<N>::type;
 
-    template <uint<1>... I>
-    struct message_skip_map_impl : std::unordered_map<uint<4>, std::function<bytes(bytes)>> {
-        message_skip_map_impl() : std::unordered_map<uint<4>, std::function<bytes(bytes)>> {
-                {I, [](bytes b){
-                    return wire_skip<I>::decode_skip(b);
-                }}...
-        } {}
+    /// @brief Skip a value of wire type `wire` from the bytes `b`, dispatched over @ref wire_skip
+    /// @returns the bytes after the skipped value, or `std::nullopt` if `wire` is not a valid wire type
+    inline constexpr std::optional<bytes> skip_wire(uint<1> wire, bytes b) {
+        switch(wire) {
+            case 0: return wire_skip<0>::decode_skip(b);
+            case 1: return wire_skip<1>::decode_skip(b);
+            case 2: return wire_skip<2>::decode_skip(b);
+            case 5: return wire_skip<5>::decode_skip(b);
+            default: return std::nullopt;
+        }
+    }
+
+    /// @brief Skip a value of wire type `wire` from the bytes `b` like @ref skip_wire does, but never reads past the end of `b`
+    /// @returns the bytes after the skipped value, or the @ref decode_error if the bytes are malformed
+    inline constexpr checked_result<bytes> checked_skip_wire(uint<1> wire, bytes b) {
+        switch(wire) {
+            case 0: return wire_skip<0>::checked_decode_skip(b);
+            case 1: return wire_skip<1>::checked_decode_skip(b);
+            case 2: return wire_skip<2>::checked_decode_skip(b);
+            case 5: return wire_skip<5>::checked_decode_skip(b);
+            default: return decode_error::bad_wire_type;
+        }
+    }
+
+    /// @brief Unknown fields preserved while decoding a message, stored as records of whole encoded fields (key and value)
+    ///
+    /// Records are views into the decoded bytes, so decoding copies nothing but a span per run of consecutive unknown fields,
+    /// and encoding re-emits each run by one `memcpy`.
+    /// The decoded bytes must outlive the set, otherwise call @ref own to copy all records into a buffer owned by the set.
+    class unknown_field_set {
+        std::vector<const_bytes> records;
+
+        /// bytes owned by the set, which the first record views if it is not empty
+        std::vector<std::byte> buffer;
+
+        constexpr void rebase() {
+            if(!buffer.empty()) {
+                records.front() = const_bytes{buffer};
+            }
+        }
+
+    public:
+        using value_type = const_bytes;
+        using iterator = std::vector<const_bytes>::const_iterator;
+        using const_iterator = iterator;
+
+        constexpr unknown_field_set() = default;
+
+        constexpr unknown_field_set(const unknown_field_set& other) : records(other.records), buffer(other.buffer) {
+            rebase();
+        }
+
+        constexpr unknown_field_set(unknown_field_set&& other) noexcept = default;
+
+        constexpr unknown_field_set& operator=(const unknown_field_set& other) {
+            records = other.records;
+            buffer = other.buffer;
+            rebase();
+
+            return *this;
+        }
+
+        constexpr unknown_field_set& operator=(unknown_field_set&& other) noexcept = default;
+
+        constexpr iterator begin() const {
+            return records.begin();
+        }
+
+        constexpr iterator end() const {
+            return records.end();
+        }
+
+        /// the number of records, where consecutive unknown fields are coalesced into one record
+        constexpr std::size_t size() const {
+            return records.size();
+        }
+
+        constexpr bool empty() const {
+            return records.empty();
+        }
+
+        /// the total length of all records in bytes
+        constexpr std::size_t byte_size() const {
+            std::size_t n = 0;
+            for(auto r : records) {
+                n += r.size();
+            }
+
+            return n;
+        }
+
+        /// Append a record, which is coalesced into the last record if it directly follows the last one in the decoded bytes
+        constexpr void push_back(const_bytes r) {
+            bool owned_last = records.size() == 1 && !buffer.empty();
+
+            if(!records.empty() && !owned_last && records.back().data() + records.back().size() == r.data()) {
+                records.back() = const_bytes{records.back().data(), records.back().size() + r.size()};
+            } else {
+                records.push_back(r);
+            }
+        }
+
+        /// Append a record like @ref push_back, records are always appended at the end regardless of `pos`
+        constexpr iterator insert(const_iterator, const_bytes r) {
+            push_back(r);
+            return records.end() - 1;
+        }
+
+        /// Remove all records, keeping the capacity of storage
+        constexpr void clear() {
+            records.clear();
+            buffer.clear();
+        }
+
+        /// Copy all records into a buffer owned by the set, so that the set no longer refers to the decoded bytes
+        constexpr void own() {
+            if(records.size() == 1 && !buffer.empty()) {
+                return;
+            }
+
+            std::vector<std::byte> owned;
+            owned.reserve(byte_size());
+            for(auto r : records) {
+                owned.insert(owned.end(), r.begin(), r.end());
+            }
+
+            records.clear();
+            buffer = std::move(owned);
+
+            if(!buffer.empty()) {
+                records.emplace_back(buffer);
+            }
+        }
+
+        /// Checks whether the records of both sets consist of the same bytes, regardless of how they are split
+        constexpr bool operator==(const unknown_field_set& other) const {
+            return std::ranges::equal(records | std::views::join, other.records | std::views::join);
+        }
+    };
+
+    /// @brief A @ref coder for records of @ref unknown_field_set, where a record is a whole encoded field with its key
+    ///
+    /// The record is written verbatim while encoding, and its extent is found by @ref skip_wire while decoding.
+    struct unknown_field_coder {
+        using value_type = const_bytes;
+
+        unknown_field_coder() = delete;
+
+        static constexpr bytes encode(const_bytes v, bytes b) {
+            return copy_bytes(v.data(), v.size(), b);
+        }
+
+        static constexpr decode_result<const_bytes> decode(bytes b) {
+            const auto &[n, nb] = varint_coder<uint<4>>::decode(b);
+            auto e = skip_wire(to_wire_key(n), nb).value_or(nb);
+
+            return {const_bytes{b.data(), e.data()}, e};
+        }
+
+        static constexpr checked_decode_result<const_bytes> checked_decode(bytes b) {
+            auto k = varint_coder<uint<4>>::checked_decode(b);
+            if(!k) {
+                return k.error();
+            }
+
+            const auto &[n, nb] = *k;
+
+            auto r = checked_skip_wire(to_wire_key(n), nb);
+            if(!r) {
+                return r.error();
+            }
+
+            return decode_result<const_bytes>{const_bytes{b.data(), r->data()}, *r};
+        }
+    };
+
+    template <>
+    struct skipper<unknown_field_coder> {
+        using value_type = const_bytes;
+
+        static constexpr std::size_t encode_skip(const_bytes v) {
+            return v.size();
+        }
+
+        static constexpr bytes decode_skip(bytes b) {
+            return unknown_field_coder::decode(b).second;
+        }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            auto r = unknown_field_coder::checked_decode(b);
+            if(!r) {
+                return r.error();
+            }
+
+            return r->second;
+        }
+    };
+
+    /// the wire type of @ref unknown_field_coder is never encoded, since @ref unknown_fields are written without keys
+    template <>
+    struct wire_type_impl<unknown_field_coder> : std::integral_constant<uint<1>, 2> {};
+
+    /// @brief A pseudo field which preserves unknown fields of a message while decoding, ref to @ref unknown_field_set
+    ///
+    /// It takes the reserved field number 0 and is not encoded with a key: while encoding,
+    /// the preserved fields are re-emitted verbatim at the position of this field (usually the last one) in the message.
+    template <basic_fixed_string S = "unknown">
+    using unknown_fields = field<S, 0, unknown_field_coder, repeated, unknown_field_set>;
+
+    /// Checks whether the field type is @ref unknown_fields
+    template <typename>
+    constexpr bool is_unknown_fields = false;
+
+    template <basic_fixed_string S>
+    constexpr bool is_unknown_fields<unknown_fields<S>> = true;
+
+    template <message_c T, typename S>
+    struct field_selector_number_impl;
+
+    template <message_c T, uint<4> N>
+    struct field_selector_number_impl<T, std::integral_constant<uint<4>, N>> :
+        std::integral_constant<uint<4>, T::template get_type_by_number<N>::number> {};
+
+    template <message_c T, auto S>
+    struct field_selector_number_impl<T, constant<S>> :
+        std::integral_constant<uint<4>, T::template get_type_by_name<S>::number> {};
+
+    /// Get the field number which a field selector of message `T` refers to, i.e. `"name"_f` or `233_i`
+    template <message_c T, auto S>
+    constexpr uint<4> field_selector_number = field_selector_number_impl<T, std::remove_cvref_t<decltype(S)>>::value;
+
+    /// State threaded through decoding fields of a message
+    struct decode_context {
+        /// the memory resource which decoded values allocate from, ref to @ref resource_decoder
+        std::pmr::memory_resource* mr = nullptr;
+
+        /// @brief Numbers of values decoded into each field (in declaration order) so far if not null,
+        /// in which case existing values of fields are reused, ref to `message_coder<T>::decode_reuse`
+        std::size_t* reuse_counts = nullptr;
+    };
+
+    /// @brief An extension point to decode values of coder `C` directly into the container of a repeated field,
+    /// instead of decoding each value and then inserting it, i.e. entries of map fields (ref to `map.h`).
+    ///
+    /// A specialization provides `decode(c, b, mr)` returning the remaining bytes, 
+    /// and `checked_decode(c, b, mr)` returning a @ref checked_result of them, for supported containers `c`.
+    template <coder C>
+    struct emplace_decoder {};
+
+    /// The operation which an instrumentation hook is called for
+    enum class instrument_event {
+        encode,
+        decode
+    };
+
+    /// @brief The instrumentation policy which does nothing, i.e. instrumentation is disabled, where no hook is called at all.
+    ///
+    /// An instrumentation policy provides static hooks, which are called while encoding and decoding a message type `T`:
+    /// - `enter<T>(event)` at entering the message, returns a `scope` state passed to `exit`
+    /// - `exit<T>(event, scope, n)` at exiting the message, where `n` bytes are processed (0 if decoding fails)
+    /// - `field_decoded<T>(i, n)` after the `i`-th field (in declaration order) is decoded from `n` bytes including its key
+    /// - `field_skipped<T>(number, n)` after a field with `number` is skipped over `n` bytes including its key
+    ///
+    /// A policy can derive from @ref no_instrument to omit some of the hooks, ref to @ref counting_instrument in `instrument.h`.
+    struct no_instrument {
+        struct scope {};
+
+        template <message_c T>
+        static constexpr scope enter(instrument_event) {
+            return {};
+        }
+
+        template <message_c T>
+        static constexpr void exit(instrument_event, scope, std::size_t) {}
+
+        template <message_c T>
+        static constexpr void field_decoded(std::size_t, std::size_t) {}
+
+        template <message_c T>
+        static constexpr void field_skipped(uint<4>, std::size_t) {}
+    };
+
+    /// @brief An extension point to select the instrumentation policy of message type `T`, which is @ref no_instrument by default.
+    ///
+    /// Specialize `message_instrument<T>` to instrument message type `T` only,
+    /// or partially specialize `message_instrument<T, void>` to instrument all message types,
+    /// with the policy as member type `type`. Specializations must precede any use of coders of the message types.
+    template <message_c T, typename = void>
+    struct message_instrument {
+        using type = no_instrument;
+    };
+
+    /// The instrumentation policy of message type `T`, ref to @ref message_instrument
+    template <message_c T>
+    using instrument_of = typename message_instrument<T>::type;
+
+    /// Checks whether message type `T` is instrumented
+    template <message_c T>
+    constexpr bool instrumented = !std::same_as<instrument_of<T>, no_instrument>;
+
+    /// Calls the `enter` hook of policy `I` for message type `T` on construction, and the `exit` hook on destruction
+    template <message_c T, typename I = instrument_of<T>>
+    class instrument_scope {
+        instrument_event event;
+        typename I::scope state;
+        std::size_t n = 0;
+
+    public:
+        constexpr explicit instrument_scope(instrument_event e) : event(e), state(I::template enter<T>(e)) {}
+
+        instrument_scope(const instrument_scope&) = delete;
+        instrument_scope& operator=(const instrument_scope&) = delete;
+
+        /// set the number of bytes processed in the scope, which is passed to the `exit` hook
+        constexpr void processed(std::size_t bytes) {
+            n = bytes;
+        }
+
+        constexpr ~instrument_scope() {
+            I::template exit<T>(event, state, n);
+        }
     };
 
-    using message_skip_map = message_skip_map_impl<0, 1, 2, 5>;
-    inline const message_skip_map skip_map;
+    /// No hook is called if instrumentation is disabled
+    template <message_c T>
+    class instrument_scope<T, no_instrument> {
+    public:
+        constexpr explicit instrument_scope(instrument_event) {}
+
+        constexpr void processed(std::size_t) {}
+    };
 
     template <message_c>
     struct message_decode_map;
 
+    /// @brief Dispatch a decoded field key to the decoder of the corresponding field, resolved at compile time
+    ///
+    /// Field keys are sorted into a constexpr array for binary search and decoders are stored in a jump table,
+    /// so no dynamic initialization or type erasure is involved.
+    /// Since fields usually arrive in declaration order, the field following the last decoded one is checked first.
+    /// Repeated fields of scalar types accept both unpacked and packed forms.
     template <field_c... F>
-    struct message_decode_map<message<F...>> : std::unordered_map<uint<4>, std::function<bytes(message<F...>&, bytes)>> {
+    struct message_decode_map<message<F...>> {
     private:
         using T = message<F...>;
 
-    public:
-        message_decode_map() : std::unordered_map<uint<4>, std::function<bytes(T&, bytes)>> {
-                {F::key, [](T& m, bytes b){
-                    auto [v, np] = F::coder::decode(b);
+        using decode_function = bytes (*)(T&, bytes, const decode_context&);
+
+        using checked_decode_function = checked_result<bytes> (*)(T&, bytes, const decode_context&);
+
+        /// @brief Checks whether field `G` accepts both unpacked and packed forms while decoding,
+        /// which holds for repeated fields of scalar types, ref to https://developers.google.com/protocol-buffers/docs/encoding#packed
+        template <field_c G>
+        static constexpr bool accepts_both_forms = [] {
+            if constexpr (is_oneof<G>) {
+                return false;
+            } else {
+                return G::attr != singular && wire_type<typename G::coder> != 2;
+            }
+        }();
+
+        /// @brief the number of field keys accepted by field `G`,
+        /// where @ref unknown_fields accepts no key and a @ref oneof_field accepts keys of all alternatives
+        template <field_c G>
+        static constexpr std::size_t entry_count = []() -> std::size_t {
+            if constexpr (is_unknown_fields<G>) {
+                return 0;
+            } else if constexpr (is_oneof<G>) {
+                return G::alternative_count;
+            } else {
+                return 1 + accepts_both_forms<G>;
+            }
+        }();
+
+        /// the number of accepted field keys
+        static constexpr std::size_t size = (entry_count<F> + ... + 0);
+
+        /// whether unknown fields are preserved into a field of @ref unknown_fields
+        static constexpr bool preserves_unknown = (is_unknown_fields<F> || ...);
+
+        /// the index of field `G` in declaration order
+        template <field_c G>
+        static constexpr std::size_t field_index = [] {
+            std::size_t i = 0, res = 0;
+            ((std::same_as<G, F> ? res = i++ : i++), ...);
+            return res;
+        }();
+
+        /// Checks whether values of field `G` are decoded directly into its container, ref to @ref emplace_decoder
+        template <field_c G>
+        static constexpr bool emplaces_elements = G::attr == repeated &&
+            requires(typename G::base_type& c, bytes b) { emplace_decoder<typename G::coder>::decode(c, b, nullptr); };
+
+        /// @brief Checks whether elements of field `G` are reused by index while decoding in reuse mode,
+        /// which holds for repeated fields of length-delimited types in random access containers,
+        /// except fields decoded directly into their containers
+        template <field_c G>
+        static constexpr bool reuses_elements = [] {
+            if constexpr (is_oneof<G> || is_unknown_fields<G> || emplaces_elements<G>) {
+                return false;
+            } else {
+                return G::attr == repeated && wire_type<typename G::coder> == 2 &&
+                    std::ranges::random_access_range<typename G::base_type>;
+            }
+        }();
+
+        /// @brief Select the value of field `f` to reuse for the `c`-th decoded value in reuse mode, and update `c`,
+        /// returns null if a new value should be pushed into the field instead
+        template <field_c G>
+        static constexpr typename G::coder::value_type* reuse_target(G& f, std::size_t& c) {
+            if constexpr (G::attr == singular) {
+                if(c++ == 0 && f.has_value()) {
+                    return &*f;
+                }
+            } else if constexpr (reuses_elements<G>) {
+                if(c < std::ranges::size(f)) {
+                    return &f[c++];
+                }
+
+                ++c;
+            } else {
+                if(c++ == 0) {
+                    f.clear();
+                }
+            }
+
+            return nullptr;
+        }
+
+        /// Finish decoding in reuse mode: remove values of field `G` which are not overwritten
+        template <field_c G>
+        static constexpr void trim_field(T& m, std::size_t c) {
+            auto &&f = m.template get<G::number>();
+
+            if constexpr (G::attr == singular) {
+                if(c == 0) {
+                    f.reset();
+                }
+            } else if constexpr (reuses_elements<G>) {
+                f.erase(std::ranges::begin(f) + c, std::ranges::end(f));
+            } else {
+                if(c == 0) {
+                    f.clear();
+                }
+            }
+        }
+
+        /// Preserve the unknown field from `b` to `e` into the field of @ref unknown_fields if any
+        static constexpr void store_unknown(T& m, bytes b, bytes e, const decode_context& ctx) {
+            if constexpr (preserves_unknown) {
+                using G = field_number_selector<0, F...>;
+                auto &f = m.template get<0>();
+
+                if(ctx.reuse_counts != nullptr && ctx.reuse_counts[field_index<G>]++ == 0) {
+                    f.clear();
+                }
+
+                f.push_back(const_bytes{b.data(), e.data()});
+            }
+        }
+
+        template <field_c G>
+        static constexpr bytes decode_field(T& m, bytes b, const decode_context& ctx) {
+            auto &&f = m.template get<G::number>();
+
+            if(ctx.reuse_counts != nullptr) {
+                if(auto p = reuse_target(f, ctx.reuse_counts[field_index<G>])) {
+                    return reuse_decode<typename G::coder>(*p, b, ctx.mr);
+                }
+            }
+
+            if constexpr (emplaces_elements<G>) {
+                return emplace_decoder<typename G::coder>::decode(f.cast_to_base(), b, ctx.mr);
+            } else {
+                auto [v, np] = resource_decode<typename G::coder>(b, ctx.mr);
+                push_field(f, std::move(v));
+
+                return np;
+            }
+        }
+
+        template <field_c G>
+        static constexpr checked_result<bytes> checked_decode_field(T& m, bytes b, const decode_context& ctx) {
+            auto &&f = m.template get<G::number>();
+
+            if(ctx.reuse_counts != nullptr) {
+                if(auto p = reuse_target(f, ctx.reuse_counts[field_index<G>])) {
+                    return reuse_checked_decode<typename G::coder>(*p, b, ctx.mr);
+                }
+            }
+
+            if constexpr (emplaces_elements<G>) {
+                return emplace_decoder<typename G::coder>::checked_decode(f.cast_to_base(), b, ctx.mr);
+            } else {
+                auto r = resource_checked_decode<typename G::coder>(b, ctx.mr);
+                if(!r) {
+                    return r.error();
+                }
+
+                auto &[v, np] = *r;
+                push_field(f, std::move(v));
+
+                return np;
+            }
+        }
+
+        /// @brief Decode a value of the `I`-th alternative of @ref oneof_field `G`, which replaces the previous alternative,
+        /// or is decoded into the value of the same alternative in reuse mode
+        template <field_c G, std::size_t I>
+        static constexpr bytes decode_alternative(T& m, bytes b, const decode_context& ctx) {
+            using C = typename G::template alternative<I>::coder;
+            auto &f = m.template get<G::number>().cast_to_base();
+
+            if(ctx.reuse_counts != nullptr && ctx.reuse_counts[field_index<G>]++ == 0 && f.index() == I + 1) {
+                return reuse_decode<C>(std::get<I + 1>(f), b, ctx.mr);
+            }
+
+            auto [v, np] = resource_decode<C>(b, ctx.mr);
+            f.template emplace<I + 1>(std::move(v));
+
+            return np;
+        }
+
+        template <field_c G, std::size_t I>
+        static constexpr checked_result<bytes> checked_decode_alternative(T& m, bytes b, const decode_context& ctx) {
+            using C = typename G::template alternative<I>::coder;
+            auto &f = m.template get<G::number>().cast_to_base();
+
+            if(ctx.reuse_counts != nullptr && ctx.reuse_counts[field_index<G>]++ == 0 && f.index() == I + 1) {
+                return reuse_checked_decode<C>(std::get<I + 1>(f), b, ctx.mr);
+            }
+
+            auto r = resource_checked_decode<C>(b, ctx.mr);
+            if(!r) {
+                return r.error();
+            }
+
+            auto &[v, np] = *r;
+            f.template emplace<I + 1>(std::move(v));
+
+            return np;
+        }
+
+        template <field_c G>
+        static constexpr bytes decode_packed_field(T& m, bytes b, const decode_context& ctx) {
+            uint<8> len = 0;
+            std::tie(len, b) = varint_coder<uint<8>>::decode(b);
+
+            auto &&f = m.template get<G::number>();
+            if(ctx.reuse_counts != nullptr) {
+                reuse_target(f, ctx.reuse_counts[field_index<G>]);
+            }
+
+            decode_elements<typename G::coder>(static_cast<typename G::base_type&>(f), b.subspan(0, len));
+
+            return b.subspan(len);
+        }
+
+        template <field_c G>
+        static constexpr checked_result<bytes> checked_decode_packed_field(T& m, bytes b, const decode_context& ctx) {
+            auto lr = varint_coder<uint<8>>::checked_decode(b);
+            if(!lr) {
+                return lr.error();
+            }
+
+            auto [len, rest] = *lr;
+            if(len > rest.size()) {
+                return decode_error::length_overflow;
+            }
+
+            auto &&f = m.template get<G::number>();
+            if(ctx.reuse_counts != nullptr) {
+                reuse_target(f, ctx.reuse_counts[field_index<G>]);
+            }
+
+            auto r = checked_decode_elements<typename G::coder>(static_cast<typename G::base_type&>(f), rest.subspan(0, len));
+            if(!r) {
+                return r.error();
+            }
+
+            return rest.subspan(len);
+        }
+
+        /// a decoding entry for a field key
+        struct entry {
+            uint<4> key;
+            decode_function decoder;
+            checked_decode_function checked_decoder;
+            /// the expected index of the next entry: repeated elements tend to be consecutive, others do not
+            std::size_t next_hint;
+            /// the index of the field in declaration order
+            std::size_t field;
+        };
+
+        /// append entries of field `G` into `res` from index `i`, the form which `G` is encoded in comes first
+        template <field_c G>
+        static constexpr void add_entries(std::array<entry, size>& res, std::size_t& i) {
+            constexpr std::size_t n = 1 + accepts_both_forms<G>;
+            constexpr uint<4> packed_key = (G::number << 3u) | 2u;
+
+            constexpr entry element_entry = {G::element_key, &decode_field<G>, &checked_decode_field<G>, 0, field_index<G>};
+
+            if constexpr (G::attr == singular) {
+                res[i] = element_entry;
+                res[i].next_hint = i + n;
+            } else if constexpr (accepts_both_forms<G>) {
+                constexpr entry packed_entry = {packed_key, &decode_packed_field<G>, &checked_decode_packed_field<G>, 0, field_index<G>};
+                std::size_t e = G::attr == packed ? i + 1 : i, p = G::attr == packed ? i : i + 1;
+
+                res[e] = element_entry;
+                res[e].next_hint = e;
+                res[p] = packed_entry;
+                res[p].next_hint = i + n;
+            } else {
+                res[i] = element_entry;
+                res[i].next_hint = i;
+            }
+
+            i += n;
+        }
 
-                    auto &f = m.template get<F::number>();
-                    push_field(f, std::move(v));
+        /// @ref unknown_fields has no entries
+        template <field_c G> requires is_unknown_fields<G>
+        static constexpr void add_entries(std::array<entry, size>&, std::size_t&) {}
+
+        /// append entries of all alternatives of @ref oneof_field `G`, after which any field following the group is expected
+        template <field_c G> requires is_oneof<G>
+        static constexpr void add_entries(std::array<entry, size>& res, std::size_t& i) {
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                const std::size_t next = i + sizeof...(I);
+                ((res[i++] = {G::template alternative<I>::key, &decode_alternative<G, I>, &checked_decode_alternative<G, I>, next, field_index<G>}), ...);
+            }(std::make_index_sequence<G::alternative_count>{});
+        }
+
+        /// decoding entries of fields in declaration order
+        static constexpr std::array<entry, size> entries = [] {
+            std::array<entry, size> res{};
+            [[maybe_unused]] std::size_t i = 0;
+            (add_entries<F>(res, i), ...);
+            return res;
+        }();
+
+        /// accepted field keys in the order of @ref entries
+        static constexpr std::array<uint<4>, size> keys = [] {
+            std::array<uint<4>, size> res{};
+            for(std::size_t i = 0; i < size; ++i) {
+                res[i] = entries[i].key;
+            }
+            return res;
+        }();
+
+        /// pairs of field key and index of @ref entries, sorted by field key
+        static constexpr std::array<std::pair<uint<4>, std::size_t>, size> sorted_keys = [] {
+            std::array<std::pair<uint<4>, std::size_t>, size> res{};
+            for(std::size_t i = 0; i < size; ++i) {
+                res[i] = {keys[i], i};
+            }
+            std::sort(res.begin(), res.end());
+            return res;
+        }();
+
+        /// find the index of entry by field key, returns `size` if not found
+        static constexpr std::size_t find(uint<4> key) {
+            auto iter = std::lower_bound(sorted_keys.begin(), sorted_keys.end(), key, [](const auto& p, uint<4> k) {
+                return p.first < k;
+            });
+
+            if(iter != sorted_keys.end() && iter->first == key) {
+                return iter->second;
+            }
+
+            return size;
+        }
+
+        /// @brief Call the instrumentation hook for the field from `b` to `e` with key `n`,
+        /// which is decoded by the `i`-th entry, or skipped if `i` is not less than `size`
+        static constexpr void observe(std::size_t i, uint<4> n, bytes b, bytes e) {
+            if constexpr (instrumented<T>) {
+                std::size_t len = e.data() - b.data();
 
-                    return np;
-                }}...
-        } {}
+                if(i < size) {
+                    instrument_of<T>::template field_decoded<T>(entries[i].field, len);
+                } else {
+                    instrument_of<T>::template field_skipped<T>(to_field_number(n), len);
+                }
+            }
+        }
 
-        constexpr std::pair<bytes, bool> decode(T& v, bytes b) const {
+    public:
+        /// the number of fields, i.e. the length of @ref decode_context::reuse_counts
+        static constexpr std::size_t field_count = sizeof...(F);
+
+        /// @brief Decode a field from `b` into message `v`, 
+        /// skip it if it is an unknown field (which is preserved if the message has a field of @ref unknown_fields)
+        /// @param hint the index of field expected to be decoded, which is updated after decoding
+        /// @param ctx the @ref decode_context
+        /// @returns a pair of the remaining bytes and whether decoding should continue,
+        /// decoding stops before a field key with number 0 or with an invalid wire type
+        static constexpr std::pair<bytes, bool> decode(T& v, bytes b, std::size_t& hint, const decode_context& ctx) {
             const auto &[n, nb] = varint_coder<uint<4>>::decode(b);
 
             if(to_field_number(n) == 0) {
                 return {b, false};
             }
 
-            auto iter = this->find(n);
-            if (iter != this->end()) {
-                b = iter->second(v, nb);
+            std::size_t i = hint < size && keys[hint] == n ? hint : find(n);
+            bytes e = b;
+            if (i < size) {
+                e = entries[i].decoder(v, nb, ctx);
+                hint = entries[i].next_hint;
+            } else if (auto sb = skip_wire(to_wire_key(n), nb)) {
+                store_unknown(v, b, *sb, ctx);
+                e = *sb;
+            } else {
+                return {b, false};
+            }
+
+            observe(i, n, b, e);
+            return {e, true};
+        }
+
+        /// Same as `decode(v, b, hint, ctx)`, where decoded values allocate from `mr`
+        static constexpr std::pair<bytes, bool> decode(T& v, bytes b, std::size_t& hint, std::pmr::memory_resource* mr = nullptr) {
+            return decode(v, b, hint, decode_context{mr});
+        }
+
+        /// Decode a field from `b` into message `v` without an index hint
+        static constexpr std::pair<bytes, bool> decode(T& v, bytes b) {
+            std::size_t hint = 0;
+            return decode(v, b, hint);
+        }
+
+        /// @brief Same as `decode(v, b, hint, ctx)`, but never reads past the end of `b`
+        /// @returns a @ref checked_result holding a pair of the remaining bytes and whether decoding should continue,
+        /// or the @ref decode_error if the bytes are malformed
+        static constexpr checked_result<std::pair<bytes, bool>> checked_decode(T& v, bytes b, std::size_t& hint, const decode_context& ctx) {
+            auto k = varint_coder<uint<4>>::checked_decode(b);
+            if(!k) {
+                return k.error();
+            }
+
+            const auto &[n, nb] = *k;
+
+            if(to_field_number(n) == 0) {
+                return std::pair{b, false};
+            }
+
+            std::size_t i = hint < size && keys[hint] == n ? hint : find(n);
+            auto r = i < size ? entries[i].checked_decoder(v, nb, ctx) : checked_skip_wire(to_wire_key(n), nb);
+            if(!r) {
+                return r.error();
+            }
+
+            if(i < size) {
+                hint = entries[i].next_hint;
             } else {
-                b = skip_map.at(to_wire_key(n))(nb);
+                store_unknown(v, b, *r, ctx);
+            }
+
+            observe(i, n, b, *r);
+            return std::pair{*r, true};
+        }
+
+        /// Same as `checked_decode(v, b, hint, ctx)`, where decoded values allocate from `mr`
+        static constexpr checked_result<std::pair<bytes, bool>> checked_decode(T& v, bytes b, std::size_t& hint, std::pmr::memory_resource* mr = nullptr) {
+            return checked_decode(v, b, hint, decode_context{mr});
+        }
+
+    private:
+        /// set flags in `seen` of `N...` which equal to `number`, returns whether any is set
+        template <uint<4>... N>
+        static constexpr bool mark_selected(uint<4> number, std::array<bool, sizeof...(N)>& seen) {
+            constexpr std::array<uint<4>, sizeof...(N)> numbers{N...};
+
+            bool selected = false;
+            for(std::size_t j = 0; j < numbers.size(); ++j) {
+                if(numbers[j] == number) {
+                    seen[j] = selected = true;
+                }
+            }
+
+            return selected;
+        }
+
+    public:
+        /// @brief Same as `decode(v, b, hint, ctx)`, but only decodes fields with numbers in `N...`, while others are skipped by @ref skip_wire
+        /// @param seen flags of `N...` which are set while the field with the corresponding number is decoded
+        template <uint<4>... N>
+        static constexpr std::pair<bytes, bool> decode_only(T& v, bytes b, std::size_t& hint, std::array<bool, sizeof...(N)>& seen, const decode_context& ctx = {}) {
+            const auto &[n, nb] = varint_coder<uint<4>>::decode(b);
+
+            auto number = to_field_number(n);
+            if(number == 0) {
+                return {b, false};
+            }
+
+            if(mark_selected<N...>(number, seen)) {
+                std::size_t i = hint < size && keys[hint] == n ? hint : find(n);
+                if (i < size) {
+                    auto e = entries[i].decoder(v, nb, ctx);
+                    hint = entries[i].next_hint;
+
+                    observe(i, n, b, e);
+                    return {e, true};
+                }
+            }
+
+            if (auto sb = skip_wire(to_wire_key(n), nb)) {
+                observe(size, n, b, *sb);
+                return {*sb, true};
             }
 
-            return {b, true};
+            return {b, false};
+        }
+
+        /// Same as `decode_only<N...>(v, b, hint, seen, ctx)`, but never reads past the end of `b`
+        template <uint<4>... N>
+        static constexpr checked_result<std::pair<bytes, bool>> checked_decode_only(T& v, bytes b, std::size_t& hint, std::array<bool, sizeof...(N)>& seen, const decode_context& ctx = {}) {
+            auto k = varint_coder<uint<4>>::checked_decode(b);
+            if(!k) {
+                return k.error();
+            }
+
+            const auto &[n, nb] = *k;
+
+            auto number = to_field_number(n);
+            if(number == 0) {
+                return std::pair{b, false};
+            }
+
+            std::size_t i = size;
+            if(mark_selected<N...>(number, seen)) {
+                i = hint < size && keys[hint] == n ? hint : find(n);
+            }
+
+            auto r = i < size ? entries[i].checked_decoder(v, nb, ctx) : checked_skip_wire(to_wire_key(n), nb);
+            if(!r) {
+                return r.error();
+            }
+
+            if(i < size) {
+                hint = entries[i].next_hint;
+            }
+
+            observe(i, n, b, *r);
+            return std::pair{*r, true};
+        }
+
+        /// Finish decoding in reuse mode: remove values of fields which are not overwritten, ref to @ref decode_context::reuse_counts
+        static constexpr void trim(T& v, [[maybe_unused]] const std::size_t* reuse_counts) {
+            (trim_field<F>(v, reuse_counts[field_index<F>]), ...);
+        }
+
+        /// @brief Finish decoding fields into message `v`, 
+        /// where containers holding values appended out of order (i.e. @ref sorted_vector_map) restore their order
+        static constexpr void finish(T& v) {
+            ([&v] {
+                if constexpr (requires(typename F::base_type& c) { c.restore_order(); }) {
+                    v.template get<F::number>().restore_order();
+                }
+            }(), ...);
         }
     };
 
     template <message_c T>
-    inline const message_decode_map<T> decode_map;
+    inline constexpr message_decode_map<T> decode_map{};
+
+    /// @brief Encode a non-empty field `f` with its key into `b`
+    ///
+    /// Every element of a @ref repeated field is encoded with its own key,
+    /// while all elements of a @ref packed field are encoded into one length-delimited record.
+    /// Records of @ref unknown_fields are copied verbatim without keys.
+    template <field_c F>
+    constexpr bytes encode_field(const F& f, bytes b) {
+        using C = typename F::coder;
+
+        if constexpr (is_unknown_fields<F>) {
+            for(auto r : f) {
+                b = C::encode(r, b);
+            }
+        } else if constexpr (F::attr == singular) {
+            b = encode_constant_varint<F::key>(b);
+            b = C::encode(f.value(), b);
+        } else if constexpr (F::attr == packed) {
+            b = encode_constant_varint<F::key>(b);
+            b = varint_coder<uint<8>>::encode(elements_encode_skip<C>(f.cast_to_base()), b);
+            b = encode_elements<C>(f.cast_to_base(), b);
+        } else {
+            for(const auto &i : f) {
+                b = encode_constant_varint<F::key>(b);
+                b = C::encode(i, b);
+            }
+        }
+
+        return b;
+    }
+
+    /// Same as `encode_field(f, b)`, but consumes nested sizes from `cache` recorded by `field_encode_skip(f, cache)`
+    template <field_c F>
+    constexpr bytes encode_field(const F& f, bytes b, size_cache& cache) {
+        using C = typename F::coder;
+
+        if constexpr (is_unknown_fields<F>) {
+            b = encode_field(f, b);
+        } else if constexpr (F::attr == singular) {
+            b = encode_constant_varint<F::key>(b);
+            b = cached_encode<C>(f.value(), b, cache);
+        } else if constexpr (F::attr == packed) {
+            b = encode_constant_varint<F::key>(b);
+            b = varint_coder<uint<8>>::encode(cache.next(), b);
+            b = encode_elements<C>(f.cast_to_base(), b);
+        } else {
+            for(const auto &i : f) {
+                b = encode_constant_varint<F::key>(b);
+                b = cached_encode<C>(i, b, cache);
+            }
+        }
+
+        return b;
+    }
+
+    /// Get the encoded length of a non-empty field `f` with its key, ref to @ref encode_field
+    template <field_c F>
+    constexpr std::size_t field_encode_skip(const F& f) {
+        using C = typename F::coder;
+
+        std::size_t n = 0;
+        if constexpr (is_unknown_fields<F>) {
+            n += f.byte_size();
+        } else if constexpr (F::attr == singular) {
+            n += skipper<varint_coder<uint<4>>>::encode_skip(F::key);
+            n += skipper<C>::encode_skip(f.value());
+        } else if constexpr (F::attr == packed) {
+            auto len = elements_encode_skip<C>(f.cast_to_base());
+
+            n += skipper<varint_coder<uint<4>>>::encode_skip(F::key);
+            n += skipper<varint_coder<uint<8>>>::encode_skip(len);
+            n += len;
+        } else {
+            for(const auto &i : f) {
+                n += skipper<varint_coder<uint<4>>>::encode_skip(F::key);
+                n += skipper<C>::encode_skip(i);
+            }
+        }
+
+        return n;
+    }
+
+    /// Same as `field_encode_skip(f)`, but records nested sizes into `cache`
+    template <field_c F>
+    constexpr std::size_t field_encode_skip(const F& f, size_cache& cache) {
+        using C = typename F::coder;
+
+        std::size_t n = 0;
+        if constexpr (is_unknown_fields<F>) {
+            n += f.byte_size();
+        } else if constexpr (F::attr == singular) {
+            n += skipper<varint_coder<uint<4>>>::encode_skip(F::key);
+            n += cached_encode_skip<C>(f.value(), cache);
+        } else if constexpr (F::attr == packed) {
+            auto len = elements_encode_skip<C>(f.cast_to_base());
+            cache.record(cache.reserve(), len);
+
+            n += skipper<varint_coder<uint<4>>>::encode_skip(F::key);
+            n += skipper<varint_coder<uint<8>>>::encode_skip(len);
+            n += len;
+        } else {
+            for(const auto &i : f) {
+                n += skipper<varint_coder<uint<4>>>::encode_skip(F::key);
+                n += cached_encode_skip<C>(i, cache);
+            }
+        }
+
+        return n;
+    }
+
+    /// Encode the alternative which is set in @ref oneof_field `f` with its key into `b`
+    template <field_c F> requires is_oneof<F>
+    constexpr bytes encode_field(const F& f, bytes b) {
+        f.visit_alternative([&b]<field_c A>(std::type_identity<A>, const auto& v) {
+            b = encode_constant_varint<A::key>(b);
+            b = A::coder::encode(v, b);
+        });
+
+        return b;
+    }
+
+    template <field_c F> requires is_oneof<F>
+    constexpr bytes encode_field(const F& f, bytes b, size_cache& cache) {
+        f.visit_alternative([&b, &cache]<field_c A>(std::type_identity<A>, const auto& v) {
+            b = encode_constant_varint<A::key>(b);
+            b = cached_encode<typename A::coder>(v, b, cache);
+        });
+
+        return b;
+    }
+
+    /// Get the encoded length of the alternative which is set in @ref oneof_field `f` with its key
+    template <field_c F> requires is_oneof<F>
+    constexpr std::size_t field_encode_skip(const F& f) {
+        std::size_t n = 0;
+        f.visit_alternative([&n]<field_c A>(std::type_identity<A>, const auto& v) {
+            n += skipper<varint_coder<uint<4>>>::encode_skip(A::key);
+            n += skipper<typename A::coder>::encode_skip(v);
+        });
+
+        return n;
+    }
+
+    template <field_c F> requires is_oneof<F>
+    constexpr std::size_t field_encode_skip(const F& f, size_cache& cache) {
+        std::size_t n = 0;
+        f.visit_alternative([&n, &cache]<field_c A>(std::type_identity<A>, const auto& v) {
+            n += skipper<varint_coder<uint<4>>>::encode_skip(A::key);
+            n += cached_encode_skip<typename A::coder>(v, cache);
+        });
+
+        return n;
+    }
 
     /// A @ref coder for @ref message type
     template <message_c T>
@@ -351,37 +1448,252 @@ namespace pp {
         message_coder() = delete;
 
         static constexpr bytes encode(const T& msg, bytes b) {
+            instrument_scope<T> scope(instrument_event::encode);
+            const auto origin = b.size();
+
             msg.for_each([&b]<field_c F> (const F& f) {
                 if(empty_field(f)) {
                     return;
                 }
 
+                b = encode_field(f, b);
+            });
 
-                if constexpr (F::attr == singular) {
-                    b = varint_coder<uint<4>>::encode(F::key, b);
-                    b = F::coder::encode(f.value(), b);
-                } else {
-                    for(const auto &i : f) {
-                        b = varint_coder<uint<4>>::encode(F::key, b);
-                        b = F::coder::encode(i, b);
-                    }
+            scope.processed(origin - b.size());
+            return b;
+        }
+
+        /// @brief Encode `msg` using nested sizes recorded in `cache`, the writing pass of two-pass encoding.
+        ///
+        /// `cache` must be filled by `skipper<message_coder<T>>::encode_skip(msg, cache)` beforehand,
+        /// so that every embedded message is sized only once instead of once per nesting level.
+        static constexpr bytes encode(const T& msg, bytes b, size_cache& cache) {
+            instrument_scope<T> scope(instrument_event::encode);
+            const auto origin = b.size();
+
+            msg.for_each([&b, &cache]<field_c F> (const F& f) {
+                if(empty_field(f)) {
+                    return;
+                }
+
+                b = encode_field(f, b, cache);
+            });
+
+            scope.processed(origin - b.size());
+            return b;
+        }
+
+        /// @brief Encode `msg` into the output @ref sink `s`, returns the number of bytes written.
+        ///
+        /// Each non-empty field is sized once (recording its nested sizes), 
+        /// then space for the whole field is reserved from `s` at once and written by the cached writing pass.
+        template <sink S>
+        static constexpr std::size_t encode(const T& msg, S& s) {
+            instrument_scope<T> scope(instrument_event::encode);
+            size_cache cache;
+            std::size_t total = 0;
+
+            msg.for_each([&s, &cache, &total]<field_c F> (const F& f) {
+                if(empty_field(f)) {
+                    return;
                 }
+
+                cache.clear();
+                auto n = field_encode_skip(f, cache);
+
+                encode_field(f, s.reserve(n), cache);
+                s.commit(n);
+                total += n;
             });
 
+            scope.processed(total);
+            return total;
+        }
+
+        /// @brief Decode only fields selected by `S...` (i.e. `decode_only<"id"_f, 5_i>(b)`) from `b`, 
+        /// other fields are skipped via their wire type without decoding.
+        ///
+        /// If all selected fields are singular, decoding stops once all of them are seen (so later occurrences are not merged),
+        /// and the returned bytes begin from the first field not consumed.
+        template <auto... S> requires (sizeof...(S) > 0)
+        static constexpr decode_result<T> decode_only(bytes b, std::pmr::memory_resource* mr = nullptr) {
+            constexpr bool stops_early = ((T::template get_type_by_number<field_selector_number<T, S>>::attr == singular) && ...);
+
+            T v = make_with_resource<T>(mr);
+            std::array<bool, sizeof...(S)> seen{};
+
+            instrument_scope<T> scope(instrument_event::decode);
+            const auto origin = b.size();
+
+            std::size_t hint = 0;
+            while(b.end() > b.begin()) {
+                if(stops_early && std::ranges::all_of(seen, std::identity{})) break;
+
+                bool next = true;
+                std::tie(b, next) = decode_map<T>.template decode_only<field_selector_number<T, S>...>(v, b, hint, seen, decode_context{mr});
+
+                if(!next) break;
+            }
+
+            decode_map<T>.finish(v);
+            scope.processed(origin - b.size());
+            return {std::move(v), b};
+        }
+
+        /// Same as `decode_only<S...>(b, mr)`, but never reads past the end of `b`
+        template <auto... S> requires (sizeof...(S) > 0)
+        static constexpr checked_decode_result<T> checked_decode_only(bytes b, std::pmr::memory_resource* mr = nullptr) {
+            constexpr bool stops_early = ((T::template get_type_by_number<field_selector_number<T, S>>::attr == singular) && ...);
+
+            T v = make_with_resource<T>(mr);
+            std::array<bool, sizeof...(S)> seen{};
+
+            instrument_scope<T> scope(instrument_event::decode);
+            const auto origin = b.size();
+
+            std::size_t hint = 0;
+            while(b.end() > b.begin()) {
+                if(stops_early && std::ranges::all_of(seen, std::identity{})) break;
+
+                auto r = decode_map<T>.template checked_decode_only<field_selector_number<T, S>...>(v, b, hint, seen, decode_context{mr});
+                if(!r) {
+                    return r.error();
+                }
+
+                bool next = true;
+                std::tie(b, next) = *r;
+
+                if(!next) break;
+            }
+
+            decode_map<T>.finish(v);
+            scope.processed(origin - b.size());
+            return decode_result<T>{std::move(v), b};
+        }
+
+        /// @brief Decode fields from `b` into an existing message `v` in place, returns the remaining bytes.
+        ///
+        /// Decoded values are moved into `v` following @ref push_field, 
+        /// i.e. singular fields are overwritten and repeated fields are appended, as protobuf merges a message.
+        /// If `mr` is not null, decoded values allocate from `mr` (ref to `decode(b, mr)`).
+        static constexpr bytes decode(T& v, bytes b, std::pmr::memory_resource* mr = nullptr) {
+            instrument_scope<T> scope(instrument_event::decode);
+            const auto origin = b.size();
+
+            std::size_t hint = 0;
+            while(b.end() > b.begin()) {
+                bool next = true;
+                std::tie(b, next) = decode_map<T>.decode(v, b, hint, mr);
+
+                if(!next) break;
+            }
+
+            decode_map<T>.finish(v);
+            scope.processed(origin - b.size());
+            return b;
+        }
+
+        /// @brief Decode a message from `b` into an existing message `v`, reusing its storage, returns the remaining bytes.
+        ///
+        /// Afterwards `v` equals to the message decoded by `decode(b)`, 
+        /// but existing values of `v` are overwritten in place, i.e. strings, containers and elements of repeated messages,
+        /// so that decoding messages of similar shape in a loop reaches a steady state without allocations.
+        static constexpr bytes decode_reuse(T& v, bytes b, std::pmr::memory_resource* mr = nullptr) {
+            std::array<std::size_t, decode_map<T>.field_count> counts{};
+            decode_context ctx{mr, counts.data()};
+
+            instrument_scope<T> scope(instrument_event::decode);
+            const auto origin = b.size();
+
+            std::size_t hint = 0;
+            while(b.end() > b.begin()) {
+                bool next = true;
+                std::tie(b, next) = decode_map<T>.decode(v, b, hint, ctx);
+
+                if(!next) break;
+            }
+
+            decode_map<T>.trim(v, counts.data());
+            decode_map<T>.finish(v);
+            scope.processed(origin - b.size());
             return b;
         }
 
-        static constexpr decode_result<T> decode(bytes b) {
-            T v;
+        /// Same as `decode_reuse(v, b, mr)`, but never reads past the end of `b`, `v` is unspecified if decoding fails
+        static constexpr checked_result<bytes> checked_decode_reuse(T& v, bytes b, std::pmr::memory_resource* mr = nullptr) {
+            std::array<std::size_t, decode_map<T>.field_count> counts{};
+            decode_context ctx{mr, counts.data()};
 
+            instrument_scope<T> scope(instrument_event::decode);
+            const auto origin = b.size();
+
+            std::size_t hint = 0;
             while(b.end() > b.begin()) {
+                auto r = decode_map<T>.checked_decode(v, b, hint, ctx);
+                if(!r) {
+                    return r.error();
+                }
+
                 bool next = true;
-                std::tie(b, next) = decode_map<T>.decode(v, b);
+                std::tie(b, next) = *r;
 
                 if(!next) break;
             }
 
-            return {v, b};
+            decode_map<T>.trim(v, counts.data());
+            decode_map<T>.finish(v);
+            scope.processed(origin - b.size());
+            return b;
+        }
+
+        /// @brief Decode a message from `b`.
+        ///
+        /// If `mr` is not null, allocator-aware containers of the message (i.e. @ref pmr_string_field)
+        /// and of its embedded messages allocate from `mr`, so that a whole message tree can be decoded into an arena,
+        /// i.e. `std::pmr::monotonic_buffer_resource`, and freed in one shot.
+        static constexpr decode_result<T> decode(bytes b, std::pmr::memory_resource* mr = nullptr) {
+            T v = make_with_resource<T>(mr);
+            b = decode(v, b, mr);
+
+            return {std::move(v), b};
+        }
+
+        /// Same as `decode(v, b, mr)`, but never reads past the end of `b`, ref to `checked_decode(b, mr)`
+        static constexpr checked_result<bytes> checked_decode(T& v, bytes b, std::pmr::memory_resource* mr = nullptr) {
+            instrument_scope<T> scope(instrument_event::decode);
+            const auto origin = b.size();
+
+            std::size_t hint = 0;
+            while(b.end() > b.begin()) {
+                auto r = decode_map<T>.checked_decode(v, b, hint, mr);
+                if(!r) {
+                    return r.error();
+                }
+
+                bool next = true;
+                std::tie(b, next) = *r;
+
+                if(!next) break;
+            }
+
+            decode_map<T>.finish(v);
+            scope.processed(origin - b.size());
+            return b;
+        }
+
+        /// @brief Same as `decode(b)`, but never reads past the end of `b`.
+        ///
+        /// Every field is bounds-checked once by its coder, and length-delimited fields are decoded within their own length,
+        /// so malformed input results in a @ref decode_error instead of undefined behavior.
+        static constexpr checked_decode_result<T> checked_decode(bytes b, std::pmr::memory_resource* mr = nullptr) {
+            T v = make_with_resource<T>(mr);
+
+            auto r = checked_decode(v, b, mr);
+            if(!r) {
+                return r.error();
+            }
+
+            return decode_result<T>{std::move(v), *r};
         }
     };
 
@@ -396,22 +1708,42 @@ namespace pp {
                     return;
                 }
 
+                n += field_encode_skip(f);
+            });
 
-                if constexpr (F::attr == singular) {
-                    n += skipper<varint_coder<uint<4>>>::encode_skip(F::key);
-                    n += skipper<typename F::coder>::encode_skip(f.value());
-                } else {
-                    for(const auto &i : f) {
-                        n += skipper<varint_coder<uint<4>>>::encode_skip(F::key);
-                        n += skipper<typename F::coder>::encode_skip(i);
-                    }
+            return n;
+        }
+
+        /// @brief Get the encoded length of `msg`, the sizing pass of two-pass encoding.
+        ///
+        /// The sizes of all nested embedded messages and arrays are recorded into `cache`,
+        /// to be consumed by `message_coder<T>::encode(msg, b, cache)`.
+        static constexpr std::size_t encode_skip(const T& msg, size_cache& cache) {
+            std::size_t n = 0;
+            msg.for_each([&n, &cache]<field_c F> (const F& f) {
+                if(empty_field(f)) {
+                    return;
                 }
+
+                n += field_encode_skip(f, cache);
             });
 
             return n;
         }
     };
 
+    /// @brief Bytes of the message returned by `F` (a constexpr callable, i.e. a lambda without captures) encoded at compile time,
+    /// as an array of exactly the encoded length, i.e. to bake a static configuration blob into the binary
+    template <auto F> requires message_c<std::invoke_result_t<decltype(F)>>
+    inline constexpr auto constant_encode = [] {
+        using T = std::invoke_result_t<decltype(F)>;
+
+        std::array<std::byte, skipper<message_coder<T>>::encode_skip(F())> res{};
+        message_coder<T>::encode(F(), res);
+
+        return res;
+    }();
+
     /// @brief A @ref coder for embedded message
     ///
     /// Ref to https://developers.google.com/protocol-buffers/docs/encoding#embedded
@@ -430,24 +1762,81 @@ namespace pp {
             return b;
         }
 
-        static constexpr decode_result<T> decode(bytes b) {
-            T v;
+        /// Encode `msg` using its size recorded by `skipper<embedded_message_coder<T>>::encode_skip(msg, cache)`
+        static constexpr bytes encode(const T& msg, bytes b, size_cache& cache) {
+            b = varint_coder<uint<8>>::encode(cache.next(), b);
+            b = message_coder<T>::encode(msg, b, cache);
+
+            return b;
+        }
+
+        static constexpr decode_result<T> decode(bytes b, std::pmr::memory_resource* mr = nullptr) {
+            T v = make_with_resource<T>(mr);
 
             std::size_t len = 0;
             std::tie(len, b) = varint_coder<uint<8>>::decode(b);
 
-            auto origin_b = b;
-            while(begin_diff(b, origin_b) < len) {
-                bool next = true;
-                std::tie(b, next) = decode_map<T>.decode(v, b);
+            message_coder<T>::decode(v, b.subspan(0, len), mr);
 
-                if(!next) break;
+            return {std::move(v), b.subspan(len)};
+        }
+
+        /// Decode a message from `b` into `v` reusing its storage, ref to `message_coder<T>::decode_reuse`
+        static constexpr bytes decode_reuse(T& v, bytes b, std::pmr::memory_resource* mr = nullptr) {
+            std::size_t len = 0;
+            std::tie(len, b) = varint_coder<uint<8>>::decode(b);
+
+            message_coder<T>::decode_reuse(v, b.subspan(0, len), mr);
+
+            return b.subspan(len);
+        }
+
+        static constexpr checked_result<bytes> checked_decode_reuse(T& v, bytes b, std::pmr::memory_resource* mr = nullptr) {
+            auto lr = varint_coder<uint<8>>::checked_decode(b);
+            if(!lr) {
+                return lr.error();
+            }
+
+            auto [len, rest] = *lr;
+            if(len > rest.size()) {
+                return decode_error::length_overflow;
             }
 
-            return {v, b};
+            if(auto r = message_coder<T>::checked_decode_reuse(v, rest.subspan(0, len), mr); !r) {
+                return r.error();
+            }
+
+            return rest.subspan(len);
+        }
+
+        static constexpr checked_decode_result<T> checked_decode(bytes b, std::pmr::memory_resource* mr = nullptr) {
+            auto lr = varint_coder<uint<8>>::checked_decode(b);
+            if(!lr) {
+                return lr.error();
+            }
+
+            auto [len, rest] = *lr;
+            if(len > rest.size()) {
+                return decode_error::length_overflow;
+            }
+
+            T v = make_with_resource<T>(mr);
+
+            if(auto r = message_coder<T>::checked_decode(v, rest.subspan(0, len), mr); !r) {
+                return r.error();
+            }
+
+            return decode_result<T>{std::move(v), rest.subspan(len)};
         }
     };
 
+    /// Checks whether @ref coder `C` is an @ref embedded_message_coder
+    template <typename C>
+    constexpr bool is_embedded_coder = false;
+
+    template <message_c T>
+    constexpr bool is_embedded_coder<embedded_message_coder<T>> = true;
+
     template <typename T>
     struct skipper<embedded_message_coder<T>> {
         using value_type = T;
@@ -460,12 +1849,27 @@ namespace pp {
             return n;
         }
 
+        /// Same as `encode_skip(v)`, but records the size of `v` and its nested values into `cache`
+        static constexpr std::size_t encode_skip(const T& v, size_cache& cache) {
+            auto slot = cache.reserve();
+            uint<8> n = skipper<message_coder<T>>::encode_skip(v, cache);
+            cache.record(slot, n);
+
+            n += skipper<varint_coder<uint<8>>>::encode_skip(n);
+
+            return n;
+        }
+
         static constexpr bytes decode_skip(bytes b) {
             uint<8> n = 0;
             std::tie(n, b) = varint_coder<uint<8>>::decode(b);
 
             return b.subspan(n);
         }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            return skipper<array_coder<integer_coder<uint<1>>>>::checked_decode_skip(b);
+        }
     };
 
     template <typename T>
@@ -474,6 +1878,10 @@ namespace pp {
     /// Type alias for embedded message fields
     template <basic_fixed_string S, uint<4> N, typename T, attribute A = singular, typename Container = std::vector<T>>
     using message_field = field<S, N, embedded_message_coder<T>, A, Container>;
+
+    /// Type alias for embedded message fields, where repeated messages are stored in `std::pmr::vector`
+    template <basic_fixed_string S, uint<4> N, typename T, attribute A = singular, typename Container = std::pmr::vector<T>>
+    using pmr_message_field = message_field<S, N, T, A, Container>;
 }
 
 #endif //PROTOPUF_MESSAGE_H
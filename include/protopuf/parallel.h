@@ -0,0 +1,404 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_PARALLEL_H
+#define PROTOPUF_PARALLEL_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "message.h"
+
+namespace pp {
+
+    /// @brief Describes an executor of parallel tasks: `e(n, f)` invokes `f(i)` for every `i` in `[0, n)`, possibly concurrently,
+    /// and returns after all invocations complete
+    template <typename E>
+    concept executor = requires(E& e, std::size_t n, void (&f)(std::size_t)) {
+        e(n, f);
+    };
+
+    /// An @ref executor invoking all tasks in order in the calling thread
+    struct inline_executor {
+        template <std::invocable<std::size_t> F>
+        void operator()(std::size_t n, F&& f) const {
+            for(std::size_t i = 0; i < n; ++i) {
+                f(i);
+            }
+        }
+    };
+
+    /// @brief An @ref executor invoking tasks on up to `threads` threads (including the calling thread),
+    /// which are started per call and take tasks in order from a shared counter.
+    ///
+    /// If a task throws, no further tasks are started, and the first exception is rethrown in the calling thread
+    /// after all threads finish, as @ref inline_executor would throw it.
+    class thread_executor {
+        std::size_t threads;
+
+    public:
+        explicit thread_executor(std::size_t threads = std::max(1u, std::thread::hardware_concurrency())) : threads(threads) {}
+
+        template <std::invocable<std::size_t> F>
+        void operator()(std::size_t n, F&& f) const {
+            auto workers = std::min(threads, n);
+            if(workers <= 1) {
+                inline_executor{}(n, f);
+                return;
+            }
+
+            std::atomic<std::size_t> next = 0;
+            std::mutex m;
+            std::exception_ptr error;
+
+            auto run = [&next, &f, &m, &error, n] {
+                try {
+                    for(std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n;) {
+                        f(i);
+                    }
+                } catch(...) {
+                    // keep the first exception, and stop handing out remaining tasks
+                    next.store(n, std::memory_order_relaxed);
+
+                    std::lock_guard lock(m);
+                    if(!error) {
+                        error = std::current_exception();
+                    }
+                }
+            };
+
+            {
+                std::vector<std::jthread> pool;
+                pool.reserve(workers - 1);
+                for(std::size_t i = 1; i < workers; ++i) {
+                    pool.emplace_back(run);
+                }
+
+                run();
+            }
+
+            if(error) {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+
+    template <message_c>
+    struct parallel_coder;
+
+    /// @brief A coder of @ref message type encoding and decoding elements of large repeated fields concurrently on an @ref executor,
+    /// which produces and accepts the same bytes as @ref message_coder.
+    ///
+    /// Elements of a repeated length-delimited field (i.e. a `repeated` @ref message_field) in a resizable random access container
+    /// are split into tasks of `grain` elements:
+    /// - encoding sizes each task into its own @ref size_cache concurrently, computes output offsets of tasks by a prefix sum,
+    ///   and then writes tasks concurrently into disjoint regions of the output
+    /// - decoding scans boundaries of elements via their lengths (while other fields are decoded in order),
+    ///   and then decodes tasks concurrently into the pre-sized container
+    ///
+    /// Other fields are encoded and decoded in the calling thread.
+    template <field_c... F>
+    struct parallel_coder<message<F...>> {
+    private:
+        using T = message<F...>;
+
+        /// Checks whether elements of field `G` are encoded and decoded concurrently
+        template <field_c G>
+        static constexpr bool parallel_field = [] {
+            if constexpr (is_oneof<G> || is_unknown_fields<G>) {
+                return false;
+            } else {
+                return G::attr == repeated && wire_type<typename G::coder> == 2 &&
+                    std::ranges::random_access_range<typename G::base_type> &&
+                    requires(typename G::base_type& c, std::size_t n) { c.resize(n); };
+            }
+        }();
+
+        /// a task of elements in `[first, last)` of a field, or a whole field encoded in the calling thread
+        struct chunk {
+            std::size_t first = 0, last = 0;
+            size_cache cache;
+            std::size_t size = 0;
+        };
+
+        using plan = std::array<std::vector<chunk>, sizeof...(F)>;
+
+        /// split `n` elements into tasks of `grain` elements
+        static std::vector<chunk> split(std::size_t n, std::size_t grain) {
+            std::vector<chunk> res((n + grain - 1) / grain);
+            for(std::size_t i = 0; i < res.size(); ++i) {
+                res[i].first = i * grain;
+                res[i].last = std::min(n, (i + 1) * grain);
+            }
+
+            return res;
+        }
+
+        /// the sizing pass: record tasks of all non-empty fields into `p`, returns the encoded length of `msg`
+        template <executor E>
+        static std::size_t size(const T& msg, plan& p, E& exec, std::size_t grain) {
+            std::size_t total = 0, i = 0;
+
+            msg.for_each([&]<field_c G> (const G& f) {
+                auto& chunks = p[i++];
+                if(empty_field(f)) {
+                    return;
+                }
+
+                if constexpr (parallel_field<G>) {
+                    chunks = split(std::ranges::size(f), grain);
+
+                    exec(chunks.size(), [&f, &chunks](std::size_t k) {
+                        auto& c = chunks[k];
+                        for(std::size_t j = c.first; j < c.last; ++j) {
+                            c.size += skipper<varint_coder<uint<4>>>::encode_skip(G::key);
+                            c.size += cached_encode_skip<typename G::coder>(std::ranges::begin(f)[j], c.cache);
+                        }
+                    });
+                } else {
+                    auto& c = chunks.emplace_back();
+                    c.size = field_encode_skip(f, c.cache);
+                }
+
+                for(const auto& c : chunks) {
+                    total += c.size;
+                }
+            });
+
+            return total;
+        }
+
+        /// the writing pass: write tasks recorded in `p` into `b`, returns the remaining bytes
+        template <executor E>
+        static bytes write(const T& msg, bytes b, plan& p, E& exec) {
+            std::size_t i = 0;
+
+            msg.for_each([&]<field_c G> (const G& f) {
+                auto& chunks = p[i++];
+                if(chunks.empty()) {
+                    return;
+                }
+
+                if constexpr (parallel_field<G>) {
+                    std::vector<std::size_t> offsets(chunks.size() + 1);
+                    std::transform_inclusive_scan(chunks.begin(), chunks.end(), offsets.begin() + 1, std::plus<>{},
+                        [](const chunk& c) { return c.size; });
+
+                    exec(chunks.size(), [&f, &chunks, &offsets, b](std::size_t k) {
+                        auto& c = chunks[k];
+                        auto out = b.subspan(offsets[k], c.size);
+
+                        for(std::size_t j = c.first; j < c.last; ++j) {
+                            out = encode_constant_varint<G::key>(out);
+                            out = cached_encode<typename G::coder>(std::ranges::begin(f)[j], out, c.cache);
+                        }
+                    });
+
+                    b = b.subspan(offsets.back());
+                } else {
+                    b = encode_field(f, b, chunks.front().cache);
+                }
+            });
+
+            return b;
+        }
+
+        /// get the index of the field decoded concurrently with field key `key`, or `sizeof...(F)` if none
+        static constexpr std::size_t parallel_index(uint<4> key) {
+            std::size_t i = 0, res = sizeof...(F);
+            ([&] {
+                if constexpr (parallel_field<F>) {
+                    if(key == F::key) {
+                        res = i;
+                    }
+                }
+                ++i;
+            }(), ...);
+
+            return res;
+        }
+
+        /// decode elements of field `G` from `records` concurrently, appending them to the field in `v`
+        template <field_c G, executor E>
+        static void decode_elements(T& v, const std::vector<bytes>& records, E& exec, std::size_t grain) {
+            auto& f = v.template get<G::number>();
+            auto base = std::ranges::size(f);
+            f.resize(base + records.size());
+
+            auto chunks = split(records.size(), grain);
+            exec(chunks.size(), [&f, &chunks, &records, base](std::size_t k) {
+                for(std::size_t j = chunks[k].first; j < chunks[k].last; ++j) {
+                    std::ranges::begin(f)[base + j] = G::coder::decode(records[j]).first;
+                }
+            });
+        }
+
+        /// Same as `decode_elements<G>(v, records, exec, grain)`, returns the first @ref decode_error of elements if any
+        template <field_c G, executor E>
+        static std::optional<decode_error> checked_decode_elements(T& v, const std::vector<bytes>& records, E& exec, std::size_t grain) {
+            auto& f = v.template get<G::number>();
+            auto base = std::ranges::size(f);
+            f.resize(base + records.size());
+
+            auto chunks = split(records.size(), grain);
+            std::vector<std::optional<decode_error>> errors(chunks.size());
+
+            exec(chunks.size(), [&f, &chunks, &records, &errors, base](std::size_t k) {
+                for(std::size_t j = chunks[k].first; j < chunks[k].last; ++j) {
+                    auto r = G::coder::checked_decode(records[j]);
+                    if(!r) {
+                        errors[k] = r.error();
+                        return;
+                    }
+
+                    std::ranges::begin(f)[base + j] = std::move(r->first);
+                }
+            });
+
+            for(auto e : errors) {
+                if(e) {
+                    return e;
+                }
+            }
+
+            return std::nullopt;
+        }
+
+    public:
+        using value_type = T;
+
+        parallel_coder() = delete;
+
+        /// the default number of elements in a task
+        static constexpr std::size_t default_grain = 256;
+
+        /// Encode `msg` into `b`, which must be large enough (ref to `skipper<message_coder<T>>::encode_skip`), returns the remaining bytes
+        template <executor E>
+        static bytes encode(const T& msg, bytes b, E& exec, std::size_t grain = default_grain) {
+            plan p;
+            size(msg, p, exec, grain);
+
+            return write(msg, b, p, exec);
+        }
+
+        /// Encode `msg` into a new vector of exactly the encoded length
+        template <executor E>
+        static std::vector<std::byte> encode(const T& msg, E& exec, std::size_t grain = default_grain) {
+            plan p;
+            std::vector<std::byte> res(size(msg, p, exec, grain));
+
+            write(msg, res, p, exec);
+
+            return res;
+        }
+
+        /// Decode a message from `b`, ref to `message_coder<T>::decode(b)`
+        template <executor E>
+        static decode_result<T> decode(bytes b, E& exec, std::size_t grain = default_grain) {
+            T v;
+            std::array<std::vector<bytes>, sizeof...(F)> records;
+
+            std::size_t hint = 0;
+            while(b.end() > b.begin()) {
+                const auto &[n, nb] = varint_coder<uint<4>>::decode(b);
+
+                if(auto i = parallel_index(n); i < sizeof...(F)) {
+                    auto e = wire_skip<2>::decode_skip(nb);
+                    records[i].emplace_back(nb.data(), e.data());
+                    b = e;
+                } else {
+                    bool next = true;
+                    std::tie(b, next) = decode_map<T>.decode(v, b, hint);
+
+                    if(!next) break;
+                }
+            }
+
+            std::size_t i = 0;
+            ([&] {
+                if constexpr (parallel_field<F>) {
+                    decode_elements<F>(v, records[i], exec, grain);
+                }
+                ++i;
+            }(), ...);
+
+            decode_map<T>.finish(v);
+            return {std::move(v), b};
+        }
+
+        /// Same as `decode(b, exec, grain)`, but never reads past the end of `b`, ref to `message_coder<T>::checked_decode(b)`
+        template <executor E>
+        static checked_decode_result<T> checked_decode(bytes b, E& exec, std::size_t grain = default_grain) {
+            T v;
+            std::array<std::vector<bytes>, sizeof...(F)> records;
+
+            std::size_t hint = 0;
+            while(b.end() > b.begin()) {
+                auto k = varint_coder<uint<4>>::checked_decode(b);
+                if(!k) {
+                    return k.error();
+                }
+
+                const auto &[n, nb] = *k;
+
+                if(auto i = parallel_index(n); i < sizeof...(F)) {
+                    auto e = wire_skip<2>::checked_decode_skip(nb);
+                    if(!e) {
+                        return e.error();
+                    }
+
+                    records[i].emplace_back(nb.data(), e->data());
+                    b = *e;
+                } else {
+                    auto r = decode_map<T>.checked_decode(v, b, hint);
+                    if(!r) {
+                        return r.error();
+                    }
+
+                    bool next = true;
+                    std::tie(b, next) = *r;
+
+                    if(!next) break;
+                }
+            }
+
+            std::optional<decode_error> err;
+            std::size_t i = 0;
+            ([&] {
+                if constexpr (parallel_field<F>) {
+                    if(!err) {
+                        err = checked_decode_elements<F>(v, records[i], exec, grain);
+                    }
+                }
+                ++i;
+            }(), ...);
+
+            if(err) {
+                return *err;
+            }
+
+            decode_map<T>.finish(v);
+            return decode_result<T>{std::move(v), b};
+        }
+    };
+
+}
+
+#endif //PROTOPUF_PARALLEL_H
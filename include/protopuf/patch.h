@@ -0,0 +1,100 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_PATCH_H
+#define PROTOPUF_PATCH_H
+
+#include <array>
+#include "message.h"
+#include "view.h"
+
+namespace pp {
+
+    /// The outcome of @ref patch_field
+    struct patch_result {
+        /// the number of occurrences of the field found in the encoded message
+        std::size_t found = 0;
+
+        /// @brief Whether all found occurrences are overwritten, 
+        /// which fails (and nothing is written) if the new value is encoded in a different length than some occurrence
+        bool patched = false;
+    };
+
+    /// Checks whether values of field `F` can be overwritten in place, which holds for singular fields of scalar types
+    template <field_c F>
+    constexpr bool patchable_field = F::attr == singular && wire_type<typename F::coder> != 2;
+
+    /// @brief Overwrite every occurrence of field `F` in the encoded message `b` with value `v` in place,
+    /// without decoding or re-encoding other fields.
+    ///
+    /// Fields are scanned by their keys and skipped by @ref checked_skip_wire (embedded messages are not scanned into).
+    /// Fixed-length values (i.e. `fixed64`, `sfixed32`, `float`) are always overwritten,
+    /// while varint values are overwritten only if the new value is encoded in the same length.
+    /// The whole message is validated before anything is written, so `b` is untouched unless all occurrences are patched.
+    /// @returns a @ref patch_result, or the @ref decode_error if `b` is malformed
+    template <field_c F> requires patchable_field<F>
+    constexpr checked_result<patch_result> patch_field(bytes b, const typename F::coder::value_type& v) {
+        std::array<std::byte, 10> buf{};
+        const std::size_t len = begin_diff(F::coder::encode(v, buf), buf);
+
+        patch_result res;
+        bool mismatched = false;
+
+        for(bool writing : {false, true}) {
+            bytes s = b;
+            while(s.end() > s.begin()) {
+                auto k = varint_coder<uint<4>>::checked_decode(s);
+                if(!k) {
+                    return k.error();
+                }
+
+                const auto &[n, nb] = *k;
+                if(to_field_number(n) == 0) {
+                    break;
+                }
+
+                auto r = checked_skip_wire(to_wire_key(n), nb);
+                if(!r) {
+                    return r.error();
+                }
+
+                if(n == F::key) {
+                    if(writing) {
+                        copy_bytes(buf.data(), len, nb);
+                    } else {
+                        ++res.found;
+                        mismatched = mismatched || begin_diff(*r, nb) != len;
+                    }
+                }
+
+                s = *r;
+            }
+
+            if(res.found == 0 || mismatched) {
+                return res;
+            }
+        }
+
+        res.patched = true;
+        return res;
+    }
+
+    /// Same as `patch_field<F>(b, v)`, where `F` is the field of message `T` selected by `S`, i.e. `patch_field<Metric, "timestamp"_f>(b, v)`
+    template <message_c T, auto S>
+    constexpr auto patch_field(bytes b, const typename T::template get_type_by_number<field_selector_number<T, S>>::coder::value_type& v) {
+        return patch_field<typename T::template get_type_by_number<field_selector_number<T, S>>>(b, v);
+    }
+}
+
+#endif //PROTOPUF_PATCH_H
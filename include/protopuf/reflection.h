@@ -17,6 +17,13 @@
 
 #include "message.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
 namespace pp {
 
     /// Make `false` a dependent name
@@ -63,37 +70,139 @@ namespace pp {
     template <template<typename> typename Prop, field_c T>
     using dynamic_key_type = typename dynamic_key_type_impl<Prop, T>::type;
 
+    /// @brief A lookup from run-time values of property `Prop` to indices of fields `Ts...`, generated at compile time
+    /// @param Prop the getter, which can be @ref field_name or @ref field_number
+    template <template<typename> typename Prop, field_c... Ts>
+    struct dynamic_lookup;
+
+    /// @brief Lookup of field numbers, through a dense table indexed by field number if numbers are small enough,
+    /// or binary search over sorted numbers otherwise
+    template <field_c... Ts>
+    struct dynamic_lookup<field_number, Ts...> {
+        using key_type = dynamic_key_type<field_number, type_get_first<Ts...>>;
+
+        /// the index returned if the key is not found
+        static constexpr std::size_t npos = sizeof...(Ts);
+
+        static constexpr key_type max_key = std::max({key_type{field_number<Ts>::value}...});
+
+        /// whether the dense table is used, which holds while its length is at most 4 times of the number of fields (plus some slack)
+        static constexpr bool dense = max_key < 4 * sizeof...(Ts) + 16;
+
+        static constexpr auto table = [] {
+            constexpr std::array<key_type, sizeof...(Ts)> keys{field_number<Ts>::value...};
+
+            if constexpr (dense) {
+                std::array<std::size_t, max_key + 1> res{};
+                res.fill(npos);
+                for(std::size_t i = keys.size(); i-- > 0;) {
+                    res[keys[i]] = i;
+                }
+                return res;
+            } else {
+                std::array<std::pair<key_type, std::size_t>, sizeof...(Ts)> res{};
+                for(std::size_t i = 0; i < keys.size(); ++i) {
+                    res[i] = {keys[i], i};
+                }
+                std::sort(res.begin(), res.end());
+                return res;
+            }
+        }();
+
+        /// find the index of field by field number `key`, returns @ref npos if not found
+        static constexpr std::size_t find(key_type key) {
+            if constexpr (dense) {
+                return key <= max_key ? table[key] : npos;
+            } else {
+                auto iter = std::lower_bound(table.begin(), table.end(), key, [](const auto& p, key_type k) {
+                    return p.first < k;
+                });
+
+                return iter != table.end() && iter->first == key ? iter->second : npos;
+            }
+        }
+    };
+
+    /// @brief Lookup of field names, through a perfect hash table:
+    /// a table size and a seed of FNV-1a hashing are searched at compile time, so that all field names hash to distinct slots,
+    /// and a lookup takes one hash and one string comparison
+    template <field_c... Ts>
+    struct dynamic_lookup<field_name, Ts...> {
+        using key_type = dynamic_key_type<field_name, type_get_first<Ts...>>;
+
+        /// the index returned if the key is not found
+        static constexpr std::size_t npos = sizeof...(Ts);
+
+        static constexpr std::array<key_type, sizeof...(Ts)> keys{key_type{field_name<Ts>::value}...};
+
+        static constexpr std::uint64_t hash(key_type key, std::uint64_t seed) {
+            std::uint64_t h = 0xcbf29ce484222325ull ^ seed;
+            for(auto c : key) {
+                h ^= static_cast<std::make_unsigned_t<typename key_type::value_type>>(c);
+                h *= 0x100000001b3ull;
+            }
+
+            return h ^ (h >> 29u);
+        }
+
+        /// the table size (a power of two) and the seed, where all keys hash to distinct slots
+        static constexpr std::pair<std::size_t, std::uint64_t> parameters = [] {
+            for(std::size_t size = std::bit_ceil(2 * keys.size());; size *= 2) {
+                for(std::uint64_t seed = 0; seed < 256; ++seed) {
+                    std::vector<bool> used(size);
+
+                    bool distinct = true;
+                    for(auto key : keys) {
+                        auto slot = hash(key, seed) & (size - 1);
+                        distinct = distinct && !used[slot];
+                        used[slot] = true;
+                    }
+
+                    if(distinct) {
+                        return std::pair{size, seed};
+                    }
+                }
+            }
+        }();
+
+        static constexpr std::array<std::size_t, parameters.first> table = [] {
+            std::array<std::size_t, parameters.first> res{};
+            res.fill(npos);
+            for(std::size_t i = 0; i < keys.size(); ++i) {
+                res[hash(keys[i], parameters.second) & (parameters.first - 1)] = i;
+            }
+            return res;
+        }();
+
+        /// find the index of field by field name `key`, returns @ref npos if not found
+        static constexpr std::size_t find(key_type key) {
+            auto i = table[hash(key, parameters.second) & (parameters.first - 1)];
+            return i != npos && keys[i] == key ? i : npos;
+        }
+    };
+
     template <template<typename> typename Prop, typename F, template <typename ...> typename M, typename... Ts>
         requires std::conjunction_v<std::bool_constant<std::invocable<F, Ts>>...> && message_c<std::remove_cv_t<M<Ts...>>>
     struct dynamic_visit_impl {
 
         using message_type = M<Ts...>;
         using result_type = std::common_type_t<std::invoke_result_t<F, Ts>...>;
-        using key_type = dynamic_key_type<Prop, type_get_first<Ts...>>;
-
-        static inline const std::unordered_map <key_type, std::function<
-            result_type (F&&, message_type&)
-        >> reflect_map = {
-            {key_type { Prop<Ts>::value }, [](F&& f, message_type& msg){
-                return std::forward<F>(f)(msg.template get<Prop<Ts>::value>());
-            }}...
-        };
+        using lookup = dynamic_lookup<Prop, Ts...>;
+        using key_type = typename lookup::key_type;
 
+        /// find the field by `key` via @ref dynamic_lookup, and dispatch the found index to `f` over a chain of comparisons
         static auto visit(F&& f, message_type& msg, const key_type& key) {
-            if(auto iter = reflect_map.find(key); iter != reflect_map.end()) {
+            auto i = lookup::find(key);
+
+            return [&]<std::size_t... I>(std::index_sequence<I...>) {
                 if constexpr (std::is_same_v<result_type, void>) {
-                    iter->second(std::forward<F>(f), msg);
-                    return true;
+                    return ((i == I ? (std::forward<F>(f)(msg.template get<Prop<Ts>::value>()), true) : false) || ...);
                 } else {
-                    return std::optional{iter->second(std::forward<F>(f), msg)};
+                    std::optional<result_type> res;
+                    ((i == I ? (res.emplace(std::forward<F>(f)(msg.template get<Prop<Ts>::value>())), true) : false) || ...);
+                    return res;
                 }
-            }
-
-            if constexpr (std::is_same_v<result_type, void>) {
-                return false;
-            } else {
-                return std::optional<result_type>{};
-            }
+            }(std::index_sequence_for<Ts...>{});
         }
     };
 
@@ -0,0 +1,200 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_SINK_H
+#define PROTOPUF_SINK_H
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <concepts>
+#include <utility>
+#include "coder.h"
+#include "view.h"
+
+namespace pp {
+
+    /// @brief A growable output destination for encoding.
+    ///
+    /// Encoding into a sink is done in steps: `reserve(n)` returns writable bytes of length exactly `n`,
+    /// which stays valid until the next `reserve`, and `commit(n)` marks these `n` bytes as written.
+    /// Space is reserved per field (ref to `message_coder<T>::encode(msg, sink)`), 
+    /// so overflow is checked once per field instead of once per byte.
+    template <typename S>
+    concept sink = requires(S s, std::size_t n) {
+        { s.reserve(n) } -> std::same_as<bytes>;
+        s.commit(n);
+    };
+
+    /// @brief A @ref sink appending to a `std::vector<std::byte>`.
+    ///
+    /// The vector is grown by `resize` with some slop, and is trimmed to the written length while the sink is destroyed.
+    class vector_sink {
+        std::vector<std::byte>& buf;
+        std::size_t pos;
+
+    public:
+        /// Minimum extra bytes allocated while growing
+        static constexpr std::size_t slop = 64;
+
+        /// Construct a sink appending to the end of `buf`
+        explicit vector_sink(std::vector<std::byte>& buf) : buf(buf), pos(buf.size()) {}
+
+        vector_sink(const vector_sink&) = delete;
+        vector_sink& operator=(const vector_sink&) = delete;
+
+        ~vector_sink() {
+            buf.resize(pos);
+        }
+
+        bytes reserve(std::size_t n) {
+            if(buf.size() - pos < n) {
+                buf.resize(std::max(pos + n + slop, buf.size() * 2));
+            }
+
+            return {buf.data() + pos, n};
+        }
+
+        void commit(std::size_t n) {
+            pos += n;
+        }
+
+        /// The length of the vector including bytes written so far
+        std::size_t size() const {
+            return pos;
+        }
+    };
+
+    /// @brief A @ref sink writing into a chain of fixed-size chunks, so that huge messages are never reallocated or moved.
+    ///
+    /// A reservation larger than the chunk size gets a dedicated chunk.
+    class chunked_sink {
+        struct chunk {
+            std::unique_ptr<std::byte[]> data;
+            std::size_t capacity = 0;
+            std::size_t size = 0;
+        };
+
+        std::vector<chunk> list;
+        std::size_t chunk_size;
+        std::size_t total = 0;
+
+    public:
+        /// Construct a sink allocating chunks of `chunk_size` bytes
+        explicit chunked_sink(std::size_t chunk_size = 64 * 1024) : chunk_size(chunk_size) {}
+
+        bytes reserve(std::size_t n) {
+            if(list.empty() || list.back().capacity - list.back().size < n) {
+                auto capacity = std::max(n, chunk_size);
+                list.push_back({std::make_unique_for_overwrite<std::byte[]>(capacity), capacity, 0});
+            }
+
+            auto& c = list.back();
+            return {c.data.get() + c.size, n};
+        }
+
+        void commit(std::size_t n) {
+            list.back().size += n;
+            total += n;
+        }
+
+        /// The total number of bytes written
+        std::size_t size() const {
+            return total;
+        }
+
+        /// Written bytes in order, one (non-empty) view per chunk
+        std::vector<const_bytes> chunks() const {
+            std::vector<const_bytes> res;
+            res.reserve(list.size());
+
+            for(const auto& c : list) {
+                if(c.size > 0) {
+                    res.emplace_back(c.data.get(), c.size);
+                }
+            }
+
+            return res;
+        }
+
+        /// Copy all written bytes into a contiguous vector
+        std::vector<std::byte> to_vector() const {
+            std::vector<std::byte> res;
+            res.reserve(total);
+
+            for(const auto& c : list) {
+                res.insert(res.end(), c.data.get(), c.data.get() + c.size);
+            }
+
+            return res;
+        }
+    };
+
+    /// @brief A @ref sink staging written bytes in a buffer and handing them to a user-supplied writer `F`,
+    /// which is invoked with @ref const_bytes, i.e. to write them to a file or socket.
+    ///
+    /// The writer is invoked while the buffer is full, by `flush()` and finally while the sink is destroyed,
+    /// so call `flush()` explicitly if the written bytes are needed before that.
+    ///
+    /// Exceptions thrown by the writer propagate from `reserve` and `flush`, where the staged bytes are discarded,
+    /// but are caught and dropped in the destructor, so call `flush()` explicitly to handle errors of the final write.
+    template <std::invocable<const_bytes> F>
+    class callback_sink {
+        F writer;
+        std::vector<std::byte> buf;
+        std::size_t pos = 0;
+
+    public:
+        /// Construct a sink with `writer` and a staging buffer of `buffer_size` bytes
+        explicit callback_sink(F writer, std::size_t buffer_size = 4096) : writer(std::move(writer)), buf(buffer_size) {}
+
+        callback_sink(const callback_sink&) = delete;
+        callback_sink& operator=(const callback_sink&) = delete;
+
+        ~callback_sink() {
+            try {
+                flush();
+            } catch(...) {
+                // the destructor may run while unwinding, where nothing can be reported
+            }
+        }
+
+        bytes reserve(std::size_t n) {
+            if(buf.size() - pos < n) {
+                flush();
+
+                if(buf.size() < n) {
+                    buf.resize(n);
+                }
+            }
+
+            return {buf.data() + pos, n};
+        }
+
+        void commit(std::size_t n) {
+            pos += n;
+        }
+
+        /// Hand all staged bytes to the writer
+        void flush() {
+            if(pos > 0) {
+                auto n = std::exchange(pos, 0);
+                writer(const_bytes{buf.data(), n});
+            }
+        }
+    };
+
+}
+
+#endif //PROTOPUF_SINK_H
@@ -23,6 +23,8 @@
 #include "bool.h"
 #include "enum.h"
 
+#include <vector>
+
 namespace pp {
 
     /// @brief A concept statisfied while `T::coder` is a @ref coder and 
@@ -59,6 +61,18 @@ namespace pp {
     template <typename T>
     concept skipper_c = encode_skipper<T> && decode_skipper<T>;
 
+    /// @brief A concept statisfied while type `T` has static member function `checked_decode_skip`,
+    /// which skips the bytes like `decode_skip` does, but never reads past the end of the bytes.
+    ///
+    /// Static member function `checked_decode_skip`:
+    /// @param v the bytes to be decoded from
+    /// @returns a @ref checked_result holding the bytes from `begin(v) + decoded_object_length` to `end(v)`,
+    /// or the @ref decode_error if the bytes are malformed
+    template <typename T>
+    concept checked_decode_skipper = requires(bytes v) {
+        { T::checked_decode_skip(v) } -> std::same_as<checked_result<bytes>>;
+    };
+
     /// @brief The implementations of @ref skipper_c
     /// @param C the corresponding @ref coder to the skipper
     template <coder C>
@@ -76,6 +90,14 @@ namespace pp {
         static constexpr bytes decode_skip(bytes b) {
             return b.subspan<sizeof(T)>();
         }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            if(b.size() < sizeof(T)) {
+                return decode_error::truncated;
+            }
+
+            return decode_skip(b);
+        }
     };
 
     template <typename T>
@@ -90,6 +112,14 @@ namespace pp {
         static constexpr bytes decode_skip(bytes b) {
             return b.subspan<sizeof(T)>();
         }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            if(b.size() < sizeof(T)) {
+                return decode_error::truncated;
+            }
+
+            return decode_skip(b);
+        }
     };
 
     template <std::unsigned_integral T>
@@ -98,21 +128,42 @@ namespace pp {
         using value_type = T;
 
         static constexpr std::size_t encode_skip(T v) {
-            std::size_t n = 0;
-
-            do {
-                v >>= 7, ++n;
-            } while(v != 0);
-
-            return n;
+            return varint_size(v);
         }
 
         static constexpr bytes decode_skip(bytes b) {
+            if constexpr (varint_word_impl) {
+                if(!std::is_constant_evaluated() && b.size() >= 8) {
+                    if(auto len = varint_word_length(varint_load_word(b.data()))) {
+                        return b.subspan(len);
+                    }
+                }
+            }
+
             auto iter = b.begin();
             while((*iter++ >> 7) == 1_b) {}
 
             return {iter, b.end()};
         }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            if constexpr (varint_word_impl) {
+                if(!std::is_constant_evaluated() && b.size() >= 8) {
+                    if(auto len = varint_word_length(varint_load_word(b.data()))) {
+                        return b.subspan(len);
+                    }
+                }
+            }
+
+            auto limit = std::min(b.size(), max_varint_size);
+            for(std::size_t i = 0; i < limit; ++i) {
+                if((b[i] >> 7) == 0_b) {
+                    return b.subspan(i + 1);
+                }
+            }
+
+            return limit == max_varint_size ? decode_error::overlong_varint : decode_error::truncated;
+        }
     };
 
     template <std::signed_integral T>
@@ -127,6 +178,10 @@ namespace pp {
         static constexpr bytes decode_skip(bytes b) {
             return skipper<varint_coder<std::make_unsigned_t<T>>>::decode_skip(b);
         }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            return skipper<varint_coder<std::make_unsigned_t<T>>>::checked_decode_skip(b);
+        }
     };
 
     template <std::size_t N>
@@ -145,6 +200,10 @@ namespace pp {
         static constexpr bytes decode_skip(bytes b) {
             return skipper<varint_coder<uint<N>>>::decode_skip(b);
         }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            return skipper<varint_coder<uint<N>>>::checked_decode_skip(b);
+        }
     };
 
     template <>
@@ -160,6 +219,10 @@ namespace pp {
         static constexpr bytes decode_skip(bytes b) {
             return skipper<integer_coder<uint<1>>>::decode_skip(b);
         }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            return skipper<integer_coder<uint<1>>>::checked_decode_skip(b);
+        }
     };
 
     template <typename T>
@@ -173,10 +236,79 @@ namespace pp {
         }
 
         static constexpr bytes decode_skip(bytes b) {
-            return skipper<integer_coder<std::underlying_type_t<T>>>::decode_skip(b);
+            return skipper<varint_coder<std::underlying_type_t<T>>>::decode_skip(b);
+        }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            return skipper<varint_coder<std::underlying_type_t<T>>>::checked_decode_skip(b);
+        }
+    };
+
+
+    /// @brief A scratch buffer of encoded sizes for two-pass encoding.
+    ///
+    /// The sizing pass (`encode_skip(v, cache)`) records the payload size of every nested length-delimited value
+    /// (i.e. embedded messages and arrays) in pre-order, and the writing pass (`encode(v, b, cache)`) consumes them
+    /// in the same order, so that every value is sized only once regardless of nesting depth.
+    /// The cache can be cleared and reused to avoid reallocating across encodings.
+    class size_cache {
+        std::vector<std::size_t> sizes;
+        std::size_t cursor = 0;
+
+    public:
+        /// Reserve a slot for a size to be recorded later, returns the index of the slot
+        constexpr std::size_t reserve() {
+            sizes.push_back(0);
+            return sizes.size() - 1;
+        }
+
+        /// Record size `n` into the slot with index `i`
+        constexpr void record(std::size_t i, std::size_t n) {
+            sizes[i] = n;
+        }
+
+        /// Consume the next recorded size
+        constexpr std::size_t next() {
+            return sizes[cursor++];
+        }
+
+        /// Restart consuming from the first recorded size
+        constexpr void rewind() {
+            cursor = 0;
+        }
+
+        /// Remove all recorded sizes
+        constexpr void clear() {
+            sizes.clear();
+            cursor = 0;
+        }
+
+        /// The number of recorded sizes
+        constexpr std::size_t size() const {
+            return sizes.size();
         }
     };
 
+    /// Get the encoded length of `v` via `skipper<C>`, recording nested sizes into `cache` if the skipper supports it
+    template <coder C>
+    constexpr std::size_t cached_encode_skip(const typename C::value_type& v, size_cache& cache) {
+        if constexpr (requires { skipper<C>::encode_skip(v, cache); }) {
+            return skipper<C>::encode_skip(v, cache);
+        } else {
+            return skipper<C>::encode_skip(v);
+        }
+    }
+
+    /// Encode `v` via `C`, consuming nested sizes from `cache` (recorded by @ref cached_encode_skip) if `C` supports it
+    template <coder C>
+    constexpr bytes cached_encode(const typename C::value_type& v, bytes b, size_cache& cache) {
+        if constexpr (requires { C::encode(v, b, cache); }) {
+            return C::encode(v, b, cache);
+        } else {
+            return C::encode(v, b);
+        }
+    }
+
 }
 
 #endif //PROTOPUF_SKIP_H
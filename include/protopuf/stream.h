@@ -0,0 +1,221 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_STREAM_H
+#define PROTOPUF_STREAM_H
+
+#include <algorithm>
+#include <vector>
+#include <optional>
+#include <ranges>
+#include "message.h"
+
+namespace pp {
+
+    /// @brief Get the number of bytes still missing from `b` to hold the first whole field (with its key).
+    /// @returns `0` if the first field is complete in `b`, otherwise a lower bound of the missing bytes (exact once its key and length are complete),
+    /// or the @ref decode_error if the available bytes are already malformed
+    inline constexpr checked_result<std::size_t> missing_field_bytes(bytes b) {
+        auto k = varint_coder<uint<4>>::checked_decode(b);
+        if(!k) {
+            return k.error() == decode_error::truncated ? checked_result<std::size_t>(1) : k.error();
+        }
+
+        const auto& [key, rest] = *k;
+
+        switch(to_wire_key(key)) {
+            case 0: {
+                auto r = skipper<varint_coder<uint<8>>>::checked_decode_skip(rest);
+                if(!r) {
+                    return r.error() == decode_error::truncated ? checked_result<std::size_t>(1) : r.error();
+                }
+
+                return std::size_t(0);
+            }
+            case 1: return rest.size() < 8 ? 8 - rest.size() : 0;
+            case 5: return rest.size() < 4 ? 4 - rest.size() : 0;
+            case 2: {
+                auto r = varint_coder<uint<8>>::checked_decode(rest);
+                if(!r) {
+                    return r.error() == decode_error::truncated ? checked_result<std::size_t>(1) : r.error();
+                }
+
+                const auto& [len, payload] = *r;
+                return len > payload.size() ? len - payload.size() : 0;
+            }
+            default: return decode_error::bad_wire_type;
+        }
+    }
+
+    /// @brief A resumable decoder of @ref message type `T` over segmented or incremental input.
+    ///
+    /// Input is fed segment by segment via `feed`, i.e. buffers of a chain or partial reads from a socket.
+    /// Complete fields are decoded directly from the fed segments, 
+    /// and only a field straddling segment boundaries is copied into an internal buffer until it is complete,
+    /// so the whole message is never buffered, i.e. elements of a huge repeated field can be consumed (and removed) via `value()` while streaming.
+    ///
+    /// A straddling field is buffered whole (up to its end) before it is decoded, so the buffer grows to the size of
+    /// the largest such field, i.e. a big packed or bytes field split across segments is held once in memory.
+    template <message_c T>
+    class stream_decoder {
+        T msg{};
+        std::vector<std::byte> pending;
+        std::size_t hint = 0;
+        std::optional<decode_error> err;
+
+        /// the maximum length of a key (5 bytes) followed by a length or a varint (10 bytes)
+        static constexpr std::size_t max_header_size = 15;
+
+        constexpr bool fail(decode_error e) {
+            err = e;
+            return false;
+        }
+
+        /// decode exactly one complete field from the front of `b`
+        constexpr std::optional<bytes> decode_field(bytes b) {
+            auto r = decode_map<T>.checked_decode(msg, b, hint);
+            if(!r) {
+                fail(r.error());
+                return std::nullopt;
+            }
+
+            // contiguous decoding stops before a key with field number 0 (i.e. zero padding) and returns the remaining bytes,
+            // which cannot be handed back from a stream, so it is reported as an error here
+            if(!r->second) {
+                fail(decode_error::invalid_field_number);
+                return std::nullopt;
+            }
+
+            return r->first;
+        }
+
+    public:
+        /// @brief Feed the next segment of input bytes `b`, which is not referenced after returning.
+        /// @returns `false` if the input is malformed, ref to `error()`
+        constexpr bool feed(bytes b) {
+            if(err) {
+                return false;
+            }
+
+            while(!pending.empty() && !b.empty()) {
+                auto need = missing_field_bytes(pending);
+                if(!need) {
+                    return fail(need.error());
+                }
+
+                // `need` is only a lower bound while the key or the length is incomplete,
+                // so take enough bytes to complete them in one step, and give back the bytes after the end of the field
+                auto from = b;
+                auto take = std::min(std::max(*need, max_header_size), b.size());
+                pending.insert(pending.end(), b.begin(), b.begin() + take);
+                b = b.subspan(take);
+
+                need = missing_field_bytes(pending);
+                if(!need) {
+                    return fail(need.error());
+                }
+
+                if(*need == 0) {
+                    auto rest = decode_field(pending);
+                    if(!rest) {
+                        return false;
+                    }
+
+                    b = from.subspan(take - rest->size());
+                    pending.clear();
+                }
+            }
+
+            while(!b.empty()) {
+                auto need = missing_field_bytes(b);
+                if(!need) {
+                    return fail(need.error());
+                }
+
+                if(*need > 0) {
+                    pending.assign(b.begin(), b.end());
+                    break;
+                }
+
+                auto rest = decode_field(b);
+                if(!rest) {
+                    return false;
+                }
+
+                b = *rest;
+            }
+
+            return true;
+        }
+
+        /// Whether all fed bytes are decoded, i.e. the input may end here
+        constexpr bool at_boundary() const {
+            return !err && pending.empty();
+        }
+
+        /// The number of bytes buffered for a field straddling segment boundaries
+        constexpr std::size_t buffered() const {
+            return pending.size();
+        }
+
+        /// The error which stopped decoding, if any
+        constexpr std::optional<decode_error> error() const {
+            return err;
+        }
+
+        /// @brief The message decoded so far.
+        ///
+        /// Containers holding values appended out of order (i.e. @ref sorted_vector_map) may be unsorted until `finish()`.
+        constexpr T& value() {
+            return msg;
+        }
+
+        constexpr const T& value() const {
+            return msg;
+        }
+
+        /// @brief Finish decoding while the input ends.
+        /// @returns the decoded message, or the @ref decode_error if the input is malformed or ends within a field
+        constexpr checked_result<T> finish() && {
+            if(err) {
+                return *err;
+            }
+
+            if(!pending.empty()) {
+                return decode_error::truncated;
+            }
+
+            decode_map<T>.finish(msg);
+            return std::move(msg);
+        }
+    };
+
+    /// Decode a @ref message type `T` from a range of byte segments, i.e. a chain of network buffers
+    template <message_c T, std::ranges::input_range R>
+    requires std::convertible_to<std::ranges::range_reference_t<R>, bytes>
+    constexpr checked_result<T> stream_decode(R&& segments) {
+        stream_decoder<T> d;
+
+        for(bytes b : segments) {
+            if(!d.feed(b)) {
+                break;
+            }
+        }
+
+        return std::move(d).finish();
+    }
+
+}
+
+#endif //PROTOPUF_STREAM_H
@@ -16,12 +16,143 @@
 #define PROTOPUF_VARINT_H
 
 #include <concepts>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
 #include "int.h"
 #include "byte.h"
 #include "coder.h"
 
+#if !defined(VARINT_SCALAR_IMPL)
+    #if defined(__BMI2__) && defined(__x86_64__)
+        #include <immintrin.h>
+    #endif
+    #if defined(__SSE2__) || defined(_M_X64)
+        #include <emmintrin.h>
+    #elif defined(__ARM_NEON) && defined(__aarch64__)
+        #include <arm_neon.h>
+    #endif
+#endif
+
 namespace pp {
 
+    /// @brief The maximum byte length of a varint, as a 64-bit integer takes up to 10 bytes.
+    ///
+    /// Any varint is accepted by checked decoding within this length, i.e. a negative `int32` encoded in 10 bytes by protobuf,
+    /// in which case the bits exceeding the target type are discarded.
+    inline constexpr std::size_t max_varint_size = 10;
+
+    /// Get the byte length of `n` encoded as a varint, i.e. `ceil(bit_width(n) / 7)` but at least one byte
+    constexpr std::size_t varint_size(uint<8> n) {
+        return ((64 - std::countl_zero(n | 1)) * 9 + 64) / 64;
+    }
+
+    /// @brief Whether varints are encoded/decoded a 8-byte word at a time while not in constant evaluation.
+    ///
+    /// The word-at-a-time implementation requires a little-endian target, 
+    /// and can be turned off by defining `VARINT_SCALAR_IMPL`, in which case the byte-wise loop is always used.
+#if defined(VARINT_SCALAR_IMPL)
+    inline constexpr bool varint_word_impl = false;
+#else
+    inline constexpr bool varint_word_impl = std::endian::native == std::endian::little;
+#endif
+
+    /// Load the first 8 bytes of `p` in little endian
+    inline uint<8> varint_load_word(const std::byte* p) {
+        uint<8> w;
+        std::memcpy(&w, p, sizeof(w));
+
+        return w;
+    }
+
+    /// Get the byte length of the varint starting at the lowest byte of `w`, or `0` if it does not terminate within `w`
+    inline std::size_t varint_word_length(uint<8> w) {
+        uint<8> stops = ~w & 0x8080'8080'8080'8080;
+
+        return stops == 0 ? 0 : std::countr_zero(stops) / 8 + 1;
+    }
+
+    /// Extract the integer from the varint in the first `len` (in `[1, 8]`) bytes of `w`
+    inline uint<8> varint_word_extract(uint<8> w, std::size_t len) {
+        if(len < 8) {
+            w &= (uint<8>(1) << 8 * len) - 1;
+        }
+
+#if !defined(VARINT_SCALAR_IMPL) && defined(__BMI2__) && defined(__x86_64__)
+        return _pext_u64(w, 0x7f7f'7f7f'7f7f'7f7f);
+#else
+        w &= 0x7f7f'7f7f'7f7f'7f7f;
+        w = ((w & 0x7f00'7f00'7f00'7f00) >> 1) | (w & 0x007f'007f'007f'007f);
+        w = ((w & 0x3fff'0000'3fff'0000) >> 2) | (w & 0x0000'3fff'0000'3fff);
+        w = ((w & 0x0fff'ffff'0000'0000) >> 4) | (w & 0x0000'0000'0fff'ffff);
+
+        return w;
+#endif
+    }
+
+    /// Spread `n` (less than `2^56`) into groups of 7 bits, one group per byte, i.e. the inverse of @ref varint_word_extract
+    inline uint<8> varint_word_deposit(uint<8> n) {
+#if !defined(VARINT_SCALAR_IMPL) && defined(__BMI2__) && defined(__x86_64__)
+        return _pdep_u64(n, 0x7f7f'7f7f'7f7f'7f7f);
+#else
+        n = ((n & 0x00ff'ffff'f000'0000) << 4) | (n & 0x0000'0000'0fff'ffff);
+        n = ((n & 0x0fff'c000'0fff'c000) << 2) | (n & 0x0000'3fff'0000'3fff);
+        n = ((n & 0x3f80'3f80'3f80'3f80) << 1) | (n & 0x007f'007f'007f'007f);
+
+        return n;
+#endif
+    }
+
+    /// @brief Count the varints terminating in `b`, i.e. the number of bytes with the most significant bit unset.
+    ///
+    /// It is used to size containers before decoding a run of packed varints, and scans 16 bytes at a time via SSE2/NEON if available.
+    constexpr std::size_t varint_count(bytes b) {
+        std::size_t n = 0, i = 0;
+
+        if(!std::is_constant_evaluated()) {
+#if !defined(VARINT_SCALAR_IMPL) && (defined(__SSE2__) || defined(_M_X64))
+            for(; i + 16 <= b.size(); i += 16) {
+                auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.data() + i));
+                n += 16 - std::popcount(static_cast<unsigned>(_mm_movemask_epi8(v)));
+            }
+#elif !defined(VARINT_SCALAR_IMPL) && defined(__ARM_NEON) && defined(__aarch64__)
+            for(; i + 16 <= b.size(); i += 16) {
+                auto v = vld1q_u8(reinterpret_cast<const std::uint8_t*>(b.data() + i));
+                n += vaddvq_u8(vshrq_n_u8(vmvnq_u8(v), 7));
+            }
+#endif
+        }
+
+        for(; i < b.size(); ++i) {
+            n += (b[i] >> 7) == 0_b;
+        }
+
+        return n;
+    }
+
+    /// Bytes of the constant `N` encoded as a varint, precomputed at compile time, i.e. the key of a field
+    template <uint<8> N>
+    inline constexpr std::array<std::byte, varint_size(N)> varint_bytes = [] {
+        std::array<std::byte, varint_size(N)> res{};
+
+        uint<8> n = N;
+        for(auto& b : res) {
+            b = std::byte(n & 0x7f) | (n > 0x7f ? 0x80_b : 0_b);
+            n >>= 7;
+        }
+
+        return res;
+    }();
+
+    /// Encode the constant `N` as a varint into `b` by a fixed-size copy of @ref varint_bytes, returns the remaining bytes
+    template <uint<8> N>
+    constexpr bytes encode_constant_varint(bytes b) {
+        std::copy_n(varint_bytes<N>.begin(), varint_bytes<N>.size(), b.begin());
+
+        return b.subspan(varint_bytes<N>.size());
+    }
+
     /// @brief A @ref coder for variable-length integers
     ///
     /// Each byte in a varint, except the last byte, has the most significant bit (msb) set, 
@@ -44,6 +175,20 @@ namespace pp {
         varint_coder() = delete;
 
         static constexpr bytes encode(T n, bytes s) {
+            if constexpr (varint_word_impl) {
+                if(!std::is_constant_evaluated()) {
+                    uint<8> v = n;
+                    auto len = varint_size(v);
+
+                    if(len <= 8) {
+                        auto w = varint_word_deposit(v) | (0x8080'8080'8080'8080 & ((uint<8>(1) << 8 * (len - 1)) - 1));
+                        std::memcpy(s.data(), &w, len);
+
+                        return s.subspan(len);
+                    }
+                }
+            }
+
             auto iter = s.begin();
             do {
                 *iter = 0b1000'0000_b | std::byte(n);
@@ -56,6 +201,15 @@ namespace pp {
         }
 
         static constexpr decode_result<T> decode(bytes s) {
+            if constexpr (varint_word_impl) {
+                if(!std::is_constant_evaluated() && s.size() >= 8) {
+                    auto w = varint_load_word(s.data());
+                    if(auto len = varint_word_length(w)) {
+                        return {static_cast<T>(varint_word_extract(w, len)), s.subspan(len)};
+                    }
+                }
+            }
+
             T n = 0;
 
             auto iter = s.begin();
@@ -68,6 +222,32 @@ namespace pp {
 
             return {n, {iter, s.end()}};
         }
+
+        static constexpr checked_decode_result<T> checked_decode(bytes s) {
+            if constexpr (varint_word_impl) {
+                if(!std::is_constant_evaluated() && s.size() >= 8) {
+                    auto w = varint_load_word(s.data());
+                    if(auto len = varint_word_length(w)) {
+                        return decode_result<T>{static_cast<T>(varint_word_extract(w, len)), s.subspan(len)};
+                    }
+                }
+            }
+
+            T n = 0;
+
+            auto limit = std::min(s.size(), max_varint_size);
+            for(std::size_t i = 0; i < limit; ++i) {
+                if(7 * i < sizeof(T) * 8) {
+                    n |= static_cast<T>(s[i] & 0b0111'1111_b) << 7 * i;
+                }
+
+                if((s[i] >> 7) == 0_b) {
+                    return decode_result<T>{n, s.subspan(i + 1)};
+                }
+            }
+
+            return limit == max_varint_size ? decode_error::overlong_varint : decode_error::truncated;
+        }
     };
 
     template<std::signed_integral T>
@@ -84,8 +264,18 @@ namespace pp {
         static constexpr decode_result<T> decode(bytes s) {
             return varint_coder<std::make_unsigned_t<T>>::decode(s);
         }
+
+        static constexpr checked_decode_result<T> checked_decode(bytes s) {
+            return varint_coder<std::make_unsigned_t<T>>::checked_decode(s);
+        }
     };
 
+    /// Checks whether `C` is a @ref varint_coder
+    template <typename C>
+    constexpr bool is_varint_coder = false;
+
+    template <typename T>
+    constexpr bool is_varint_coder<varint_coder<T>> = true;
 
 }
 
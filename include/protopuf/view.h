@@ -0,0 +1,177 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_VIEW_H
+#define PROTOPUF_VIEW_H
+
+#include <string_view>
+#include <cstring>
+#include <algorithm>
+#include "coder.h"
+#include "varint.h"
+#include "skip.h"
+
+namespace pp {
+
+    /// A byte (contiguous) sequence reference to constant bytes (no ownership).
+    using const_bytes = std::span<const std::byte>;
+
+    /// Copy `n` bytes from `src` to the beginning of `b`, returns the remaining bytes of `b`
+    inline constexpr bytes copy_bytes(const std::byte* src, std::size_t n, bytes b) {
+        if (std::is_constant_evaluated()) {
+            std::copy(src, src + n, b.begin());
+        } else if (n > 0) {
+            std::memcpy(b.data(), src, n);
+        }
+
+        return b.subspan(n);
+    }
+
+    /// @brief A @ref coder for `std::basic_string_view<T>`, which decodes a view into the input bytes (zero-copy).
+    ///
+    /// Lifetime: a decoded view refers to the bytes passed to `decode` directly, 
+    /// so it is valid only while the underlying buffer of these bytes is alive and unmodified.
+    /// Encoding copies the viewed characters into the output bytes.
+    template <typename T> requires (sizeof(T) == 1)
+    struct basic_string_view_coder {
+        using value_type = std::basic_string_view<T>;
+
+        basic_string_view_coder() = delete;
+
+        static constexpr bytes encode(value_type v, bytes b) {
+            b = varint_coder<uint<8>>::encode(v.size(), b);
+
+            if (std::is_constant_evaluated()) {
+                std::transform(v.begin(), v.end(), b.begin(), [](T c) { return std::byte(c); });
+                return b.subspan(v.size());
+            }
+
+            return copy_bytes(reinterpret_cast<const std::byte*>(v.data()), v.size(), b);
+        }
+
+        static decode_result<value_type> decode(bytes b) {
+            uint<8> len = 0;
+            std::tie(len, b) = varint_coder<uint<8>>::decode(b);
+
+            return {value_type{reinterpret_cast<const T*>(b.data()), len}, b.subspan(len)};
+        }
+
+        static checked_decode_result<value_type> checked_decode(bytes b) {
+            auto lr = varint_coder<uint<8>>::checked_decode(b);
+            if(!lr) {
+                return lr.error();
+            }
+
+            auto [len, rest] = *lr;
+            if(len > rest.size()) {
+                return decode_error::length_overflow;
+            }
+
+            return decode_result<value_type>{value_type{reinterpret_cast<const T*>(rest.data()), len}, rest.subspan(len)};
+        }
+    };
+
+    /// Type alias of @ref coder for `std::string_view`
+    using string_view_coder = basic_string_view_coder<char>;
+
+    /// @brief A @ref coder for @ref const_bytes, which decodes a view into the input bytes (zero-copy).
+    ///
+    /// Lifetime: same as @ref basic_string_view_coder, a decoded view is valid only while the input buffer is alive and unmodified.
+    struct bytes_view_coder {
+        using value_type = const_bytes;
+
+        bytes_view_coder() = delete;
+
+        static constexpr bytes encode(value_type v, bytes b) {
+            b = varint_coder<uint<8>>::encode(v.size(), b);
+            return copy_bytes(v.data(), v.size(), b);
+        }
+
+        static constexpr decode_result<value_type> decode(bytes b) {
+            uint<8> len = 0;
+            std::tie(len, b) = varint_coder<uint<8>>::decode(b);
+
+            return {b.subspan(0, len), b.subspan(len)};
+        }
+
+        static constexpr checked_decode_result<value_type> checked_decode(bytes b) {
+            auto lr = varint_coder<uint<8>>::checked_decode(b);
+            if(!lr) {
+                return lr.error();
+            }
+
+            auto [len, rest] = *lr;
+            if(len > rest.size()) {
+                return decode_error::length_overflow;
+            }
+
+            return decode_result<value_type>{rest.subspan(0, len), rest.subspan(len)};
+        }
+    };
+
+    template <>
+    struct skipper<bytes_view_coder> {
+        using coder = bytes_view_coder;
+        using value_type = const_bytes;
+
+        static constexpr std::size_t encode_skip(value_type v) {
+            return skipper<varint_coder<uint<8>>>::encode_skip(v.size()) + v.size();
+        }
+
+        static constexpr bytes decode_skip(bytes b) {
+            uint<8> n = 0;
+            std::tie(n, b) = varint_coder<uint<8>>::decode(b);
+
+            return b.subspan(n);
+        }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            auto lr = varint_coder<uint<8>>::checked_decode(b);
+            if(!lr) {
+                return lr.error();
+            }
+
+            auto [n, rest] = *lr;
+            if(n > rest.size()) {
+                return decode_error::length_overflow;
+            }
+
+            return rest.subspan(n);
+        }
+    };
+
+    template <typename T>
+    struct skipper<basic_string_view_coder<T>> {
+        using coder = basic_string_view_coder<T>;
+        using value_type = typename coder::value_type;
+
+        static constexpr std::size_t encode_skip(value_type v) {
+            return skipper<varint_coder<uint<8>>>::encode_skip(v.size()) + v.size();
+        }
+
+        static constexpr bytes decode_skip(bytes b) {
+            uint<8> n = 0;
+            std::tie(n, b) = varint_coder<uint<8>>::decode(b);
+
+            return b.subspan(n);
+        }
+
+        static constexpr checked_result<bytes> checked_decode_skip(bytes b) {
+            return skipper<bytes_view_coder>::checked_decode_skip(b);
+        }
+    };
+
+}
+
+#endif //PROTOPUF_VIEW_H
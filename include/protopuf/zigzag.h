@@ -129,6 +129,15 @@ namespace pp {
             auto p = integer_coder<uint<N>> ::decode(bytes);
             return {T::from_uint(p.first), p.second};
         }
+
+        static constexpr checked_decode_result<T> checked_decode(bytes bytes) {
+            auto p = integer_coder<uint<N>>::checked_decode(bytes);
+            if(!p) {
+                return p.error();
+            }
+
+            return decode_result<T>{T::from_uint(p->first), p->second};
+        }
     };
 
 
@@ -149,6 +158,15 @@ namespace pp {
             auto p = varint_coder<uint<N>>::decode(s);
             return {T::from_uint(p.first), p.second};
         }
+
+        static constexpr checked_decode_result<T> checked_decode(bytes s) {
+            auto p = varint_coder<uint<N>>::checked_decode(s);
+            if(!p) {
+                return p.error();
+            }
+
+            return decode_result<T>{T::from_uint(p->first), p->second};
+        }
     };
 }
 
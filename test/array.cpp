@@ -38,6 +38,20 @@ GTEST_TEST(array_coder, decode) {
     EXPECT_EQ(con, v);
 }
 
+GTEST_TEST(array_coder, cached_encode) {
+    vector<sint_zigzag<8>> con{sint_zigzag<8>(-1), sint_zigzag<8>(100000), sint_zigzag<8>(9), sint_zigzag<8>(4)};
+    array<byte, 10> a{};
+    array<byte, 10> e{0x06_b, 0x01_b, 0xC0_b, 0x9A_b, 0x0C_b, 0x12_b, 0x08_b};
+
+    size_cache cache;
+    EXPECT_EQ(skipper<array_coder<varint_coder<sint_zigzag<8>>>>::encode_skip(con, cache), 7);
+    EXPECT_EQ(cache.size(), 1);
+
+    auto n = array_coder<varint_coder<sint_zigzag<8>>>::encode(con, a, cache);
+    EXPECT_EQ(begin_diff(n, a), 7);
+    EXPECT_EQ(a, e);
+}
+
 GTEST_TEST(string_coder, encode) {
     array<byte, 10> e{3_b, 0x61_b, 0x62_b, 0x63_b};
     array<byte, 10> a{};
@@ -53,3 +67,70 @@ GTEST_TEST(string_coder, decode) {
     EXPECT_EQ(begin_diff(n, a), 4);
     EXPECT_EQ(v, e);
 }
+
+GTEST_TEST(array_coder, checked_decode) {
+    {
+        array<byte, 10> a{0x06_b, 0x01_b, 0xC0_b, 0x9A_b, 0x0C_b, 0x12_b, 0x08_b};
+        auto r = array_coder<varint_coder<sint_zigzag<8>>>::checked_decode(a);
+        ASSERT_TRUE(r);
+        EXPECT_EQ(begin_diff(r->second, a), 7);
+        EXPECT_EQ(r->first.size(), 4);
+    }
+
+    {
+        array<byte, 4> a{0x06_b, 0x01_b, 0xC0_b, 0x9A_b};
+        auto r = array_coder<varint_coder<sint_zigzag<8>>>::checked_decode(a);
+        ASSERT_FALSE(r);
+        EXPECT_EQ(r.error(), decode_error::length_overflow);
+    }
+
+    {
+        array<byte, 4> a{0x03_b, 0x01_b, 0xC0_b, 0x9A_b};
+        auto r = array_coder<varint_coder<sint_zigzag<8>>>::checked_decode(a);
+        ASSERT_FALSE(r);
+        EXPECT_EQ(r.error(), decode_error::truncated);
+    }
+
+    {
+        array<byte, 4> a{3_b, 0x61_b, 0x62_b, 0x63_b};
+        auto r = string_coder::checked_decode(a);
+        ASSERT_TRUE(r);
+        EXPECT_EQ(r->first, "abc");
+        EXPECT_TRUE(r->second.empty());
+    }
+}
+
+GTEST_TEST(array_coder, bulk) {
+    static_assert(is_bulk_coder<integer_coder<char>>);
+    static_assert(is_bulk_coder<integer_coder<pp::uint<8>>>);
+    static_assert(is_bulk_coder<float_coder<double>>);
+    static_assert(!is_bulk_coder<varint_coder<pp::uint<4>>>);
+
+    string s(1000, 'x');
+    s[500] = 'y';
+    array<byte, 1010> a{};
+    EXPECT_EQ(skipper<string_coder>::encode_skip(s), 1002);
+    auto n = string_coder::encode(s, a);
+    EXPECT_EQ(begin_diff(n, a), 1002);
+    EXPECT_EQ(a[0], 0xE8_b);
+    EXPECT_EQ(a[1], 0x07_b);
+    EXPECT_EQ(a[502], byte{'y'});
+
+    auto [v, m] = string_coder::decode(a);
+    EXPECT_EQ(begin_diff(m, a), 1002);
+    EXPECT_EQ(v, s);
+
+    vector<sint<4>> ints{1, -2, 0x12345678};
+    array<byte, 13> b{};
+    array<byte, 13> e{12_b, 1_b, 0_b, 0_b, 0_b, 0xFE_b, 0xFF_b, 0xFF_b, 0xFF_b, 0x78_b, 0x56_b, 0x34_b, 0x12_b};
+    EXPECT_EQ(begin_diff(array_coder<integer_coder<sint<4>>>::encode(ints, b), b), 13);
+    EXPECT_EQ(b, e);
+    EXPECT_EQ(array_coder<integer_coder<sint<4>>>::decode(b).first, ints);
+
+    constexpr auto f = [] {
+        array<byte, 5> c{};
+        array_coder<integer_coder<sint<2>>>::encode(vector<sint<2>>{0x0102, 0x0304}, c);
+        return array_coder<integer_coder<sint<2>>>::decode(c).first == vector<sint<2>>{0x0102, 0x0304};
+    };
+    static_assert(f());
+}
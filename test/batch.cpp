@@ -0,0 +1,109 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <protopuf/batch.h>
+
+#include <list>
+
+using namespace pp;
+using namespace std;
+
+namespace {
+    using Tag = message<string_field<"key", 1>, string_field<"value", 2>>;
+    using Record = message<uint64_field<"ts", 1>, string_field<"msg", 2>, message_field<"tags", 3, Tag, repeated>>;
+
+    vector<Record> make_records(size_t n) {
+        vector<Record> res;
+        for(size_t i = 0; i < n; ++i) {
+            res.push_back(Record{i * 1000, "record #" + to_string(i), {Tag{"host", "a"}, Tag{"seq", to_string(i)}}});
+        }
+
+        return res;
+    }
+}
+
+GTEST_TEST(batch_coder, encode) {
+    auto records = make_records(100);
+
+    auto buf = batch_coder<Record>::encode(records);
+    EXPECT_EQ(buf.size(), batch_coder<Record>::encode_skip(records));
+
+    // same as records encoded one by one as embedded messages
+    vector<byte> expected(buf.size());
+    bytes b = expected;
+    for(const auto& r : records) {
+        b = embedded_message_coder<Record>::encode(r, b);
+    }
+
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(buf, expected);
+
+    vector<byte> out{byte{0xff}};
+    {
+        vector_sink s(out);
+        EXPECT_EQ(batch_coder<Record>::encode(records, s), buf.size());
+    }
+
+    EXPECT_EQ(out.size(), buf.size() + 1);
+    EXPECT_TRUE(equal(buf.begin(), buf.end(), out.begin() + 1));
+
+    list<Record> l(records.begin(), records.end());
+    EXPECT_EQ(batch_coder<Record>::encode(l), buf);
+
+    EXPECT_TRUE(batch_coder<Record>::encode(vector<Record>{}).empty());
+}
+
+GTEST_TEST(batch_coder, decode) {
+    auto records = make_records(100);
+    auto buf = batch_coder<Record>::encode(records);
+
+    EXPECT_EQ(batch_coder<Record>::count(buf), 100);
+    EXPECT_EQ(batch_coder<Record>::decode(buf), records);
+
+    auto r = batch_coder<Record>::checked_decode(buf);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(*r, records);
+
+    list<Record> l;
+    EXPECT_TRUE(batch_coder<Record>::decode(l, buf).empty());
+    EXPECT_EQ(vector<Record>(l.begin(), l.end()), records);
+
+    EXPECT_TRUE(batch_coder<Record>::decode(bytes{}).empty());
+}
+
+GTEST_TEST(batch_coder, decode_reuse) {
+    auto records = make_records(10);
+    auto buf = batch_coder<Record>::encode(records);
+
+    vector<Record> out = make_records(20);
+    batch_coder<Record>::decode_reuse(out, buf);
+    EXPECT_EQ(out, records);
+
+    out.resize(3);
+    batch_coder<Record>::decode_reuse(out, buf);
+    EXPECT_EQ(out, records);
+}
+
+GTEST_TEST(batch_coder, checked_decode) {
+    auto records = make_records(3);
+    auto buf = batch_coder<Record>::encode(records);
+
+    vector<Record> out;
+    auto r = batch_coder<Record>::checked_decode(out, bytes(buf.data(), buf.size() - 1));
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error(), decode_error::length_overflow);
+    EXPECT_EQ(out, (vector<Record>{records[0], records[1]}));
+}
@@ -0,0 +1,44 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#ifndef PROTOPUF_BENCHMARK_COMMON_H
+#define PROTOPUF_BENCHMARK_COMMON_H
+
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// the number of global allocations so far, counted by the replaced `operator new` in main.cpp
+extern std::atomic<std::size_t> allocation_count;
+
+// run `f` in the benchmark loop and report allocations per iteration,
+// and bytes per second if `bytes` (processed per iteration) is not zero
+template <typename F>
+void count_allocations(benchmark::State& state, F&& f, std::size_t bytes = 0) {
+    auto origin = allocation_count.load();
+
+    for(auto _ : state) {
+        f();
+    }
+
+    state.counters["allocs"] = benchmark::Counter(
+        double(allocation_count.load() - origin), benchmark::Counter::kAvgIterations);
+
+    if(bytes != 0) {
+        state.SetBytesProcessed(std::int64_t(state.iterations()) * std::int64_t(bytes));
+    }
+}
+
+#endif //PROTOPUF_BENCHMARK_COMMON_H
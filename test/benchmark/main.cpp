@@ -15,11 +15,44 @@
 #include <protopuf/message.h>
 #include <benchmark/benchmark.h>
 #include <message.pb.h>
+#include "common.h"
 #include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <memory_resource>
 
 using namespace pp;
 using namespace std;
 
+// count global allocations to report allocations per operation, ref to `count_allocations` in common.h
+atomic<size_t> allocation_count = 0;
+
+// replacements are kept out of line, otherwise GCC sees `free` of memory from an inlined `new` (-Wmismatched-new-delete)
+#if defined(__GNUC__)
+#define ALLOCATION_NOINLINE [[gnu::noinline]]
+#else
+#define ALLOCATION_NOINLINE
+#endif
+
+ALLOCATION_NOINLINE void* operator new(size_t n) {
+    allocation_count.fetch_add(1, memory_order_relaxed);
+
+    if(void* p = malloc(n ? n : 1)) {
+        return p;
+    }
+
+    throw bad_alloc();
+}
+
+ALLOCATION_NOINLINE void operator delete(void* p) noexcept {
+    free(p);
+}
+
+ALLOCATION_NOINLINE void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
 using Student = message<uint32_field<"id", 1>, string_field<"name", 3>>;
 using Class = message<string_field<"name", 8>, message_field<"students", 3, Student, repeated>>;
 
@@ -68,19 +101,43 @@ array<byte, 64> decode_buffer {
         0x74_b, 0x77_b, 0x69_b, 0x63_b, 0x65_b};
 
 void BM_protopuf_decode(benchmark::State& state) {
-    for(auto _ : state) {
+    count_allocations(state, [] {
         auto [myClass, _2] = message_coder<Class>::decode(decode_buffer);
         benchmark::DoNotOptimize(myClass);
-    }
+    });
 }
 BENCHMARK(BM_protopuf_decode);
 
+void BM_protopuf_decode_reuse(benchmark::State& state) {
+    Class myClass;
+
+    count_allocations(state, [&myClass] {
+        message_coder<Class>::decode_reuse(myClass, decode_buffer);
+        benchmark::DoNotOptimize(myClass);
+    });
+}
+BENCHMARK(BM_protopuf_decode_reuse);
+
+using PmrStudent = message<uint32_field<"id", 1>, pmr_string_field<"name", 3>>;
+using PmrClass = message<pmr_string_field<"name", 8>, pmr_message_field<"students", 3, PmrStudent, repeated>>;
+
+void BM_protopuf_decode_arena(benchmark::State& state) {
+    array<byte, 4096> storage{};
+
+    count_allocations(state, [&storage] {
+        pmr::monotonic_buffer_resource arena(storage.data(), storage.size());
+        auto [myClass, _2] = message_coder<PmrClass>::decode(decode_buffer, &arena);
+        benchmark::DoNotOptimize(myClass);
+    });
+}
+BENCHMARK(BM_protopuf_decode_arena);
+
 void BM_protobuf_decode(benchmark::State& state) {
-    for(auto _ : state) {
+    count_allocations(state, [] {
         pb::Class myClass;
         myClass.ParseFromArray(decode_buffer.data(), decode_buffer.size());
         benchmark::DoNotOptimize(myClass);
-    }
+    });
 }
 BENCHMARK(BM_protobuf_decode);
 
@@ -0,0 +1,406 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+// A parameterized benchmark suite: every case builds a protobuf message from the benchmark argument,
+// and protopuf decodes its serialized bytes into the equivalent message, so that both libraries process the same bytes.
+// Bytes per second and allocations per operation are reported for each benchmark.
+
+#include <protopuf/map.h>
+#include <benchmark/benchmark.h>
+#include <message.pb.h>
+#include <suite.pb.h>
+#include "common.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace pp;
+using namespace std;
+
+namespace {
+
+    using Student = message<uint32_field<"id", 1>, string_field<"name", 3>>;
+    using Class = message<string_field<"name", 8>, message_field<"students", 3, Student, repeated>>;
+
+    using Roster = message<string_field<"name", 1>, message_field<"students", 2, Student, repeated>>;
+
+    // a class (or roster) with students of about `n` bytes
+    template <typename P>
+    P make_students(int64_t n) {
+        P res;
+        res.set_name("class 101");
+
+        // each student is encoded in about 23 bytes
+        for(int64_t i = 0; i < n / 23; ++i) {
+            auto s = res.add_students();
+            s->set_id(uint32_t(i * 7919 % 100000));
+            s->set_name("student " + to_string(100000 + i));
+        }
+
+        return res;
+    }
+
+    // a payload of about `n` bytes: a class with students
+    struct payload_case {
+        using pp_type = Class;
+        using pb_type = pb::Class;
+
+        static pb_type make(int64_t n) {
+            return make_students<pb_type>(n);
+        }
+
+        static void args(benchmark::internal::Benchmark* b) {
+            b->RangeMultiplier(10)->Range(10, 10'000'000);
+        }
+    };
+
+    template <size_t D>
+    struct nested_type {
+        using type = message<uint32_field<"value", 1>, message_field<"child", 2, typename nested_type<D - 1>::type>>;
+    };
+
+    template <>
+    struct nested_type<0> {
+        using type = message<uint32_field<"value", 1>>;
+    };
+
+    // a chain of `D` nested messages
+    template <size_t D>
+    struct nested_case {
+        using pp_type = typename nested_type<D>::type;
+        using pb_type = pb::Node;
+
+        static pb_type make(int64_t) {
+            pb_type res;
+
+            auto node = &res;
+            for(size_t i = 0; i < D; ++i) {
+                node->set_value(uint32_t(i + 1));
+                node = node->mutable_child();
+            }
+            node->set_value(uint32_t(D + 1));
+
+            return res;
+        }
+
+        static void args(benchmark::internal::Benchmark* b) {
+            b->Arg(D);
+        }
+    };
+
+    using Wide = message<
+    uint32_field<"w1", 1>, int64_field<"w2", 2>, fixed32_field<"w3", 3>, double_field<"w4", 4>,
+    string_field<"w5", 5>, uint32_field<"w6", 6>, int64_field<"w7", 7>, fixed32_field<"w8", 8>,
+    double_field<"w9", 9>, string_field<"w10", 10>, uint32_field<"w11", 11>, int64_field<"w12", 12>,
+    fixed32_field<"w13", 13>, double_field<"w14", 14>, string_field<"w15", 15>, uint32_field<"w16", 16>,
+    int64_field<"w17", 17>, fixed32_field<"w18", 18>, double_field<"w19", 19>, string_field<"w20", 20>,
+    uint32_field<"w21", 21>, int64_field<"w22", 22>, fixed32_field<"w23", 23>, double_field<"w24", 24>,
+    string_field<"w25", 25>, uint32_field<"w26", 26>, int64_field<"w27", 27>, fixed32_field<"w28", 28>,
+    double_field<"w29", 29>, string_field<"w30", 30>, uint32_field<"w31", 31>, int64_field<"w32", 32>,
+    fixed32_field<"w33", 33>, double_field<"w34", 34>, string_field<"w35", 35>, uint32_field<"w36", 36>,
+    int64_field<"w37", 37>, fixed32_field<"w38", 38>, double_field<"w39", 39>, string_field<"w40", 40>,
+    uint32_field<"w41", 41>, int64_field<"w42", 42>, fixed32_field<"w43", 43>, double_field<"w44", 44>,
+    string_field<"w45", 45>, uint32_field<"w46", 46>, int64_field<"w47", 47>, fixed32_field<"w48", 48>,
+    double_field<"w49", 49>, string_field<"w50", 50>, uint32_field<"w51", 51>, int64_field<"w52", 52>,
+    fixed32_field<"w53", 53>, double_field<"w54", 54>, string_field<"w55", 55>, uint32_field<"w56", 56>,
+    int64_field<"w57", 57>, fixed32_field<"w58", 58>, double_field<"w59", 59>, string_field<"w60", 60>,
+    uint32_field<"w61", 61>, int64_field<"w62", 62>, fixed32_field<"w63", 63>, double_field<"w64", 64>,
+    string_field<"w65", 65>, uint32_field<"w66", 66>, int64_field<"w67", 67>, fixed32_field<"w68", 68>,
+    double_field<"w69", 69>, string_field<"w70", 70>, uint32_field<"w71", 71>, int64_field<"w72", 72>,
+    fixed32_field<"w73", 73>, double_field<"w74", 74>, string_field<"w75", 75>, uint32_field<"w76", 76>,
+    int64_field<"w77", 77>, fixed32_field<"w78", 78>, double_field<"w79", 79>, string_field<"w80", 80>,
+    uint32_field<"w81", 81>, int64_field<"w82", 82>, fixed32_field<"w83", 83>, double_field<"w84", 84>,
+    string_field<"w85", 85>, uint32_field<"w86", 86>, int64_field<"w87", 87>, fixed32_field<"w88", 88>,
+    double_field<"w89", 89>, string_field<"w90", 90>, uint32_field<"w91", 91>, int64_field<"w92", 92>,
+    fixed32_field<"w93", 93>, double_field<"w94", 94>, string_field<"w95", 95>, uint32_field<"w96", 96>,
+    int64_field<"w97", 97>, fixed32_field<"w98", 98>, double_field<"w99", 99>, string_field<"w100", 100>,
+    uint32_field<"w101", 101>, int64_field<"w102", 102>, fixed32_field<"w103", 103>, double_field<"w104", 104>,
+    string_field<"w105", 105>, uint32_field<"w106", 106>, int64_field<"w107", 107>, fixed32_field<"w108", 108>,
+    double_field<"w109", 109>, string_field<"w110", 110>, uint32_field<"w111", 111>, int64_field<"w112", 112>,
+    fixed32_field<"w113", 113>, double_field<"w114", 114>, string_field<"w115", 115>, uint32_field<"w116", 116>,
+    int64_field<"w117", 117>, fixed32_field<"w118", 118>, double_field<"w119", 119>, string_field<"w120", 120>,
+    uint32_field<"w121", 121>, int64_field<"w122", 122>, fixed32_field<"w123", 123>, double_field<"w124", 124>,
+    string_field<"w125", 125>, uint32_field<"w126", 126>, int64_field<"w127", 127>, fixed32_field<"w128", 128>
+    >;
+
+    // a message with 128 fields of various types
+    struct wide_case {
+        using pp_type = Wide;
+        using pb_type = pb::Wide;
+
+        static pb_type make(int64_t) {
+            pb_type res;
+
+            auto reflection = res.GetReflection();
+            auto descriptor = res.GetDescriptor();
+            for(int i = 0; i < descriptor->field_count(); ++i) {
+                auto field = descriptor->field(i);
+                auto n = field->number();
+
+                switch(field->cpp_type()) {
+                    case google::protobuf::FieldDescriptor::CPPTYPE_UINT32: reflection->SetUInt32(&res, field, uint32_t(n * 1000)); break;
+                    case google::protobuf::FieldDescriptor::CPPTYPE_INT64: reflection->SetInt64(&res, field, -int64_t(n) * 100000); break;
+                    case google::protobuf::FieldDescriptor::CPPTYPE_DOUBLE: reflection->SetDouble(&res, field, n * 0.5); break;
+                    case google::protobuf::FieldDescriptor::CPPTYPE_STRING: reflection->SetString(&res, field, "value of field " + to_string(n)); break;
+                    default: break;
+                }
+            }
+
+            return res;
+        }
+
+        static void args(benchmark::internal::Benchmark* b) {
+            b->Arg(Wide::size);
+        }
+    };
+
+    // `n` elements in each of packed varint, packed fixed64, packed double and unpacked varint arrays
+    struct scalars_case {
+        using pp_type = message<uint32_field<"varints", 1, packed>, fixed64_field<"fixeds", 2, packed>,
+                                double_field<"doubles", 3, packed>, uint32_field<"unpacked", 4, repeated>>;
+        using pb_type = pb::Scalars;
+
+        static pb_type make(int64_t n) {
+            pb_type res;
+
+            for(int64_t i = 0; i < n; ++i) {
+                res.add_varints(uint32_t(i * 2654435761u % (1u << 28)));
+                res.add_fixeds(uint64_t(i) * 0x9E3779B97F4A7C15ull);
+                res.add_doubles(double(i) * 0.25);
+                res.add_unpacked(uint32_t(i % 1000));
+            }
+
+            return res;
+        }
+
+        static void args(benchmark::internal::Benchmark* b) {
+            b->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+        }
+    };
+
+    using Tags = message<map_field<"tags", 1, string_coder, varint_coder<pp::uint<8>>>>;
+
+    // a map of `n` string keys to uint64 values, stored in `std::map`
+    template <typename M = Tags>
+    struct map_case {
+        using pp_type = M;
+        using pb_type = pb::Tags;
+
+        static pb_type make(int64_t n) {
+            pb_type res;
+
+            auto& tags = *res.mutable_tags();
+            for(int64_t i = 0; i < n; ++i) {
+                tags["tag/" + to_string(1000000 + i * 7919 % 1000000)] = uint64_t(i) * 1000003;
+            }
+
+            return res;
+        }
+
+        static void args(benchmark::internal::Benchmark* b) {
+            b->RangeMultiplier(16)->Range(16, 1 << 16);
+        }
+    };
+
+    // same as `map_case`, but stored in `flat_hash_map`
+    using hash_map_case = map_case<message<hash_map_field<"tags", 1, string_coder, varint_coder<pp::uint<8>>>>>;
+
+    // same as `map_case`, but stored in `sorted_vector_map`
+    using sorted_map_case = map_case<message<sorted_map_field<"tags", 1, string_coder, varint_coder<pp::uint<8>>>>>;
+
+    // `n` short strings
+    template <typename M = message<string_field<"values", 1, repeated>>>
+    struct strings_case {
+        using pp_type = M;
+        using pb_type = pb::Strings;
+
+        static pb_type make(int64_t n) {
+            pb_type res;
+
+            for(int64_t i = 0; i < n; ++i) {
+                res.add_values("string #" + to_string(10000000 + i));
+            }
+
+            return res;
+        }
+
+        static void args(benchmark::internal::Benchmark* b) {
+            b->RangeMultiplier(10)->Range(1000, 100000);
+        }
+    };
+
+    // same as `strings_case`, but decoded as views into the input bytes
+    using string_views_case = strings_case<message<string_view_field<"values", 1, repeated>>>;
+
+    // 16 blobs of `n` bytes
+    template <typename M = message<bytes_field<"values", 1, repeated>>>
+    struct blobs_case {
+        using pp_type = M;
+        using pb_type = pb::Blobs;
+
+        static pb_type make(int64_t n) {
+            pb_type res;
+
+            for(int64_t i = 0; i < 16; ++i) {
+                string blob(size_t(n), '\0');
+                for(size_t j = 0; j < blob.size(); ++j) {
+                    blob[j] = char((i * 131 + j * 7) & 0xff);
+                }
+
+                res.add_values(std::move(blob));
+            }
+
+            return res;
+        }
+
+        static void args(benchmark::internal::Benchmark* b) {
+            b->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+        }
+    };
+
+    // same as `blobs_case`, but decoded as views into the input bytes
+    using blob_views_case = blobs_case<message<bytes_view_field<"values", 1, repeated>>>;
+
+    // decoding only the name of a payload, where all students are skipped as unknown fields
+    struct skip_case : payload_case {
+        using pp_type = message<string_field<"name", 8>>;
+        using pb_decode_type = pb::ClassName;
+    };
+
+    // same as `payload_case`, but the name is encoded ahead of students
+    struct roster_case : payload_case {
+        using pp_type = Roster;
+        using pb_type = pb::Roster;
+
+        static pb_type make(int64_t n) {
+            return make_students<pb_type>(n);
+        }
+    };
+
+    // decoding only the name of a roster by `decode_only`, which stops right after the name (the first field on the wire)
+    struct decode_only_case : roster_case {
+        static auto decode(bytes b) {
+            return message_coder<Roster>::decode_only<"name"_f>(b);
+        }
+    };
+
+    template <typename Case>
+    struct pb_decode_type_of {
+        using type = typename Case::pb_type;
+    };
+
+    template <typename Case> requires requires { typename Case::pb_decode_type; }
+    struct pb_decode_type_of<Case> {
+        using type = typename Case::pb_decode_type;
+    };
+
+    template <typename Case>
+    vector<byte> serialize(const benchmark::State& state) {
+        auto s = Case::make(state.range(0)).SerializeAsString();
+
+        vector<byte> res(s.size());
+        memcpy(res.data(), s.data(), s.size());
+
+        return res;
+    }
+
+}
+
+template <typename Case>
+void BM_protopuf_suite_encode(benchmark::State& state) {
+    using T = typename Case::pp_type;
+
+    auto data = serialize<Case>(state);
+    auto msg = message_coder<T>::decode(data).first;
+
+    vector<byte> buffer(skipper<message_coder<T>>::encode_skip(msg));
+
+    count_allocations(state, [&msg, &buffer] {
+        auto e = message_coder<T>::encode(msg, buffer);
+        benchmark::DoNotOptimize(e);
+    }, buffer.size());
+}
+
+template <typename Case>
+void BM_protobuf_suite_encode(benchmark::State& state) {
+    auto msg = Case::make(state.range(0));
+
+    vector<byte> buffer(msg.ByteSizeLong());
+
+    count_allocations(state, [&msg, &buffer] {
+        msg.SerializeToArray(buffer.data(), int(buffer.size()));
+        benchmark::DoNotOptimize(buffer);
+    }, buffer.size());
+}
+
+template <typename Case>
+void BM_protopuf_suite_decode(benchmark::State& state) {
+    using T = typename Case::pp_type;
+
+    auto data = serialize<Case>(state);
+
+    count_allocations(state, [&data] {
+        if constexpr (requires(bytes b) { Case::decode(b); }) {
+            auto r = Case::decode(data);
+            benchmark::DoNotOptimize(r);
+        } else {
+            auto r = message_coder<T>::decode(data);
+            benchmark::DoNotOptimize(r);
+        }
+    }, data.size());
+}
+
+template <typename Case>
+void BM_protobuf_suite_decode(benchmark::State& state) {
+    using P = typename pb_decode_type_of<Case>::type;
+
+    auto data = serialize<Case>(state);
+
+    count_allocations(state, [&data] {
+        P msg;
+        msg.ParseFromArray(data.data(), int(data.size()));
+        benchmark::DoNotOptimize(msg);
+    }, data.size());
+}
+
+// compare encoding and decoding of protopuf against protobuf
+#define SUITE_CASE(...) \
+    BENCHMARK_TEMPLATE(BM_protopuf_suite_encode, __VA_ARGS__)->Apply(__VA_ARGS__::args); \
+    BENCHMARK_TEMPLATE(BM_protobuf_suite_encode, __VA_ARGS__)->Apply(__VA_ARGS__::args); \
+    BENCHMARK_TEMPLATE(BM_protopuf_suite_decode, __VA_ARGS__)->Apply(__VA_ARGS__::args); \
+    BENCHMARK_TEMPLATE(BM_protobuf_suite_decode, __VA_ARGS__)->Apply(__VA_ARGS__::args)
+
+// protopuf alternatives of a case, i.e. other containers or views, compared against the protobuf results of the case
+#define SUITE_VARIANT(...) \
+    BENCHMARK_TEMPLATE(BM_protopuf_suite_encode, __VA_ARGS__)->Apply(__VA_ARGS__::args); \
+    BENCHMARK_TEMPLATE(BM_protopuf_suite_decode, __VA_ARGS__)->Apply(__VA_ARGS__::args)
+
+SUITE_CASE(payload_case);
+SUITE_CASE(nested_case<4>);
+SUITE_CASE(nested_case<8>);
+SUITE_CASE(nested_case<12>);
+SUITE_CASE(wide_case);
+SUITE_CASE(scalars_case);
+SUITE_CASE(map_case<>);
+SUITE_VARIANT(hash_map_case);
+SUITE_VARIANT(sorted_map_case);
+SUITE_CASE(strings_case<>);
+SUITE_VARIANT(string_views_case);
+SUITE_CASE(blobs_case<>);
+SUITE_VARIANT(blob_views_case);
+
+BENCHMARK_TEMPLATE(BM_protopuf_suite_decode, skip_case)->Apply(skip_case::args);
+BENCHMARK_TEMPLATE(BM_protobuf_suite_decode, skip_case)->Apply(skip_case::args);
+BENCHMARK_TEMPLATE(BM_protopuf_suite_decode, roster_case)->Apply(roster_case::args);
+BENCHMARK_TEMPLATE(BM_protopuf_suite_decode, decode_only_case)->Apply(decode_only_case::args);
@@ -65,3 +65,28 @@ GTEST_TEST(static, coder) {
     enum E{};
     static_assert(coder<enum_coder<E>>);
 }
+
+GTEST_TEST(static, checked_decoder) {
+    static_assert(checked_decoder<integer_coder<pp::uint<4>>>);
+    static_assert(checked_decoder<integer_coder<sint<8>>>);
+    static_assert(checked_decoder<integer_coder<sint_zigzag<4>>>);
+
+    static_assert(checked_decoder<varint_coder<pp::uint<4>>>);
+    static_assert(checked_decoder<varint_coder<sint<4>>>);
+    static_assert(checked_decoder<varint_coder<sint_zigzag<8>>>);
+
+    static_assert(checked_decoder<array_coder<varint_coder<sint<2>>>>);
+    static_assert(checked_decoder<string_coder>);
+    static_assert(checked_decoder<bytes_coder>);
+
+    static_assert(checked_decoder<float_coder<floating<4>>>);
+    static_assert(checked_decoder<float_coder<floating<8>>>);
+
+    static_assert(checked_decoder<message_coder<message<integer_field<"", 1, int>, string_field<"", 2>>>>);
+    static_assert(checked_decoder<embedded_message_coder<message<integer_field<"", 1, int>, string_field<"", 2>>>>);
+
+    static_assert(checked_decoder<bool_coder>);
+
+    enum E{};
+    static_assert(checked_decoder<enum_coder<E>>);
+}
@@ -0,0 +1,210 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <protopuf/message.h>
+
+#include <array>
+#include <limits>
+#include <string>
+
+using namespace pp;
+using namespace std;
+
+namespace {
+    enum class Color { red, green, blue };
+
+    using Point = message<bool_field<"visible", 1>, double_field<"x", 2>, uint32_field<"id", 3>, bool_field<"selected", 4>,
+        double_field<"y", 5>, enum_field<"color", 6, Color>, string_field<"label", 7>, int32_field<"tags", 8, packed>>;
+
+    using LoosePoint = message<bool_field<"shown", 1>, double_field<"x", 2>, uint32_field<"id", 3>, bool_field<"selected", 4>,
+        double_field<"y", 5>, enum_field<"color", 6, Color>, string_field<"label", 7>, int32_field<"tags", 8, packed>>;
+
+    template <size_t... I>
+    auto scalars(index_sequence<I...>) -> message<uint32_field<"", I + 1>...>;
+
+    using Scalars = decltype(scalars(make_index_sequence<20>{}));
+}
+
+template <>
+struct pp::compact_layout<Point> : std::true_type {};
+
+namespace {
+    using Shape = message<string_field<"name", 1>, message_field<"points", 2, Point, repeated>, uint64_field<"version", 3>>;
+}
+
+template <>
+struct pp::compact_layout<Shape> : std::true_type {};
+
+template <>
+struct pp::compact_layout<Scalars> : std::true_type {};
+
+namespace {
+    Point make_point() {
+        Point p;
+        p["visible"_f] = true;
+        p["x"_f] = 1.5;
+        p["id"_f] = 300u;
+        p["y"_f] = -2.25;
+        p["color"_f] = Color::blue;
+        p["label"_f] = "origin";
+        p["tags"_f] = {1, -2, 3};
+
+        return p;
+    }
+
+    template <message_c T>
+    vector<byte> encode(const T& msg) {
+        vector<byte> res(skipper<message_coder<T>>::encode_skip(msg));
+        message_coder<T>::encode(msg, res);
+
+        return res;
+    }
+}
+
+GTEST_TEST(compact_layout, size) {
+    // presence bits are packed into one byte, and values are ordered by alignment: 8 + 8 + 4 + 1 + 1 + 1 (+ padding)
+    static_assert(sizeof(compact_storage<bool, double, uint32_t, bool, double>) == 24);
+    static_assert(sizeof(Scalars) == 20 * 4 + 4);
+    static_assert(sizeof(Point) < sizeof(LoosePoint));
+
+    // other messages are not affected
+    struct separate {
+        optional<uint32_t> a;
+        optional<bool> b;
+    };
+    static_assert(sizeof(message<uint32_field<"a", 1>, bool_field<"b", 2>>) == sizeof(separate));
+    static_assert(!compact_storable<string_field<"a", 1>>);
+    static_assert(compact_storable<uint32_field<"a", 1>>);
+}
+
+GTEST_TEST(compact_layout, access) {
+    Point p;
+    EXPECT_FALSE(p["x"_f].has_value());
+    EXPECT_TRUE(empty_field(p["x"_f]));
+    EXPECT_EQ(p["x"_f], nullopt);
+
+    p["x"_f] = 2.5;
+    EXPECT_TRUE(p["x"_f]);
+    EXPECT_EQ(p["x"_f], 2.5);
+    EXPECT_EQ(*p.get<2>(), 2.5);
+    EXPECT_EQ(p.get<"x">().value(), 2.5);
+    EXPECT_EQ(p["y"_f].value_or(7), 7);
+    EXPECT_THROW(p["y"_f].value(), bad_optional_access);
+
+    *p["x"_f] += 1;
+    EXPECT_EQ(p["x"_f], 3.5);
+
+    p["selected"_f].emplace(true);
+    EXPECT_EQ(p["selected"_f], true);
+    EXPECT_FALSE(p["visible"_f].has_value());
+
+    p["x"_f].reset();
+    EXPECT_FALSE(p["x"_f].has_value());
+    EXPECT_EQ(p["selected"_f], true);
+
+    p["y"_f] = optional<double>(4);
+    EXPECT_EQ(p["y"_f], optional<double>(4));
+    p["y"_f] = nullopt;
+    EXPECT_FALSE(p["y"_f].has_value());
+
+    // non-compact fields are still fields
+    static_assert(is_same_v<decltype(p["label"_f]), Point::get_type_by_name<"label">&>);
+    p["label"_f] = "abc";
+    EXPECT_EQ(p["label"_f], "abc");
+
+    const Point& c = p;
+    EXPECT_EQ(c["selected"_f], true);
+
+    Point q{true, 1.0, 2u, false, nullopt, Color::green, "q", vector<int32_t>{}};
+    EXPECT_EQ(q["visible"_f], true);
+    EXPECT_EQ(q["id"_f], 2);
+    q["id"_f] = numeric_limits<uint32_t>::max();
+    // converted as comparing a `std::optional<uint32_t>` with `-1`
+    EXPECT_TRUE(q["id"_f] == -1);
+    q["id"_f] = 2u;
+    EXPECT_FALSE(q["y"_f].has_value());
+    EXPECT_EQ(q["color"_f], Color::green);
+    EXPECT_EQ(q["label"_f], "q");
+}
+
+GTEST_TEST(compact_layout, message) {
+    auto p = make_point();
+
+    auto copy = p;
+    EXPECT_EQ(copy, p);
+
+    copy["id"_f] = 301u;
+    EXPECT_NE(copy, p);
+
+    copy["id"_f].reset();
+    Point m = p;
+    m.merge(copy);
+    EXPECT_EQ(m["id"_f], 300);
+    EXPECT_EQ(m["x"_f], 1.5);
+    EXPECT_EQ(m["tags"_f].size(), 6u);
+
+    copy = std::move(m);
+    EXPECT_EQ(copy["id"_f], 300);
+
+    copy.clear();
+    EXPECT_EQ(copy, Point{});
+
+    size_t present = 0;
+    p.for_each([&]<field_c F>(const F& f) {
+        present += !empty_field(f);
+    });
+    EXPECT_EQ(present, 7u);
+}
+
+GTEST_TEST(compact_layout, coder) {
+    auto p = make_point();
+
+    LoosePoint l{true, 1.5, 300u, nullopt, -2.25, Color::blue, "origin", vector<int32_t>{1, -2, 3}};
+
+    // the same bytes as the message in the default layout
+    auto buf = encode(p);
+    EXPECT_EQ(buf, encode(l));
+
+    EXPECT_EQ(message_coder<Point>::decode(buf).first, p);
+
+    auto r = message_coder<Point>::checked_decode(buf);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first, p);
+
+    Point reused;
+    reused["selected"_f] = true;
+    message_coder<Point>::decode_reuse(reused, buf);
+    EXPECT_EQ(reused, p);
+
+    Shape s{"s", vector<Point>{p, Point{}, p}, 7ull};
+    auto sb = encode(s);
+    EXPECT_EQ(message_coder<Shape>::decode(sb).first, s);
+
+    vector<byte> v;
+    {
+        vector_sink sink(v);
+        message_coder<Shape>::encode(s, sink);
+    }
+    EXPECT_EQ(v, sb);
+
+    constexpr auto& blob = constant_encode<[] {
+        Scalars m;
+        m.get<1>() = 1u;
+        m.get<20>() = 150u;
+        return m;
+    }>;
+    static_assert(blob.size() == 2 + 4);
+}
@@ -66,3 +66,54 @@ GTEST_TEST(compatibility, decode) {
     EXPECT_EQ(myClass["students"_f][1], (Student{123456, "jerry"}));
     EXPECT_EQ(myClass["students"_f][0], (Student{456, "tom"}));
 }
+
+using Numbers = message<
+    int32_field<"ints", 1, packed>,
+    fixed64_field<"fixeds", 2, packed>,
+    double_field<"doubles", 3, packed>,
+    uint32_field<"unpacked", 4, repeated>
+>;
+
+GTEST_TEST(compatibility, encode_packed) {
+    Numbers myNumbers {vector{1, 300, 70000}, vector<pp::uint<8>>{1, 1ull << 40}, vector{1.5, -0.25}, vector<pp::uint<4>>{7, 8}};
+
+    array<byte, 64> buffer{};
+    auto end = message_coder<Numbers>::encode(myNumbers, buffer);
+
+    pb::Numbers yourNumbers;
+    ASSERT_TRUE(yourNumbers.ParseFromArray(buffer.data(), begin_diff(end, buffer)));
+
+    EXPECT_EQ(yourNumbers.ints_size(), 3);
+    EXPECT_EQ(yourNumbers.ints(2), 70000);
+    EXPECT_EQ(yourNumbers.fixeds_size(), 2);
+    EXPECT_EQ(yourNumbers.fixeds(1), 1ull << 40);
+    EXPECT_EQ(yourNumbers.doubles_size(), 2);
+    EXPECT_EQ(yourNumbers.doubles(1), -0.25);
+    EXPECT_EQ(yourNumbers.unpacked_size(), 2);
+    EXPECT_EQ(yourNumbers.unpacked(1), 8);
+}
+
+GTEST_TEST(compatibility, decode_packed) {
+    pb::Numbers yourNumbers;
+    yourNumbers.add_ints(1);
+    yourNumbers.add_ints(300);
+    yourNumbers.add_ints(70000);
+    yourNumbers.add_fixeds(1ull << 40);
+    yourNumbers.add_doubles(1.5);
+    yourNumbers.add_unpacked(7);
+    yourNumbers.add_unpacked(8);
+
+    array<byte, 64> buffer{};
+    yourNumbers.SerializeToArray(buffer.data(), buffer.size());
+
+    auto [myNumbers, _] = message_coder<Numbers>::decode(buffer);
+    EXPECT_EQ(myNumbers["ints"_f], (vector{1, 300, 70000}));
+    EXPECT_EQ(myNumbers["fixeds"_f], (vector<pp::uint<8>>{1ull << 40}));
+    EXPECT_EQ(myNumbers["doubles"_f], (vector{1.5}));
+    EXPECT_EQ(myNumbers["unpacked"_f], (vector<pp::uint<4>>{7, 8}));
+
+    using UnpackedNumbers = message<int32_field<"ints", 1, repeated>, uint32_field<"unpacked", 4, packed>>;
+    auto [myUnpackedNumbers, _2] = message_coder<UnpackedNumbers>::decode(buffer);
+    EXPECT_EQ(myUnpackedNumbers["ints"_f], (vector{1, 300, 70000}));
+    EXPECT_EQ(myUnpackedNumbers["unpacked"_f], (vector<pp::uint<4>>{7, 8}));
+}
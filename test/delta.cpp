@@ -0,0 +1,172 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <protopuf/delta.h>
+#include <protopuf/map.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace pp;
+using namespace std;
+
+namespace {
+    using Position = message<double_field<"x", 1>, double_field<"y", 2>>;
+
+    using Player = message<string_field<"name", 1>, uint32_field<"hp", 2>, message_field<"position", 3, Position>,
+        int32_field<"items", 4, packed>, string_field<"log", 5, repeated>, map_field<"stats", 6, string_coder, varint_coder<uint32>>,
+        oneof_field<"target", uint32_field<"npc", 7>, string_field<"player", 8>>>;
+
+    using World = message<uint64_field<"tick", 1>, message_field<"players", 2, Player, repeated>, message_field<"host", 3, Player>>;
+
+    Player make_player() {
+        Player p;
+        p["name"_f] = "alice";
+        p["hp"_f] = 100u;
+        p["position"_f] = Position{1.0, 2.0};
+        p["items"_f] = {1, 2, 3};
+        p["log"_f] = {"joined"};
+        p["stats"_f] = {{"kills", 3u}, {"deaths", 1u}};
+        p["target"_f].emplace<7>(42u);
+
+        return p;
+    }
+
+    template <message_c T>
+    vector<byte> encode(const T& msg) {
+        vector<byte> res(skipper<message_coder<T>>::encode_skip(msg));
+        message_coder<T>::encode(msg, res);
+
+        return res;
+    }
+
+    template <message_c T>
+    T applied(T from, const T& to) {
+        auto d = delta_coder<T>::encode(from, to);
+        EXPECT_EQ(d.size(), delta_coder<T>::encode_skip(from, to));
+
+        auto c = from;
+        EXPECT_TRUE(delta_coder<T>::apply(c, d).empty());
+
+        auto r = delta_coder<T>::checked_apply(from, d);
+        EXPECT_TRUE(r);
+        EXPECT_EQ(from, c);
+
+        return c;
+    }
+}
+
+GTEST_TEST(delta_coder, unchanged) {
+    auto p = make_player();
+
+    EXPECT_EQ(delta_coder<Player>::encode_skip(p, p), 0);
+    EXPECT_EQ(applied(p, p), p);
+    EXPECT_EQ(applied(Player{}, Player{}), Player{});
+}
+
+GTEST_TEST(delta_coder, singular) {
+    auto from = make_player();
+    auto to = from;
+    to["hp"_f] = 90u;
+
+    // only the changed field is written, as an encoded message of the same type
+    auto d = delta_coder<Player>::encode(from, to);
+    Player only;
+    only["hp"_f] = 90u;
+    EXPECT_EQ(d, encode(only));
+    EXPECT_EQ(applied(from, to), to);
+
+    to["target"_f].emplace<8>("bob");
+    EXPECT_EQ(applied(from, to), to);
+
+    // emptied fields are listed in the leading record
+    to["name"_f].reset();
+    to["target"_f].reset();
+    EXPECT_EQ(applied(from, to), to);
+    EXPECT_EQ(applied(to, from), from);
+
+    EXPECT_EQ(applied(Player{}, from), from);
+    EXPECT_EQ(applied(from, Player{}), Player{});
+}
+
+GTEST_TEST(delta_coder, repeated) {
+    auto from = make_player();
+    auto to = from;
+    to["items"_f].push_back(4);
+    to["log"_f].push_back("moved");
+
+    // appended elements are written alone
+    auto d = delta_coder<Player>::encode(from, to);
+    Player tail;
+    tail["items"_f] = {4};
+    tail["log"_f] = {"moved"};
+    EXPECT_EQ(d, encode(tail));
+    EXPECT_EQ(applied(from, to), to);
+
+    // other changes replace the field
+    to["items"_f] = {3, 2};
+    to["stats"_f]["kills"] = 4u;
+    to["log"_f].clear();
+    EXPECT_EQ(applied(from, to), to);
+    EXPECT_EQ(applied(to, from), from);
+}
+
+GTEST_TEST(delta_coder, nested) {
+    World from{7ull, vector<Player>{make_player(), make_player()}, make_player()};
+    auto to = from;
+    to["tick"_f] = 8ull;
+    to["host"_f]->get<"position">()->get<"y">() = 2.5;
+    to["host"_f]->get<"log">().push_back("moved");
+
+    // changes of the embedded message are written as a nested delta
+    auto d = delta_coder<World>::encode(from, to);
+    EXPECT_LT(d.size(), 2 + skipper<embedded_message_coder<Player>>::encode_skip(*to["host"_f]));
+    EXPECT_EQ(applied(from, to), to);
+
+    to["host"_f]->get<"position">().reset();
+    EXPECT_EQ(applied(from, to), to);
+
+    to["host"_f].reset();
+    EXPECT_EQ(applied(from, to), to);
+    EXPECT_EQ(applied(to, from), from);
+
+    // repeated messages are written whole
+    to["players"_f][1]["hp"_f] = 1u;
+    EXPECT_EQ(applied(from, to), to);
+}
+
+GTEST_TEST(delta_coder, malformed) {
+    auto from = make_player();
+    auto to = from;
+    to["name"_f].reset();
+    to["position"_f]->get<"x">() = 5.0;
+
+    auto d = delta_coder<Player>::encode(from, to);
+    for(size_t n = 1; n < d.size(); ++n) {
+        auto v = from;
+        auto r = delta_coder<Player>::checked_apply(v, bytes(d.data(), n));
+        if(r) {
+            EXPECT_TRUE(r->empty());
+        }
+    }
+
+    array<byte, 4> overflow{0xc2_b, 0xa3_b, 0x09_b, 0x7f_b};
+    auto v = from;
+    auto r = delta_coder<Player>::checked_apply(v, overflow);
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error(), decode_error::length_overflow);
+}
@@ -0,0 +1,159 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <protopuf/fixed.h>
+
+#include <array>
+#include <vector>
+
+using namespace pp;
+using namespace std;
+
+namespace {
+    enum class Side : uint8_t { buy, sell };
+
+    using Tick = message<fixed64_field<"ts", 1>, double_field<"price", 2>, float_field<"qty", 3>, bool_field<"last", 4>,
+        sfixed32_field<"venue", 5>, enum_field<"side", 6, Side>>;
+
+    using Sample = message<uint32_field<"id", 1>, sint64_field<"delta", 2>, int32_field<"level", 20>>;
+
+    using Bar = message<message_field<"open", 1, Tick>, message_field<"close", 2, Tick>, uint64_field<"volume", 3>,
+        oneof_field<"source", fixed32_field<"feed", 4>, message_field<"sample", 5, Sample>>>;
+
+    using Bars = message<message_field<"a", 1, Bar>, message_field<"b", 2, Bar>, message_field<"c", 3, Bar>>;
+
+    using Series = message<message_field<"bars", 1, Bars>, uint32_field<"count", 2>>;
+
+    template <message_c T>
+    vector<byte> encode(const T& msg) {
+        vector<byte> res(skipper<message_coder<T>>::encode_skip(msg));
+        message_coder<T>::encode(msg, res);
+
+        return res;
+    }
+
+    constexpr Tick make_tick(uint64_t ts) {
+        return Tick{ts, 101.25, 3.5f, ts % 2 == 0, -7, Side::sell};
+    }
+
+    Bar make_bar(uint64_t ts) {
+        Bar b;
+        b["open"_f] = make_tick(ts);
+        b["close"_f] = make_tick(ts + 1);
+        b["volume"_f] = 1ull << 40;
+        b["source"_f].emplace<5>(Sample{300u, sint_zigzag<8>(-3), -1});
+
+        return b;
+    }
+
+    Bar only_close() {
+        Bar b;
+        b["close"_f] = make_tick(1);
+
+        return b;
+    }
+}
+
+GTEST_TEST(fixed_coder, max_size) {
+    static_assert(max_encoded_size<Tick> == 9 + 9 + 5 + 2 + 5 + 3);
+    static_assert(max_encoded_size<Sample> == 6 + 11 + 7);
+    static_assert(max_encoded_size<Bar> == 2 * (2 + 33) + 11 + (2 + 24));
+    static_assert(max_encoded_size<Bars> == 3 * (2 + 107));
+    static_assert(max_encoded_size<Series> == (3 + 327) + 6);
+    static_assert(max_encoded_size<message<>> == 0);
+
+    static_assert(fixed_shape<Tick>);
+    static_assert(!fixed_shape<message<uint32_field<"a", 1>, string_field<"b", 2>>>);
+    static_assert(!fixed_shape<message<uint32_field<"a", 1, repeated>>>);
+    static_assert(!fixed_shape<message<message_field<"a", 1, message<bytes_field<"b", 1>>>>>);
+
+    // a bound, never exceeded by any message
+    Bar b = make_bar(numeric_limits<uint64_t>::max() - 1);
+    b["volume"_f] = numeric_limits<uint64_t>::max();
+    b["open"_f]->get<"side">() = Side(255);
+    b["close"_f]->get<"side">() = Side(255);
+    b["source"_f].emplace<5>(Sample{numeric_limits<uint32_t>::max(), sint_zigzag<8>(numeric_limits<int64_t>::min()), -1});
+    EXPECT_EQ(encode(b).size(), max_encoded_size<Bar>);
+}
+
+GTEST_TEST(fixed_coder, encode) {
+    auto t = make_tick(42);
+    auto buf = fixed_coder<Tick>::encode(t);
+    EXPECT_EQ(vector<byte>(buf.begin(), buf.end()), encode(t));
+
+    Tick partial;
+    partial["price"_f] = 1.0;
+    partial["side"_f] = Side::buy;
+    auto pbuf = fixed_coder<Tick>::encode(partial);
+    EXPECT_EQ(vector<byte>(pbuf.begin(), pbuf.end()), encode(partial));
+
+    EXPECT_EQ(fixed_coder<Tick>::encode(Tick{}).size(), 0);
+
+    // embedded messages which always fit in one length byte, or not
+    for(auto msg : {make_bar(7), Bar{}, only_close()}) {
+        auto bb = fixed_coder<Bar>::encode(msg);
+        EXPECT_EQ(vector<byte>(bb.begin(), bb.end()), encode(msg));
+
+        Series s{Bars{msg, Bar{}, make_bar(9)}, 3u};
+        auto sb = fixed_coder<Series>::encode(s);
+        EXPECT_EQ(vector<byte>(sb.begin(), sb.end()), encode(s));
+    }
+
+    array<byte, max_encoded_size<Tick> + 4> raw{};
+    auto rest = fixed_coder<Tick>::encode(t, raw);
+    EXPECT_EQ(rest.size(), raw.size() - encode(t).size());
+
+    // encoding at compile time, where `Side::sell` takes one byte of the two at most
+    constexpr auto size = fixed_coder<Tick>::encode(make_tick(2)).size();
+    static_assert(size == max_encoded_size<Tick> - 1);
+}
+
+GTEST_TEST(fixed_coder, decode) {
+    for(auto msg : {make_bar(7), Bar{}, only_close()}) {
+        auto buf = encode(msg);
+        auto [v, rest] = fixed_coder<Bar>::decode(buf);
+        EXPECT_EQ(v, msg);
+        EXPECT_TRUE(rest.empty());
+
+        Series s{Bars{msg, nullopt, make_bar(9)}, 3u};
+        auto sb = encode(s);
+        EXPECT_EQ(fixed_coder<Series>::decode(sb).first, s);
+    }
+
+    // fields out of order, unknown fields and repeated singular fields are decoded as `message_coder` does
+    auto t = make_tick(3);
+    auto head = encode(Tick{nullopt, nullopt, nullopt, nullopt, -7, Side::sell});
+    auto tail = encode(Tick{3ull, 101.25, 3.5f, false, nullopt, nullopt});
+    auto unknown = encode(message<uint32_field<"x", 9>>{5u});
+    auto again = encode(Tick{4ull, nullopt, nullopt, nullopt, nullopt, nullopt});
+
+    vector<byte> buf;
+    for(const auto& part : {head, unknown, tail, again}) {
+        buf.insert(buf.end(), part.begin(), part.end());
+    }
+
+    auto v = fixed_coder<Tick>::decode(buf).first;
+    EXPECT_EQ(v, message_coder<Tick>::decode(buf).first);
+    t["ts"_f] = 4ull;
+    EXPECT_EQ(v, t);
+
+    Tick into;
+    into["qty"_f] = 1.0f;
+    into["last"_f] = true;
+    auto one = encode(Tick{5ull, nullopt, nullopt, nullopt, nullopt, nullopt});
+    fixed_coder<Tick>::decode(into, one);
+    EXPECT_EQ(into, (Tick{5ull, nullopt, 1.0f, true, nullopt, nullopt}));
+}
@@ -0,0 +1,191 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <protopuf/frame.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace pp;
+using namespace std;
+
+namespace {
+    using Event = message<uint64_field<"ts", 1>, string_field<"text", 2>, int32_field<"values", 3, packed>>;
+    using EventView = message<uint64_field<"ts", 1>, string_view_field<"text", 2>, int32_field<"values", 3, packed>>;
+
+    vector<Event> make_events(size_t n) {
+        vector<Event> res;
+        for(size_t i = 0; i < n; ++i) {
+            res.push_back(Event{i, "event #" + to_string(i) + string(i % 5 * 40, '.'), {int32_t(i), -2}});
+        }
+
+        return res;
+    }
+}
+
+GTEST_TEST(frame_writer, write) {
+    auto events = make_events(20);
+
+    vector<byte> buf;
+    {
+        vector_sink s(buf);
+        frame_writer<Event, vector_sink> w(s);
+
+        for(const auto& e : events) {
+            EXPECT_EQ(w.write(e), skipper<embedded_message_coder<Event>>::encode_skip(e));
+        }
+
+        EXPECT_EQ(w.count(), 20);
+        EXPECT_EQ(w.size(), s.size());
+    }
+
+    // same as delimited messages, i.e. `writeDelimitedTo` of protobuf
+    EXPECT_EQ(buf, batch_coder<Event>::encode(events));
+
+    vector<byte> out;
+    size_t writes = 0;
+    {
+        callback_sink s([&](const_bytes b) { out.insert(out.end(), b.begin(), b.end()); ++writes; }, 256);
+        frame_writer<Event, decltype(s)> w(s);
+
+        EXPECT_EQ(w.write_all(events), buf.size());
+        EXPECT_EQ(w.count(), 20);
+        s.flush();
+    }
+
+    EXPECT_EQ(out, buf);
+    EXPECT_EQ(writes, 1);
+}
+
+GTEST_TEST(frame_reader, read) {
+    auto events = make_events(20);
+    auto buf = batch_coder<Event>::encode(events);
+
+    frame_reader<Event> r(buf);
+    for(const auto& e : events) {
+        auto v = r.next();
+        ASSERT_TRUE(v);
+        EXPECT_EQ(*v, e);
+    }
+
+    EXPECT_FALSE(r.next());
+    EXPECT_TRUE(r.done());
+
+    // views refer to the frames in the buffer
+    frame_reader<EventView> rv(buf);
+    EventView v;
+    for(const auto& e : events) {
+        ASSERT_TRUE(rv.next(v));
+        EXPECT_EQ(*v["text"_f], *e["text"_f]);
+        EXPECT_GE(v["text"_f]->data(), reinterpret_cast<const char*>(buf.data()));
+        EXPECT_LT(v["text"_f]->data(), reinterpret_cast<const char*>(buf.data() + buf.size()));
+    }
+
+    EXPECT_FALSE(rv.next(v));
+    EXPECT_TRUE(rv.done());
+
+    frame_reader<Event> rf(buf);
+    auto f = rf.next_frame();
+    ASSERT_TRUE(f);
+    EXPECT_EQ(message_coder<Event>::decode(*f).first, events[0]);
+    EXPECT_EQ(rf.remaining().size(), buf.size() - f->size() - 1);
+}
+
+GTEST_TEST(frame_reader, error) {
+    auto events = make_events(3);
+    auto buf = batch_coder<Event>::encode(events);
+
+    frame_reader<Event> r(bytes(buf.data(), buf.size() - 1));
+    EXPECT_TRUE(r.next());
+    EXPECT_TRUE(r.next());
+    EXPECT_FALSE(r.next());
+    EXPECT_FALSE(r.done());
+    EXPECT_EQ(r.error(), decode_error::length_overflow);
+
+    // no more frames are read after an error
+    EXPECT_FALSE(r.next_frame());
+}
+
+GTEST_TEST(frame_stream, feed) {
+    auto events = make_events(50);
+    auto buf = batch_coder<Event>::encode(events);
+
+    for(size_t step : {1, 3, 64, 1000}) {
+        frame_stream<Event> s;
+        vector<Event> out;
+
+        for(size_t i = 0; i < buf.size(); i += step) {
+            ASSERT_TRUE(s.feed(bytes(buf).subspan(i, min(step, buf.size() - i)), [&](Event&& e) { out.push_back(std::move(e)); }));
+        }
+
+        EXPECT_TRUE(s.at_boundary());
+        EXPECT_EQ(out, events);
+    }
+
+    frame_stream<Event> s;
+    size_t n = 0;
+    EXPECT_TRUE(s.feed(bytes(buf).subspan(0, 5), [&](Event&&) { ++n; }));
+    EXPECT_FALSE(s.at_boundary());
+    EXPECT_EQ(s.buffered(), 5);
+
+    array<byte, 3> huge{0xff_b, 0xff_b, 0x7f_b};
+    frame_stream<Event> limited(1024);
+    EXPECT_FALSE(limited.feed(huge, [&](Event&&) { ++n; }));
+    EXPECT_EQ(limited.error(), decode_error::length_overflow);
+    EXPECT_EQ(n, 0);
+}
+
+#ifdef PROTOPUF_HAS_MMAP
+GTEST_TEST(mapped_file, read) {
+    auto events = make_events(100);
+    auto buf = batch_coder<Event>::encode(events);
+
+    auto path = filesystem::temp_directory_path() / "protopuf_frame_test.bin";
+    {
+        ofstream file(path, ios::binary);
+        callback_sink s([&](const_bytes b) { file.write(reinterpret_cast<const char*>(b.data()), streamsize(b.size())); });
+        frame_writer<Event, decltype(s)> w(s);
+
+        for(const auto& e : events) {
+            w.write(e);
+        }
+
+        s.flush();
+    }
+
+    {
+        mapped_file f(path.c_str());
+        ASSERT_TRUE(f.is_open());
+        EXPECT_EQ(f.size(), buf.size());
+
+        frame_reader<EventView> r(f.data());
+        EventView v;
+        size_t i = 0;
+        while(r.next(v)) {
+            EXPECT_EQ(*v["ts"_f], *events[i]["ts"_f]);
+            EXPECT_EQ(*v["text"_f], *events[i]["text"_f]);
+            ++i;
+        }
+
+        EXPECT_TRUE(r.done());
+        EXPECT_EQ(i, events.size());
+    }
+
+    filesystem::remove(path);
+    EXPECT_FALSE(mapped_file(path.c_str()).is_open());
+}
+#endif
@@ -0,0 +1,86 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+#include <schema.pp.h>
+#include <renamed.pp.h>
+
+#include <type_traits>
+#include <vector>
+
+using namespace pp;
+using namespace std;
+
+namespace expected {
+    enum class Level : int32 { LOW = 0, HIGH = 2, NEGATIVE = -1 };
+
+    using Point = message<double_field<"x", 1>, double_field<"y", 2>, sint32_field<"deltas", 3, repeated>,
+        fixed32_field<"marks", 4, packed>, enum_field<"level", 5, gen::common::Level>>;
+
+    using Style = message<uint32_field<"color", 1>, float_field<"width", 2>, bool_field<"dashed", 3>>;
+
+    using Shape = message<string_field<"name", 1>, enum_field<"kind", 2, gen::Shape_Kind>,
+        message_field<"points", 3, gen::common::Point, repeated>, message_field<"style", 4, gen::Shape_Style>, int64_field<"id", 5>,
+        int32_field<"tags", 6, packed>, uint64_field<"unpacked", 7, repeated>, string_field<"labels", 8, repeated>,
+        message_field<"origin", 9, gen::common::Point>,
+        oneof_field<"source", string_view_field<"file", 10>, bytes_field<"blob", 11>, message_field<"fallback", 12, gen::Shape_Style>>>;
+
+    using Scene = message<hash_map_field<"shapes", 1, string_coder, embedded_message_coder<gen::Shape>>,
+        map_field<"names", 2, varint_coder<int32>, string_coder>, lazy_message_field<"background", 3, gen::Shape>,
+        message_field<"styles", 4, gen::Shape_Style, repeated>, bytes_view_field<"thumbnail", 5>, sfixed64_field<"version", 6>,
+        message_field<"empty", 7, gen::Empty>, unknown_fields<>>;
+}
+
+GTEST_TEST(generator, types) {
+    static_assert(is_same_v<gen::common::Point, expected::Point>);
+    static_assert(is_same_v<gen::Shape_Style, expected::Style>);
+    static_assert(is_same_v<gen::Shape, expected::Shape>);
+    static_assert(is_same_v<gen::Scene, expected::Scene>);
+    static_assert(is_same_v<gen::Empty, message<>>);
+
+    static_assert(is_same_v<renamed::ns::Token, message<string_field<"text", 1>, double_field<"scores", 2, packed>>>);
+
+    static_assert(underlying_type_t<gen::common::Level>(gen::common::Level::NEGATIVE) == -1);
+    static_assert(underlying_type_t<gen::Shape_Kind>(gen::Shape_Kind::CIRCLE) == 1);
+
+    // options of messages
+    static_assert(compact_layout<gen::Shape_Style>::value);
+    static_assert(!compact_layout<gen::Shape>::value);
+}
+
+GTEST_TEST(generator, coder) {
+    gen::Shape s;
+    s["name"_f] = "triangle";
+    s["kind"_f] = gen::Shape_Kind::POLYGON;
+    s["points"_f] = {gen::common::Point{0.0, 1.0, vector<sint32>{sint32(-1)}, vector<pp::uint<4>>{7}, gen::common::Level::HIGH}};
+    s["style"_f] = gen::Shape_Style{0xff0000u, 1.5f, true};
+    s["tags"_f] = {1, 2, 3};
+    s["source"_f].emplace<"blob">(vector<unsigned char>{1, 2});
+
+    gen::Scene scene;
+    scene["shapes"_f].emplace("t", s);
+    scene["names"_f].emplace(1, "one");
+    scene["version"_f] = 3;
+
+    vector<byte> buf(skipper<message_coder<gen::Scene>>::encode_skip(scene));
+    message_coder<gen::Scene>::encode(scene, buf);
+
+    auto r = message_coder<gen::Scene>::checked_decode(buf);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first["shapes"_f], scene["shapes"_f]);
+    EXPECT_EQ(r->first["names"_f], scene["names"_f]);
+    EXPECT_EQ(r->first["version"_f], 3);
+    EXPECT_FALSE(r->first["thumbnail"_f]);
+    EXPECT_FALSE(r->first["background"_f]);
+}
@@ -0,0 +1,157 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <protopuf/instrument.h>
+
+#include <string>
+#include <vector>
+
+using namespace pp;
+using namespace std;
+
+namespace {
+    using Student = message<uint32_field<"id", 1>, pmr_string_field<"name", 3>>;
+    using Class = message<string_field<"name", 8>, message_field<"students", 3, Student, repeated>>;
+    using ClassId = message<uint32_field<"id", 1>>;
+
+    using Point = message<int32_field<"x", 1>, int32_field<"y", 2>>;
+
+    vector<string> events;
+
+    // records hooks called for `Point`
+    struct recording_instrument : no_instrument {
+        template <message_c T>
+        static scope enter(instrument_event e) {
+            events.push_back(e == instrument_event::encode ? "enter encode" : "enter decode");
+            return {};
+        }
+
+        template <message_c T>
+        static void exit(instrument_event e, scope, size_t n) {
+            events.push_back((e == instrument_event::encode ? "exit encode " : "exit decode ") + to_string(n));
+        }
+
+        template <message_c T>
+        static void field_decoded(size_t i, size_t n) {
+            events.push_back("field " + to_string(i) + " " + to_string(n));
+        }
+    };
+}
+
+template <>
+struct pp::message_instrument<Student> {
+    using type = counting_instrument;
+};
+
+template <>
+struct pp::message_instrument<Class> {
+    using type = counting_instrument;
+};
+
+template <>
+struct pp::message_instrument<ClassId> {
+    using type = counting_instrument;
+};
+
+template <>
+struct pp::message_instrument<Point> {
+    using type = recording_instrument;
+};
+
+GTEST_TEST(instrument, disabled) {
+    using Plain = message<uint64_field<"id", 1>>;
+    static_assert(!instrumented<Plain>);
+    static_assert(instrumented<Class>);
+    static_assert(std::is_empty_v<instrument_scope<Plain>>);
+
+    constexpr auto r = [] {
+        array<byte, 4> a{};
+        message_coder<Plain>::encode(Plain{7}, a);
+        return message_coder<Plain>::decode(a).first;
+    }();
+
+    EXPECT_EQ(r["id"_f], 7);
+}
+
+GTEST_TEST(instrument, hooks) {
+    events.clear();
+
+    array<byte, 16> a{};
+    auto rest = message_coder<Point>::encode(Point{1, 300}, a);
+    auto n = a.size() - rest.size();
+
+    EXPECT_EQ(n, 5);
+    EXPECT_EQ(events, (vector<string>{"enter encode", "exit encode 5"}));
+
+    events.clear();
+    auto [v, _] = message_coder<Point>::decode(bytes(a.data(), n));
+
+    EXPECT_EQ(v, (Point{1, 300}));
+    EXPECT_EQ(events, (vector<string>{"enter decode", "field 0 2", "field 1 3", "exit decode 5"}));
+
+    events.clear();
+    auto r = message_coder<Point>::checked_decode(bytes(a.data(), n - 1));
+
+    EXPECT_FALSE(r);
+    EXPECT_EQ(events, (vector<string>{"enter decode", "field 0 2", "exit decode 0"}));
+}
+
+GTEST_TEST(instrument, counting) {
+    counting_instrument::stats<Class>() = {};
+    counting_instrument::stats<Student>() = {};
+    counting_instrument::stats<ClassId>() = {};
+
+    Class c{"class 101", {Student{123, "twice, not in SSO buffer"}, Student{456, "tom, not in SSO buffer"}}};
+
+    array<byte, 128> a{};
+    auto rest = message_coder<Class>::encode(c, a);
+    auto n = a.size() - rest.size();
+
+    auto& cs = counting_instrument::stats<Class>();
+    auto& ss = counting_instrument::stats<Student>();
+
+    EXPECT_EQ(cs.counters.encoded, 1);
+    EXPECT_EQ(cs.counters.bytes_encoded, n);
+    EXPECT_EQ(ss.counters.encoded, 2);
+
+    counting_resource mr;
+    auto [v, _] = message_coder<Class>::decode(bytes(a.data(), n), &mr);
+
+    EXPECT_EQ(v, c);
+    EXPECT_EQ(cs.counters.decoded, 1);
+    EXPECT_EQ(cs.counters.bytes_decoded, n);
+    EXPECT_EQ(cs.counters.fields_decoded, 3);
+    EXPECT_EQ(cs.decoded_count("name"), 1);
+    EXPECT_EQ(cs.decoded_count("students"), 2);
+    EXPECT_EQ(cs.decoded_bytes("name"), 11);
+    EXPECT_EQ(cs.decoded_count("unknown"), 0);
+    EXPECT_GE(cs.counters.decode_time, ss.counters.decode_time);
+
+    EXPECT_EQ(ss.counters.decoded, 2);
+    EXPECT_EQ(ss.decoded_count("id"), 2);
+    EXPECT_EQ(ss.decoded_count("name"), 2);
+    EXPECT_EQ(ss.counters.allocations, 2);
+    EXPECT_EQ(cs.counters.allocations, 0);
+    EXPECT_EQ(counting_instrument::current(), nullptr);
+
+    // all fields are skipped as unknown fields
+    message_coder<ClassId>::decode(bytes(a.data(), n));
+
+    auto& is = counting_instrument::stats<ClassId>();
+    EXPECT_EQ(is.counters.fields_decoded, 0);
+    EXPECT_EQ(is.counters.fields_skipped, 3);
+    EXPECT_EQ(is.counters.bytes_decoded, n);
+}
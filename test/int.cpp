@@ -55,6 +55,41 @@ GTEST_TEST(converter, int_to_byte) {
     EXPECT_EQ(int_to_bytes<4>(u3), a3);
 }
 
+GTEST_TEST(converter, constexpr) {
+    static_assert([] {
+        array a{0b0_b, 0b11_b, 0b1111_b, 0b111111_b};
+        return bytes_to_int(span(a));
+    }() == 0b00111111'00001111'00000011'00000000);
+    static_assert([] {
+        array<byte, 8> a{};
+        int_to_bytes<8>(0x0102'0304'0506'0708, span(a));
+        return a == array{8_b, 7_b, 6_b, 5_b, 4_b, 3_b, 2_b, 1_b};
+    }());
+    static_assert(int_to_bytes<2>(0x1234) == array{0x34_b, 0x12_b});
+
+    array<byte, 8> b{8_b, 7_b, 6_b, 5_b, 4_b, 3_b, 2_b, 1_b};
+    EXPECT_EQ(bytes_to_int(span(b)), 0x0102'0304'0506'0708u);
+    EXPECT_EQ(bytes_to_int(span(b).subspan<1, 2>()), 0x0607u);
+}
+
+GTEST_TEST(converter, byteswap) {
+    static_assert(pp::byteswap<pp::uint<1>>(0x12) == 0x12);
+    static_assert(pp::byteswap<pp::uint<2>>(0x1234) == 0x3412);
+    static_assert(pp::byteswap<pp::uint<4>>(0x1234'5678) == 0x7856'3412);
+    static_assert(pp::byteswap<pp::uint<8>>(0x0102'0304'0506'0708) == 0x0807'0605'0403'0201);
+    static_assert(to_little_endian<pp::uint<4>>(0x1234'5678) == (needs_byteswap ? 0x7856'3412 : 0x1234'5678));
+
+    array<byte, 11> a{0_b, 1_b, 2_b, 3_b, 4_b, 5_b, 6_b, 7_b, 8_b, 9_b, 10_b};
+    byteswap_elements<4>(span(a).subspan(1, 8));
+    EXPECT_EQ(a, (array{0_b, 4_b, 3_b, 2_b, 1_b, 8_b, 7_b, 6_b, 5_b, 9_b, 10_b}));
+
+    byteswap_elements<2>(span(a).subspan(1, 3));
+    EXPECT_EQ(a, (array{0_b, 3_b, 4_b, 2_b, 1_b, 8_b, 7_b, 6_b, 5_b, 9_b, 10_b}));
+
+    byteswap_elements<1>(span(a));
+    EXPECT_EQ(a[1], 3_b);
+}
+
 array a4{0b101010_b, 0b1011100_b, 0b1001_b, 0b0_b, 0b11_b, 0b1111_b, 0b111111_b};
 
 GTEST_TEST(integer_coder, encode) {
@@ -98,3 +133,16 @@ GTEST_TEST(integer_coder, signed) {
     auto [m1e, _] = integer_coder<sint<4>>::decode(span(am1));
     EXPECT_EQ(m1e, m1);
 }
+
+GTEST_TEST(integer_coder, checked_decode) {
+    array<byte, 4> a{0x01_b, 0x02_b, 0x03_b, 0x04_b};
+
+    auto r = integer_coder<pp::uint<4>>::checked_decode(a);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first, 0x04030201);
+    EXPECT_EQ(begin_diff(r->second, a), 4);
+
+    auto e = integer_coder<pp::uint<8>>::checked_decode(a);
+    ASSERT_FALSE(e);
+    EXPECT_EQ(e.error(), decode_error::truncated);
+}
@@ -0,0 +1,122 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <protopuf/lazy.h>
+#include <array>
+#include <utility>
+
+using namespace pp;
+using namespace std;
+
+namespace {
+    using Student = message<uint32_field<"id", 1>, string_field<"name", 3>>;
+    using Class = message<string_field<"name", 8>, message_field<"students", 3, Student, repeated>, message_field<"monitor", 4, Student>>;
+    using LazyClass = message<string_field<"name", 8>, lazy_message_field<"students", 3, Student, repeated>, lazy_message_field<"monitor", 4, Student>>;
+
+    template <typename T>
+    vector<byte> encode(const T& v) {
+        vector<byte> res(skipper<message_coder<T>>::encode_skip(v));
+        message_coder<T>::encode(v, res);
+        return res;
+    }
+}
+
+GTEST_TEST(lazy_message_coder, decode) {
+    Class c{"class 101", vector<Student>{Student{123, "tom"}, Student{456, "jerry"}}, Student{789, "twice"}};
+    auto e = encode(c);
+
+    auto [v, n] = message_coder<LazyClass>::decode(e);
+    EXPECT_TRUE(n.empty());
+    EXPECT_EQ(v["name"_f], "class 101");
+    ASSERT_EQ(v["students"_f].size(), 2);
+    EXPECT_FALSE(v["students"_f][0].is_parsed());
+    EXPECT_FALSE(v["monitor"_f]->is_parsed());
+
+    // the recorded bytes refer to the input
+    auto raw = v["monitor"_f]->raw_bytes();
+    ASSERT_TRUE(raw);
+    EXPECT_GE(raw->data(), e.data());
+    EXPECT_LT(raw->data(), e.data() + e.size());
+
+    const auto& cv = v;
+    EXPECT_EQ(cv["monitor"_f]->value()["name"_f], "twice");
+    EXPECT_TRUE(cv["monitor"_f]->is_parsed());
+    EXPECT_TRUE(cv["monitor"_f]->raw_bytes());
+    EXPECT_FALSE(cv["monitor"_f]->parse_error());
+    EXPECT_EQ(cv["students"_f][1]->get<"id">(), 456);
+
+    auto r = message_coder<LazyClass>::checked_decode(e);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first, v);
+}
+
+GTEST_TEST(lazy_message_coder, encode) {
+    Class c{"class 101", vector<Student>{Student{123, "tom"}, Student{456, "jerry"}}, Student{789, "twice"}};
+    auto e = encode(c);
+
+    auto [v, _] = message_coder<LazyClass>::decode(e);
+
+    // untouched or only read: copied verbatim
+    EXPECT_EQ(as_const(v)["students"_f][0]->get<"name">(), "tom");
+    EXPECT_TRUE(v["students"_f][0].is_parsed());
+    EXPECT_TRUE(v["students"_f][0].raw_bytes());
+    EXPECT_EQ(encode(v), e);
+
+    vector<byte> s;
+    {
+        vector_sink sink(s);
+        message_coder<LazyClass>::encode(v, sink);
+    }
+    EXPECT_EQ(s, e);
+
+    // modified: encoded from the parsed message
+    v["monitor"_f]->value()["name"_f] = "jerry";
+    EXPECT_FALSE(v["monitor"_f]->raw_bytes());
+
+    c["monitor"_f]->get<"name">() = "jerry";
+    EXPECT_EQ(encode(v), encode(c));
+
+    LazyClass l{"x", vector<lazy_message<Student>>{Student{1, "a"}}, Student{2, "b"}};
+    auto le = encode(l);
+    EXPECT_EQ(message_coder<Class>::decode(le).first, (Class{"x", vector<Student>{Student{1, "a"}}, Student{2, "b"}}));
+}
+
+GTEST_TEST(lazy_message_coder, verbatim) {
+    // a student with its name repeated, which is not how the student would be re-encoded
+    array<byte, 10> a{0x1A_b, 0x08_b, 0x08_b, 0x01_b, 0x1A_b, 0x01_b, 0x61_b, 0x1A_b, 0x01_b, 0x62_b};
+
+    auto [v, _] = message_coder<LazyClass>::decode(a);
+    EXPECT_EQ(as_const(v)["students"_f][0]->get<"name">(), "b");
+    EXPECT_TRUE(v["students"_f][0].raw_bytes());
+    EXPECT_EQ(encode(v), vector<byte>(a.begin(), a.end()));
+
+    // accessed mutably: the raw bytes are dropped and the student is re-encoded
+    v["students"_f][0]->get<"id">() = 1;
+    EXPECT_FALSE(v["students"_f][0].raw_bytes());
+    EXPECT_EQ(encode(v), (vector<byte>{0x1A_b, 0x05_b, 0x08_b, 0x01_b, 0x1A_b, 0x01_b, 0x62_b}));
+}
+
+GTEST_TEST(lazy_message_coder, parse_error) {
+    array<byte, 4> a{0x22_b, 0x02_b, 0x1A_b, 0x05_b};
+
+    auto r = message_coder<LazyClass>::checked_decode(a);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first["monitor"_f]->parse_error(), decode_error::length_overflow);
+    EXPECT_EQ(r->first["monitor"_f]->value(), Student{});
+
+    array<byte, 3> b{0x22_b, 0x05_b, 0x1A_b};
+    EXPECT_EQ(message_coder<LazyClass>::checked_decode(b).error(), decode_error::length_overflow);
+}
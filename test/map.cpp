@@ -50,3 +50,161 @@ GTEST_TEST(map, utility) {
     EXPECT_EQ(msg1["data"_f].size(), 5);
     EXPECT_EQ(msg1["data"_f], (map<optional<string>, optional<int>>{{"one", 1}, {"two", 2}, {"three", 3}, {"four", 4}, {"five", 5}}));
 }
+
+GTEST_TEST(map, memory_resource) {
+    using PmrMap = message<pmr_map_field<"map", 233, pmr_string_coder, varint_coder<int>>>;
+
+    array<byte, 30> buffer { 0xca_b, 0x0e_b, 0x05_b, 0x0a_b, 0x01_b, 0x61_b, 0x10_b, 0x01_b, 0xca_b, 0x0e_b, 0x05_b, 0x0a_b, 0x01_b, 0x62_b, 0x10_b, 0x02_b, 0xca_b, 0x0e_b, 0x05_b, 0x0a_b, 0x01_b, 0x63_b, 0x10_b, 0x03_b };
+
+    array<byte, 1024> storage{};
+    std::pmr::monotonic_buffer_resource arena(storage.data(), storage.size(), std::pmr::null_memory_resource());
+    auto origin = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+    auto [map, _] = message_coder<PmrMap>::decode(buffer, &arena);
+    std::pmr::set_default_resource(origin);
+
+    EXPECT_EQ(map["map"_f].get_allocator().resource(), &arena);
+    EXPECT_EQ(map["map"_f].size(), 3);
+    EXPECT_EQ(map["map"_f].at("b"), 2);
+}
+
+namespace {
+    // a memory resource counting allocations from the global heap
+    struct counting_resource : std::pmr::memory_resource {
+        size_t count = 0;
+
+        void* do_allocate(size_t n, size_t align) override {
+            ++count;
+            return std::pmr::new_delete_resource()->allocate(n, align);
+        }
+
+        void do_deallocate(void* p, size_t n, size_t align) override {
+            std::pmr::new_delete_resource()->deallocate(p, n, align);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+}
+
+GTEST_TEST(map, memory_resource_no_default_allocation) {
+    using PmrMap = message<pmr_map_field<"map", 1, pmr_string_coder, pmr_string_coder>>;
+
+    // keys and values longer than the small string buffer
+    PmrMap m;
+    for(int i = 0; i < 10; ++i) {
+        m["map"_f].emplace(std::pmr::string(40, char('a' + i)), std::pmr::string(50, char('A' + i)));
+    }
+
+    vector<byte> buffer(skipper<message_coder<PmrMap>>::encode_skip(m));
+    message_coder<PmrMap>::encode(m, buffer);
+
+    std::pmr::monotonic_buffer_resource arena;
+    counting_resource counter;
+    auto origin = std::pmr::set_default_resource(&counter);
+
+    auto [map, _] = message_coder<PmrMap>::decode(buffer, &arena);
+    EXPECT_EQ(counter.count, 0);
+
+    auto r = message_coder<PmrMap>::checked_decode(buffer, &arena);
+    EXPECT_EQ(counter.count, 0);
+
+    // while no resource is given, the default one is used
+    message_coder<PmrMap>::decode(buffer);
+    EXPECT_GT(counter.count, 0);
+
+    std::pmr::set_default_resource(origin);
+
+    EXPECT_EQ(map["map"_f], m["map"_f]);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first["map"_f], m["map"_f]);
+    EXPECT_EQ(map["map"_f].begin()->first->get_allocator().resource(), &arena);
+    EXPECT_EQ(map["map"_f].begin()->second->get_allocator().resource(), &arena);
+}
+
+GTEST_TEST(map, flat_hash_map) {
+    using HashMap = message<hash_map_field<"map", 233, string_coder, varint_coder<int>>>;
+
+    array<byte, 30> buffer { 0xca_b, 0x0e_b, 0x05_b, 0x0a_b, 0x01_b, 0x61_b, 0x10_b, 0x01_b, 0xca_b, 0x0e_b, 0x05_b, 0x0a_b, 0x01_b, 0x62_b, 0x10_b, 0x02_b, 0xca_b, 0x0e_b, 0x05_b, 0x0a_b, 0x01_b, 0x63_b, 0x10_b, 0x03_b };
+
+    auto [map, _] = message_coder<HashMap>::decode(buffer);
+    EXPECT_EQ(map["map"_f].size(), 3);
+    EXPECT_EQ(map["map"_f].at("a"), 1);
+    EXPECT_EQ(map["map"_f].at("b"), 2);
+    EXPECT_EQ(map["map"_f].at("c"), 3);
+
+    // entries are stored in insertion order
+    array<byte, 30> encoded{};
+    message_coder<HashMap>::encode(map, encoded);
+    EXPECT_EQ(encoded, buffer);
+
+    auto r = message_coder<HashMap>::checked_decode(buffer);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first, map);
+    EXPECT_FALSE(message_coder<HashMap>::checked_decode(bytes(buffer).subspan(0, 23)));
+
+    HashMap other{{{"d", 4}, {"a", 5}}};
+    map.merge(other);
+    EXPECT_EQ(map["map"_f].size(), 4);
+    EXPECT_EQ(map["map"_f].at("a"), 1);
+    EXPECT_EQ(map["map"_f].at("d"), 4);
+}
+
+GTEST_TEST(map, flat_hash_map_operations) {
+    flat_hash_map<int, int> m;
+    for(int i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(m.emplace(i, i * 2).second);
+    }
+    EXPECT_FALSE(m.emplace(7, 0).second);
+    EXPECT_EQ(m.size(), 1000);
+
+    for(int i = 0; i < 1000; i += 3) {
+        EXPECT_EQ(m.erase(i), 1);
+    }
+    EXPECT_EQ(m.erase(0), 0);
+
+    for(int i = 0; i < 1000; ++i) {
+        if(i % 3 == 0) {
+            EXPECT_FALSE(m.contains(i));
+        } else {
+            EXPECT_EQ(m.at(i), i * 2);
+        }
+    }
+
+    m.clear();
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.find(1), m.end());
+    m[5] = 3;
+    EXPECT_EQ(m.at(5), 3);
+}
+
+GTEST_TEST(map, sorted_vector_map) {
+    using SortedMap = message<sorted_map_field<"map", 233, string_coder, varint_coder<int>>>;
+
+    // keys "b", "a", "b", "c", where the first "b" wins as in `std::map`
+    array<byte, 32> buffer { 0xca_b, 0x0e_b, 0x05_b, 0x0a_b, 0x01_b, 0x62_b, 0x10_b, 0x02_b, 0xca_b, 0x0e_b, 0x05_b, 0x0a_b, 0x01_b, 0x61_b, 0x10_b, 0x01_b, 0xca_b, 0x0e_b, 0x05_b, 0x0a_b, 0x01_b, 0x62_b, 0x10_b, 0x05_b, 0xca_b, 0x0e_b, 0x05_b, 0x0a_b, 0x01_b, 0x63_b, 0x10_b, 0x03_b };
+
+    using StdMap = message<map_field<"map", 233, string_coder, varint_coder<int>>>;
+    auto expected = message_coder<StdMap>::decode(buffer).first;
+
+    auto [map, _] = message_coder<SortedMap>::decode(buffer);
+    ASSERT_EQ(map["map"_f].size(), 3);
+    EXPECT_TRUE(std::ranges::equal(map["map"_f], expected["map"_f], [](const auto& a, const auto& b) {
+        return a.first == b.first && a.second == b.second;
+    }));
+
+    auto r = message_coder<SortedMap>::checked_decode(buffer);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first, map);
+
+    // decoding merges into existing entries
+    message_coder<SortedMap>::decode(map, bytes(buffer).subspan(0, 8));
+    EXPECT_EQ(map["map"_f].size(), 3);
+
+    SortedMap other{{{"e", 4}, {"d", 5}}};
+    map.merge(other);
+    EXPECT_EQ(map["map"_f].begin()->first, "a");
+    EXPECT_EQ(map["map"_f].at("d"), 5);
+    EXPECT_EQ(map["map"_f].erase("a"), 1);
+    EXPECT_EQ(map["map"_f].size(), 4);
+}
@@ -20,6 +20,60 @@
 using namespace pp;
 using namespace std;
 
+namespace {
+    // a string wrapper counting its copies, to check that decoding never copies values
+    struct counted {
+        static inline size_t copies = 0;
+
+        string s;
+
+        counted() = default;
+        counted(string s) : s(std::move(s)) {}
+        counted(const counted& o) : s(o.s) { ++copies; }
+        counted(counted&&) noexcept = default;
+        counted& operator=(const counted& o) { s = o.s; ++copies; return *this; }
+        counted& operator=(counted&&) noexcept = default;
+
+        bool operator==(const counted&) const = default;
+    };
+
+    struct counted_coder {
+        using value_type = counted;
+
+        static bytes encode(const counted& v, bytes b) {
+            return string_coder::encode(v.s, b);
+        }
+
+        static decode_result<counted> decode(bytes b) {
+            auto [s, n] = string_coder::decode(b);
+            return {counted{std::move(s)}, n};
+        }
+
+        static checked_decode_result<counted> checked_decode(bytes b) {
+            auto r = string_coder::checked_decode(b);
+            if(!r) {
+                return r.error();
+            }
+
+            return decode_result<counted>{counted{std::move(r->first)}, r->second};
+        }
+    };
+}
+
+template <>
+struct pp::skipper<counted_coder> {
+    static size_t encode_skip(const counted& v) {
+        return skipper<string_coder>::encode_skip(v.s);
+    }
+
+    static bytes decode_skip(bytes b) {
+        return skipper<string_coder>::decode_skip(b);
+    }
+};
+
+template <>
+struct pp::wire_type_impl<counted_coder> : std::integral_constant<pp::uint<1>, 2> {};
+
 GTEST_TEST(message, function) {
     message<integer_field<"", 1, int>, floating_field<"", 3, float>> m{12, 1.23};
     static_assert(m.size == 2);
@@ -227,6 +281,92 @@ GTEST_TEST(message_coder, decode_with_unknown_fields) {
     }
 }
 
+GTEST_TEST(message_coder, decode_with_invalid_wire_type) {
+    {
+        array<byte, 10> a{0x80_b, 0x01_b};
+        EXPECT_EQ(begin_diff(skip_wire(0, a).value(), a), 2);
+        EXPECT_EQ(begin_diff(skip_wire(1, a).value(), a), 8);
+        EXPECT_EQ(begin_diff(skip_wire(5, a).value(), a), 4);
+        EXPECT_FALSE(skip_wire(3, a).has_value());
+        EXPECT_FALSE(skip_wire(7, a).has_value());
+    }
+
+    {
+        message<integer_field<"", 1, int>, varint_field<"", 2, int>> m;
+        array<byte, 20> a{0x0d_b, 0x0c_b, 0x00_b, 0x00_b, 0x00_b, 0x33_b, 0x01_b, 0x10_b, 0x05_b};
+        auto [v, n] = message_coder<decltype(m)>::decode(a);
+        EXPECT_EQ(begin_diff(n, a), 5);
+        EXPECT_EQ(v.get<1>(), 12);
+        EXPECT_FALSE(v.get<2>().has_value());
+    }
+}
+
+GTEST_TEST(message_coder, decode_dispatch) {
+    using M = message<varint_field<"", 1, int>, integer_field<"", 7, int, repeated>, varint_field<"", 3, int>>;
+
+    static_assert([] {
+        array<byte, 10> a{0x08_b, 0x96_b, 0x01_b, 0x18_b, 0x05_b};
+        auto [v, n] = message_coder<M>::decode(a);
+        return v.get<1>().value() == 150 && v.get<3>().value() == 5 && begin_diff(n, a) == 5;
+    }());
+
+    {
+        array<byte, 30> a{0x18_b, 0x05_b, 0x3d_b, 0x01_b, 0x00_b, 0x00_b, 0x00_b, 0x08_b, 0x96_b, 0x01_b,
+                          0x3d_b, 0x02_b, 0x00_b, 0x00_b, 0x00_b, 0x3d_b, 0x03_b, 0x00_b, 0x00_b, 0x00_b,
+                          0x18_b, 0x06_b};
+        auto [v, n] = message_coder<M>::decode(a);
+        EXPECT_EQ(begin_diff(n, a), 22);
+        EXPECT_EQ(v.get<1>(), 150);
+        EXPECT_EQ(v.get_base<7>(), (vector{1, 2, 3}));
+        EXPECT_EQ(v.get<3>(), 6);
+    }
+}
+
+GTEST_TEST(message_coder, checked_decode) {
+    using Student = message<uint32_field<"id", 1>, string_field<"name", 3>>;
+    using Class = message<string_field<"name", 8>, message_field<"students", 3, Student, repeated>>;
+
+    Student twice {123, "twice"}, tom{456, "tom"}, jerry{123456, "jerry"};
+    Class myClass {"class 101", {tom, jerry, twice}};
+
+    array<byte, 64> buffer{};
+    auto end = message_coder<Class>::encode(myClass, buffer);
+    auto len = begin_diff(end, buffer);
+
+    {
+        auto r = message_coder<Class>::checked_decode(buffer);
+        ASSERT_TRUE(r);
+        EXPECT_EQ(r->first, myClass);
+        EXPECT_EQ(begin_diff(r->second, buffer), len);
+    }
+
+    for(size_t i = 1; i < len; ++i) {
+        auto r = message_coder<Class>::checked_decode(bytes{buffer}.subspan(0, i));
+        EXPECT_TRUE(!r || r->first != myClass);
+    }
+
+    {
+        array<byte, 10> a{0x1a_b, 0x08_b, 0x08_b, 0x96_b, 0x01_b};
+        auto r = message_coder<Class>::checked_decode(bytes{a}.subspan(0, 5));
+        ASSERT_FALSE(r);
+        EXPECT_EQ(r.error(), decode_error::length_overflow);
+    }
+
+    {
+        array<byte, 10> a{0x1a_b, 0x03_b, 0x08_b, 0x96_b, 0x81_b};
+        auto r = message_coder<Class>::checked_decode(bytes{a}.subspan(0, 5));
+        ASSERT_FALSE(r);
+        EXPECT_EQ(r.error(), decode_error::truncated);
+    }
+
+    {
+        array<byte, 10> a{0x1a_b, 0x02_b, 0x0b_b, 0x01_b, 0x42_b, 0x00_b};
+        auto r = message_coder<Class>::checked_decode(a);
+        ASSERT_FALSE(r);
+        EXPECT_EQ(r.error(), decode_error::bad_wire_type);
+    }
+}
+
 GTEST_TEST(message_coder, nested_encode) {
     {
         message<varint_field<"", 1, int>> m{150};
@@ -319,6 +459,91 @@ GTEST_TEST(message_coder, nested_encode) {
     }
 }
 
+GTEST_TEST(message_coder, packed) {
+    using M = message<int32_field<"a", 4, packed>, fixed32_field<"b", 5, packed>, float_field<"c", 6, repeated>, bool_field<"d", 7, packed>>;
+
+    M m{vector{3, 270, 86942}, vector<pp::uint<4>>{1, 2}, vector{1.5f, -2.f}, vector{true, false}};
+
+    array<byte, 40> a{};
+    auto n = message_coder<M>::encode(m, a);
+    EXPECT_EQ(begin_diff(n, a), 32);
+    EXPECT_EQ(begin_diff(n, a), skipper<message_coder<M>>::encode_skip(m));
+    EXPECT_EQ(a, (array<byte, 40>{0x22_b, 0x06_b, 0x03_b, 0x8e_b, 0x02_b, 0x9e_b, 0xa7_b, 0x05_b,
+                                  0x2a_b, 0x08_b, 0x01_b, 0x00_b, 0x00_b, 0x00_b, 0x02_b, 0x00_b, 0x00_b, 0x00_b,
+                                  0x35_b, 0x00_b, 0x00_b, 0xc0_b, 0x3f_b, 0x35_b, 0x00_b, 0x00_b, 0x00_b, 0xc0_b,
+                                  0x3a_b, 0x02_b, 0x01_b, 0x00_b}));
+
+    auto [v, _] = message_coder<M>::decode(a);
+    EXPECT_EQ(v, m);
+
+    auto r = message_coder<M>::checked_decode(bytes{a}.subspan(0, 32));
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first, m);
+
+    size_cache cache;
+    skipper<message_coder<M>>::encode_skip(m, cache);
+    array<byte, 40> c{};
+    message_coder<M>::encode(m, c, cache);
+    EXPECT_EQ(c, a);
+
+    auto e = message_coder<M>::checked_decode(bytes{a}.subspan(0, 14));
+    ASSERT_FALSE(e);
+    EXPECT_EQ(e.error(), decode_error::length_overflow);
+}
+
+GTEST_TEST(message_coder, decode_packed_and_unpacked) {
+    using M = message<int32_field<"a", 4, repeated>, fixed32_field<"b", 5, packed>>;
+
+    array<byte, 40> a{0x20_b, 0x01_b, 0x22_b, 0x02_b, 0x02_b, 0x03_b, 0x20_b, 0x04_b,
+                      0x2d_b, 0x07_b, 0x00_b, 0x00_b, 0x00_b, 0x2a_b, 0x04_b, 0x08_b, 0x00_b, 0x00_b, 0x00_b,
+                      0x2d_b, 0x09_b, 0x00_b, 0x00_b, 0x00_b};
+    auto [v, n] = message_coder<M>::decode(a);
+    EXPECT_EQ(begin_diff(n, a), 24);
+    EXPECT_EQ(v["a"_f], (vector{1, 2, 3, 4}));
+    EXPECT_EQ(v["b"_f], (vector<pp::uint<4>>{7, 8, 9}));
+
+    auto r = message_coder<M>::checked_decode(a);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first, v);
+
+    array<byte, 40> b{};
+    message_coder<M>::encode(v, b);
+    EXPECT_EQ(b, (array<byte, 40>{0x20_b, 0x01_b, 0x20_b, 0x02_b, 0x20_b, 0x03_b, 0x20_b, 0x04_b,
+                                  0x2a_b, 0x0c_b, 0x07_b, 0x00_b, 0x00_b, 0x00_b, 0x08_b, 0x00_b, 0x00_b, 0x00_b,
+                                  0x09_b, 0x00_b, 0x00_b, 0x00_b}));
+}
+
+GTEST_TEST(message_coder, cached_encode) {
+    using Leaf = message<varint_field<"", 1, int>, string_field<"", 2>, array_field<"", 3, varint_coder<int>>>;
+    using Middle = message<message_field<"", 1, Leaf, repeated>, message_field<"", 2, Leaf>>;
+    using Root = message<message_field<"", 4, Middle>, string_field<"", 5>, message_field<"", 6, Middle, repeated>>;
+
+    Leaf a{150, "alice", vector{1, 300, 70000}}, b{22, "bob", {}};
+    Middle m1{{a, b, a}, b}, m2{{}, a};
+    Root r{m1, "root", {m2, m1}};
+
+    array<byte, 256> expected{}, actual{};
+    auto expected_end = message_coder<Root>::encode(r, expected);
+
+    size_cache cache;
+    auto n = skipper<message_coder<Root>>::encode_skip(r, cache);
+    EXPECT_EQ(n, skipper<message_coder<Root>>::encode_skip(r));
+    EXPECT_EQ(n, begin_diff(expected_end, expected));
+
+    auto actual_end = message_coder<Root>::encode(r, actual, cache);
+    EXPECT_EQ(begin_diff(actual_end, actual), n);
+    EXPECT_EQ(actual, expected);
+
+    cache.clear();
+    skipper<message_coder<Root>>::encode_skip(r, cache);
+    actual = {};
+    message_coder<Root>::encode(r, actual, cache);
+    EXPECT_EQ(actual, expected);
+
+    auto [v, _] = message_coder<Root>::decode(actual);
+    EXPECT_EQ(v, r);
+}
+
 GTEST_TEST(message_coder, nested_decode) {
     {
         message<varint_field<"", 1, int>> m;
@@ -427,3 +652,329 @@ GTEST_TEST(message, merge) {
     EXPECT_EQ(merged["titles"_f], (vector<string>{"b", "c", "d", "f"}));
     EXPECT_EQ(merged["age"_f], 124);
 }
+
+GTEST_TEST(message_coder, memory_resource) {
+    using Student = message<uint32_field<"id", 1>, pmr_string_field<"name", 3>>;
+    using Class = message<pmr_string_field<"name", 8>, pmr_message_field<"students", 3, Student, repeated>,
+                          uint32_field<"ids", 4, packed, std::pmr::vector<pp::uint<4>>>>;
+
+    Class c;
+    c["name"_f] = "a class name longer than any small string buffer";
+    c["students"_f].push_back(Student{123, "tom, whose name is also longer than a small string"});
+    c["students"_f].push_back(Student{456, "jerry, whose name is also longer than a small string"});
+    c["ids"_f] = {1, 2, 3};
+
+    array<byte, 256> a{};
+    auto end = message_coder<Class>::encode(c, a);
+    auto b = bytes(a).subspan(0, begin_diff(end, a));
+
+    array<byte, 4096> storage{};
+    std::pmr::monotonic_buffer_resource arena(storage.data(), storage.size(), std::pmr::null_memory_resource());
+
+    // every allocation must come from the arena, or the null default resource throws
+    auto origin = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+    auto [v, n] = message_coder<Class>::decode(b, &arena);
+    auto r = message_coder<Class>::checked_decode(b, &arena);
+    std::pmr::set_default_resource(origin);
+
+    EXPECT_EQ(v, c);
+    EXPECT_TRUE(n.empty());
+    EXPECT_EQ(v["name"_f]->get_allocator().resource(), &arena);
+    EXPECT_EQ(v["students"_f].get_allocator().resource(), &arena);
+    EXPECT_EQ(v["students"_f][0]["name"_f]->get_allocator().resource(), &arena);
+    EXPECT_EQ(v["ids"_f].get_allocator().resource(), &arena);
+
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first, c);
+    EXPECT_EQ(r->first["students"_f][1]["name"_f]->get_allocator().resource(), &arena);
+}
+
+GTEST_TEST(message_coder, decode_without_copies) {
+    using Leaf = message<field<"s", 1, counted_coder>, field<"r", 2, counted_coder, repeated>>;
+    using Middle = message<message_field<"leaf", 1, Leaf>, message_field<"leaves", 2, Leaf, repeated>>;
+    using Root = message<message_field<"middle", 1, Middle>, message_field<"middles", 2, Middle, repeated>>;
+
+    Leaf l{counted{"a"}, vector<counted>{counted{"b"}, counted{"c"}}};
+    Middle m{l, vector<Leaf>{l, l}};
+    Root r{m, vector<Middle>{m, m}};
+
+    array<byte, 256> a{};
+    message_coder<Root>::encode(r, a);
+
+    counted::copies = 0;
+    auto [v, n] = message_coder<Root>::decode(a);
+    auto cv = message_coder<Root>::checked_decode(a);
+    EXPECT_EQ(counted::copies, 0);
+
+    EXPECT_EQ(v, r);
+    ASSERT_TRUE(cv);
+    EXPECT_EQ(cv->first, r);
+}
+
+GTEST_TEST(message_coder, decode_into) {
+    using Student = message<uint32_field<"id", 1>, string_field<"name", 3>, uint32_field<"scores", 4, repeated>>;
+
+    array<byte, 64> a{};
+    auto end = message_coder<Student>::encode(Student{123, "tom", vector<pp::uint<4>>{1, 2}}, a);
+    auto b = bytes(a).subspan(0, begin_diff(end, a));
+
+    Student s{456, "jerry", vector<pp::uint<4>>{9}};
+    EXPECT_TRUE(message_coder<Student>::decode(s, b).empty());
+    EXPECT_EQ(s, (Student{123, "tom", vector<pp::uint<4>>{9, 1, 2}}));
+
+    auto r = message_coder<Student>::checked_decode(s, b);
+    ASSERT_TRUE(r);
+    EXPECT_TRUE(r->empty());
+    EXPECT_EQ(s["scores"_f], (vector<pp::uint<4>>{9, 1, 2, 1, 2}));
+
+    EXPECT_FALSE(message_coder<Student>::checked_decode(s, b.subspan(0, b.size() - 1)));
+}
+
+GTEST_TEST(message, clear) {
+    using Student = message<uint32_field<"id", 1>, string_field<"name", 3>, uint32_field<"scores", 4, repeated>>;
+
+    Student s{123, "tom", vector<pp::uint<4>>{1, 2, 3}};
+    auto capacity = s["scores"_f].capacity();
+
+    s.clear();
+    EXPECT_EQ(s, Student{});
+    EXPECT_EQ(s["scores"_f].capacity(), capacity);
+}
+
+GTEST_TEST(message_coder, decode_reuse) {
+    using Student = message<uint32_field<"id", 1>, string_field<"name", 3>, uint32_field<"scores", 4, repeated>>;
+    using Class = message<string_field<"name", 8>, message_field<"students", 3, Student, repeated>,
+                          message_field<"monitor", 5, Student>, int32_field<"ids", 6, packed>>;
+
+    auto encode = [](const Class& c) {
+        vector<byte> res(skipper<message_coder<Class>>::encode_skip(c));
+        message_coder<Class>::encode(c, res);
+        return res;
+    };
+
+    string long_name(100, 'x');
+    Class c1{"class 101 with a name longer than the small buffer",
+             vector<Student>{Student{1, long_name, vector<pp::uint<4>>{1, 2, 3}}, Student{2, long_name, {}}, Student{3, "x", {}}},
+             Student{4, long_name, vector<pp::uint<4>>{4}}, vector<sint<4>>{-1, 2, -3}};
+    Class c2{"short", vector<Student>{Student{5, "y", vector<pp::uint<4>>{5}}}, {}, vector<sint<4>>{7}};
+    Class c3{{}, {}, Student{6, {}, {}}, {}};
+
+    auto e1 = encode(c1), e2 = encode(c2), e3 = encode(c3);
+
+    Class v;
+    EXPECT_TRUE(message_coder<Class>::decode_reuse(v, e1).empty());
+    EXPECT_EQ(v, c1);
+
+    // decoding the same shape again reuses all storage
+    auto name = v["name"_f]->data();
+    auto students = v["students"_f].data();
+    auto student_name = v["students"_f][0]["name"_f]->data();
+    auto monitor_name = v["monitor"_f]->get<"name">()->data();
+    auto ids = v["ids"_f].data();
+
+    EXPECT_TRUE(message_coder<Class>::decode_reuse(v, e1).empty());
+    EXPECT_EQ(v, c1);
+    EXPECT_EQ(v["name"_f]->data(), name);
+    EXPECT_EQ(v["students"_f].data(), students);
+    EXPECT_EQ(v["students"_f][0]["name"_f]->data(), student_name);
+    EXPECT_EQ(v["monitor"_f]->get<"name">()->data(), monitor_name);
+    EXPECT_EQ(v["ids"_f].data(), ids);
+
+    // other shapes remove stale values
+    EXPECT_TRUE(message_coder<Class>::decode_reuse(v, e2).empty());
+    EXPECT_EQ(v, c2);
+    EXPECT_EQ(v["students"_f].data(), students);
+
+    auto r = message_coder<Class>::checked_decode_reuse(v, e3);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(v, c3);
+
+    r = message_coder<Class>::checked_decode_reuse(v, e1);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(v, c1);
+
+    EXPECT_FALSE(message_coder<Class>::checked_decode_reuse(v, bytes(e1).subspan(0, e1.size() - 1)));
+}
+
+GTEST_TEST(message_coder, decode_only) {
+    using Student = message<uint32_field<"id", 1>, string_field<"name", 3>, uint32_field<"scores", 4, repeated>,
+                            message_field<"friend", 5, message<string_field<"name", 1>>>, float_field<"height", 6>>;
+
+    Student s{123, "tom", vector<pp::uint<4>>{1, 2, 3}, message<string_field<"name", 1>>{"jerry"}, 1.5f};
+
+    array<byte, 64> a{};
+    auto end = message_coder<Student>::encode(s, a);
+    auto b = bytes(a).subspan(0, begin_diff(end, a));
+
+    static_assert(field_selector_number<Student, "name"_f> == 3);
+    static_assert(field_selector_number<Student, 5_i> == 5);
+
+    {
+        // all selected fields are singular: stops right after "name"
+        auto [v, n] = message_coder<Student>::decode_only<"id"_f, 3_i>(b);
+        EXPECT_EQ(v, (Student{123, "tom", {}, {}, {}}));
+        EXPECT_EQ(begin_diff(n, b), 7);
+    }
+
+    {
+        auto [v, n] = message_coder<Student>::decode_only<"scores"_f, "height"_f>(b);
+        EXPECT_EQ(v, (Student{{}, {}, vector<pp::uint<4>>{1, 2, 3}, {}, 1.5f}));
+        EXPECT_TRUE(n.empty());
+    }
+
+    {
+        auto r = message_coder<Student>::checked_decode_only<"friend"_f>(b);
+        ASSERT_TRUE(r);
+        EXPECT_EQ(r->first["friend"_f]->get<"name">(), "jerry");
+        EXPECT_FALSE(r->first["id"_f]);
+        EXPECT_EQ(begin_diff(r->second, b), begin_diff(end, a) - 5);
+
+        // skipped fields are still bounds-checked
+        EXPECT_FALSE(message_coder<Student>::checked_decode_only<"height"_f>(b.subspan(0, 5)));
+    }
+}
+
+GTEST_TEST(message_coder, unknown_fields) {
+    using Student = message<uint32_field<"id", 1>, string_field<"name", 2>, uint32_field<"scores", 3, repeated>>;
+    using OldStudent = message<uint32_field<"id", 1>, unknown_fields<>>;
+
+    static_assert(is_unknown_fields<OldStudent::get_type_by_name<"unknown">>);
+
+    Student s{123, "tom", vector<pp::uint<4>>{1, 2}};
+
+    array<byte, 64> a{};
+    auto end = message_coder<Student>::encode(s, a);
+    auto b = bytes(a).subspan(0, begin_diff(end, a));
+
+    auto [v, n] = message_coder<OldStudent>::decode(b);
+    EXPECT_TRUE(n.empty());
+    EXPECT_EQ(v["id"_f], 123);
+
+    // consecutive unknown fields are coalesced into one view of the input
+    ASSERT_EQ(v["unknown"_f].size(), 1);
+    EXPECT_EQ(v["unknown"_f].begin()->data(), b.data() + 2);
+    EXPECT_EQ(v["unknown"_f].byte_size(), b.size() - 2);
+
+    // unknown fields are re-emitted verbatim
+    array<byte, 64> c{};
+    EXPECT_EQ(skipper<message_coder<OldStudent>>::encode_skip(v), b.size());
+    auto cend = message_coder<OldStudent>::encode(v, c);
+    EXPECT_TRUE(std::ranges::equal(bytes(c).subspan(0, begin_diff(cend, c)), b));
+
+    v["id"_f] = 124;
+    s["id"_f] = 124;
+    cend = message_coder<OldStudent>::encode(v, c);
+    EXPECT_EQ(message_coder<Student>::decode(bytes(c).subspan(0, begin_diff(cend, c))).first, s);
+
+    {
+        auto r = message_coder<OldStudent>::checked_decode(b);
+        ASSERT_TRUE(r);
+        EXPECT_EQ(r->first["unknown"_f], v["unknown"_f]);
+        EXPECT_FALSE(message_coder<OldStudent>::checked_decode(b.subspan(0, b.size() - 1)));
+    }
+
+    {
+        // owned records no longer refer to the input, and survive copies
+        auto w = v;
+        w["unknown"_f].own();
+        EXPECT_NE(w["unknown"_f].begin()->data(), b.data() + 2);
+        EXPECT_EQ(w, v);
+
+        auto x = w;
+        w.clear();
+        EXPECT_TRUE(w["unknown"_f].empty());
+        EXPECT_EQ(x, v);
+
+        vector<byte> out;
+        vector_sink sk(out);
+        EXPECT_EQ(message_coder<OldStudent>::encode(x, sk), cend.data() - c.data());
+    }
+
+    {
+        // unknown fields are overwritten while decoding in reuse mode
+        OldStudent r = v;
+        message_coder<OldStudent>::decode_reuse(r, b.subspan(0, 2));
+        EXPECT_TRUE(r["unknown"_f].empty());
+
+        message_coder<OldStudent>::decode_reuse(r, b);
+        EXPECT_EQ(r["unknown"_f].byte_size(), b.size() - 2);
+        message_coder<OldStudent>::decode_reuse(r, b);
+        EXPECT_EQ(r["unknown"_f].byte_size(), b.size() - 2);
+    }
+}
+
+GTEST_TEST(message_coder, oneof) {
+    using Pet = message<string_field<"name", 1>>;
+    using Choice = oneof_field<"choice", string_field<"text", 2>, uint32_field<"id", 3>, message_field<"pet", 4, Pet>>;
+    using Owner = message<uint32_field<"age", 1>, Choice, float_field<"score", 5>>;
+
+    static_assert(std::same_as<Owner::get_type_by_number<3>, Choice>);
+    static_assert(std::same_as<Owner::get_type_by_name<"choice">, Choice>);
+    static_assert(Choice::index_of_name<"pet"> == 3);
+    static_assert(sizeof(Choice) < sizeof(optional<string>) + sizeof(optional<pp::uint<4>>) + sizeof(optional<Pet>));
+
+    Owner o{10, Choice{}, 1.5f};
+    EXPECT_FALSE(o["choice"_f].has_value());
+    EXPECT_EQ(o["choice"_f].active_number(), 0);
+
+    o["choice"_f].emplace<"id">(7u);
+    EXPECT_TRUE(o[3_i].holds<"id">());
+    EXPECT_EQ(o["choice"_f].get<3>(), 7);
+
+    array<byte, 64> a{};
+    auto end = message_coder<Owner>::encode(o, a);
+    auto b = bytes(a).subspan(0, begin_diff(end, a));
+
+    // only the alternative which is set is encoded
+    EXPECT_EQ(b.size(), skipper<message_coder<Owner>>::encode_skip(o));
+    EXPECT_EQ(b.size(), 2 + 2 + 5);
+    EXPECT_EQ(message_coder<Owner>::decode(b).first, o);
+
+    o["choice"_f].emplace<"pet">(Pet{"kitty"});
+    end = message_coder<Owner>::encode(o, a);
+    b = bytes(a).subspan(0, begin_diff(end, a));
+
+    auto r = message_coder<Owner>::checked_decode(b);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first["choice"_f].active_number(), 4);
+    EXPECT_EQ(r->first["choice"_f].get_if<"pet">()->get<"name">(), "kitty");
+    EXPECT_EQ(r->first["choice"_f].get_if<"text">(), nullptr);
+
+    // the last alternative wins
+    using Both = message<uint32_field<"id", 3>, string_field<"text", 2>>;
+    Both both{7, "hello"};
+    end = message_coder<Both>::encode(both, a);
+    b = bytes(a).subspan(0, begin_diff(end, a));
+
+    auto [v, n] = message_coder<Owner>::decode(b);
+    EXPECT_EQ(v["choice"_f].get<"text">(), "hello");
+
+    // storage of the same alternative is reused, and the group is reset while absent
+    message_coder<Owner>::decode_reuse(v, b);
+    EXPECT_TRUE(v["choice"_f].holds<2>());
+    message_coder<Owner>::decode_reuse(v, b.subspan(0, 0));
+    EXPECT_FALSE(v["choice"_f].has_value());
+
+    v.merge(r->first);
+    EXPECT_TRUE(v["choice"_f].holds<"pet">());
+    v.clear();
+    EXPECT_FALSE(v["choice"_f].has_value());
+}
+
+GTEST_TEST(message_coder, constant_encode) {
+    using Config = message<uint32_field<"id", 1>, sint64_field<"offset", 2>, float_field<"ratio", 3>,
+        double_field<"scale", 4>, bool_field<"enabled", 5>, string_field<"name", 6>, uint32_field<"ports", 7, repeated>>;
+
+    constexpr auto& blob = constant_encode<[] { return Config{150, sint_zigzag<8>(-3), 1.5f, 0.25, true, "cfg", {80, 443}}; }>;
+
+    Config c{150, sint_zigzag<8>(-3), 1.5f, 0.25, true, "cfg", {80, 443}};
+    vector<byte> expected(skipper<message_coder<Config>>::encode_skip(c));
+    message_coder<Config>::encode(c, expected);
+
+    static_assert(blob.size() == 3 + 2 + 5 + 9 + 2 + 5 + 2 + 3);
+    EXPECT_TRUE(equal(blob.begin(), blob.end(), expected.begin(), expected.end()));
+    auto copy = blob;
+    EXPECT_EQ(message_coder<Config>::decode(copy).first, c);
+
+    static_assert(constant_encode<[] { return Config{}; }>.empty());
+}
@@ -0,0 +1,144 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <protopuf/parallel.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+using namespace pp;
+using namespace std;
+
+namespace {
+    using Entry = message<uint32_field<"id", 1>, string_field<"name", 2>, int32_field<"scores", 3, packed>>;
+    using Snapshot = message<
+        string_field<"name", 1>,
+        message_field<"entries", 2, Entry, repeated>,
+        uint64_field<"version", 3>,
+        string_field<"labels", 4, repeated>
+    >;
+
+    Snapshot make_snapshot(size_t n) {
+        Snapshot s;
+        s["name"_f] = "snapshot";
+        s["version"_f] = 42;
+
+        for(size_t i = 0; i < n; ++i) {
+            s["entries"_f].push_back(Entry{uint32_t(i), "entry #" + to_string(i), {int32_t(i), -1, 2}});
+            s["labels"_f].push_back("label " + to_string(i % 7));
+        }
+
+        return s;
+    }
+
+    vector<byte> serial_encode(const Snapshot& s) {
+        vector<byte> res(skipper<message_coder<Snapshot>>::encode_skip(s));
+        message_coder<Snapshot>::encode(s, res);
+
+        return res;
+    }
+}
+
+GTEST_TEST(parallel_coder, encode) {
+    thread_executor exec(4);
+
+    for(size_t n : {0, 1, 100, 1000}) {
+        auto s = make_snapshot(n);
+        auto expected = serial_encode(s);
+
+        EXPECT_EQ(parallel_coder<Snapshot>::encode(s, exec, 64), expected);
+        EXPECT_EQ(parallel_coder<Snapshot>::encode(s, exec, 1), expected);
+
+        vector<byte> buf(expected.size() + 3);
+        auto rest = parallel_coder<Snapshot>::encode(s, buf, exec, 7);
+        EXPECT_EQ(rest.size(), 3);
+        EXPECT_TRUE(equal(expected.begin(), expected.end(), buf.begin()));
+    }
+
+    inline_executor serial;
+    auto s = make_snapshot(10);
+    EXPECT_EQ(parallel_coder<Snapshot>::encode(s, serial), serial_encode(s));
+}
+
+GTEST_TEST(parallel_coder, decode) {
+    thread_executor exec(4);
+
+    for(size_t n : {0, 1, 100, 1000}) {
+        auto s = make_snapshot(n);
+        auto buf = serial_encode(s);
+
+        auto [v, rest] = parallel_coder<Snapshot>::decode(buf, exec, 16);
+        EXPECT_EQ(v, s);
+        EXPECT_TRUE(rest.empty());
+
+        auto r = parallel_coder<Snapshot>::checked_decode(buf, exec, 16);
+        ASSERT_TRUE(r);
+        EXPECT_EQ(r->first, s);
+    }
+
+    // elements of a repeated field interleaved with other fields keep their order
+    Entry a{1, "a", {}}, b{2, "b", {}};
+    vector<byte> buf(64);
+    auto out = embedded_message_coder<Entry>::encode(a, varint_coder<pp::uint<4>>::encode(Snapshot::get_type_by_number<2>::key, buf));
+    out = string_coder::encode("x", varint_coder<pp::uint<4>>::encode(Snapshot::get_type_by_number<1>::key, out));
+    out = embedded_message_coder<Entry>::encode(b, varint_coder<pp::uint<4>>::encode(Snapshot::get_type_by_number<2>::key, out));
+    buf.resize(buf.size() - out.size());
+
+    auto [v, _] = parallel_coder<Snapshot>::decode(buf, exec, 1);
+    EXPECT_EQ(v, message_coder<Snapshot>::decode(buf).first);
+    EXPECT_EQ(v["entries"_f], (vector<Entry>{a, b}));
+}
+
+GTEST_TEST(parallel_coder, checked_decode) {
+    thread_executor exec(4);
+
+    auto buf = serial_encode(make_snapshot(100));
+
+    auto r = parallel_coder<Snapshot>::checked_decode(bytes(buf.data(), buf.size() - 1), exec, 16);
+    ASSERT_FALSE(r);
+
+    // a malformed element inside an intact record of the repeated field
+    auto s = make_snapshot(100);
+    auto good = serial_encode(s);
+    auto bad = good;
+    // the first entry starts after the name field: key, length, 8 bytes, then the entry key, length and its first key
+    bad[1 + 1 + 8 + 1 + 1] = byte{0x0f};
+
+    auto e = parallel_coder<Snapshot>::checked_decode(bad, exec, 16);
+    ASSERT_FALSE(e);
+    EXPECT_EQ(e.error(), decode_error::bad_wire_type);
+}
+
+GTEST_TEST(thread_executor, exception) {
+    thread_executor exec(4);
+
+    atomic<size_t> calls = 0;
+    EXPECT_THROW(exec(1000000, [&](size_t i) {
+        ++calls;
+        if(i == 10) {
+            throw runtime_error("task failed");
+        }
+    }), runtime_error);
+
+    // remaining tasks are not started once a task throws
+    EXPECT_LT(calls.load(), 1000000u);
+
+    // the executor is still usable afterwards
+    atomic<size_t> sum = 0;
+    exec(100, [&](size_t i) { sum += i; });
+    EXPECT_EQ(sum.load(), 4950u);
+}
@@ -0,0 +1,85 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <protopuf/patch.h>
+#include <array>
+
+using namespace pp;
+using namespace std;
+
+namespace {
+    using Tag = message<string_field<"key", 1>, fixed64_field<"time", 2>>;
+    using Metric = message<string_field<"name", 1>, fixed64_field<"time", 2>, sfixed32_field<"count", 3>,
+                           uint32_field<"value", 4>, message_field<"tag", 5, Tag>, double_field<"ratio", 6>>;
+}
+
+GTEST_TEST(patch, fixed) {
+    Metric m{"cpu", 1000, -1, 100, Tag{"host", 7}, 0.5};
+
+    array<byte, 64> a{};
+    auto b = bytes(a).subspan(0, begin_diff(message_coder<Metric>::encode(m, a), a));
+
+    auto r = patch_field<Metric, "time"_f>(b, 123456789);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->found, 1);
+    EXPECT_TRUE(r->patched);
+
+    ASSERT_TRUE((patch_field<Metric, 3_i>(b, 42)));
+    ASSERT_TRUE((patch_field<Metric, "ratio"_f>(b, 0.25)));
+
+    // the field of the embedded message with the same number is untouched
+    m["time"_f] = 123456789;
+    m["count"_f] = 42;
+    m["ratio"_f] = 0.25;
+    EXPECT_EQ(message_coder<Metric>::decode(b).first, m);
+}
+
+GTEST_TEST(patch, varint) {
+    Metric m{"cpu", 1000, -1, 100, {}, {}};
+
+    array<byte, 64> a{};
+    auto b = bytes(a).subspan(0, begin_diff(message_coder<Metric>::encode(m, a), a));
+
+    auto r = patch_field<Metric, "value"_f>(b, 127);
+    ASSERT_TRUE(r);
+    EXPECT_TRUE(r->patched);
+
+    // 128 is encoded in 2 bytes instead of 1
+    r = patch_field<Metric, "value"_f>(b, 128);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->found, 1);
+    EXPECT_FALSE(r->patched);
+
+    m["value"_f] = 127;
+    EXPECT_EQ(message_coder<Metric>::decode(b).first, m);
+
+    // absent fields are not found
+    r = patch_field<Metric, "ratio"_f>(b, 1.0);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->found, 0);
+    EXPECT_FALSE(r->patched);
+}
+
+GTEST_TEST(patch, malformed) {
+    Metric m{"cpu", 1000, -1, 100, {}, {}};
+
+    array<byte, 64> a{};
+    auto b = bytes(a).subspan(0, begin_diff(message_coder<Metric>::encode(m, a), a));
+
+    // nothing is written if the message is truncated after the patched field
+    EXPECT_FALSE((patch_field<Metric, "time"_f>(b.subspan(0, b.size() - 1), 1)));
+    EXPECT_EQ(message_coder<Metric>::decode(b).first, m);
+}
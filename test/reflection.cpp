@@ -98,3 +98,30 @@ GTEST_TEST(reflection, dynamic_visit_by_name) {
     EXPECT_EQ(myMsg["str"_f], "helloo");
     EXPECT_EQ(myMsg["int"_f], 1233);
 }
+
+GTEST_TEST(reflection, dynamic_lookup) {
+    using Dense = message<int32_field<"a", 1>, int32_field<"bb", 2>, int32_field<"ccc", 5>, string_field<"d", 20>>;
+    using Sparse = message<int32_field<"x", 1>, int32_field<"y", 100000>, string_field<"z", 7>>;
+
+    using DenseNumbers = dynamic_lookup<field_number, int32_field<"a", 1>, int32_field<"bb", 2>, int32_field<"ccc", 5>, string_field<"d", 20>>;
+    using SparseNumbers = dynamic_lookup<field_number, int32_field<"x", 1>, int32_field<"y", 100000>, string_field<"z", 7>>;
+    using Names = dynamic_lookup<field_name, int32_field<"a", 1>, int32_field<"bb", 2>, int32_field<"ccc", 5>, string_field<"d", 20>>;
+
+    static_assert(DenseNumbers::dense && !SparseNumbers::dense);
+    static_assert(DenseNumbers::find(5) == 2 && DenseNumbers::find(3) == DenseNumbers::npos && DenseNumbers::find(1000) == DenseNumbers::npos);
+    static_assert(SparseNumbers::find(100000) == 1 && SparseNumbers::find(7) == 2 && SparseNumbers::find(8) == SparseNumbers::npos);
+    static_assert(Names::find("a") == 0 && Names::find("ccc") == 2 && Names::find("d") == 3);
+    static_assert(Names::find("") == Names::npos && Names::find("cc") == Names::npos && Names::find("dd") == Names::npos);
+
+    Dense dense{1, 2, 3, "four"};
+    EXPECT_EQ(dynamic_visit_by_number([](const auto& x) { return x.number; }, dense, 20), 20);
+    EXPECT_EQ(dynamic_visit_by_name([](const auto& x) { return x.number; }, dense, "ccc"), 5);
+    EXPECT_FALSE(dynamic_visit_by_name([](const auto& x) { return x.number; }, dense, "e"));
+
+    Sparse sparse{1, 2, "three"};
+    EXPECT_TRUE(dynamic_visit_by_number(overloaded{[](auto&&) { FAIL(); }, [](Sparse::get_type_by_number<100000>& x) {
+        x.value() = 42;
+    }}, sparse, 100000));
+    EXPECT_EQ(sparse["y"_f], 42);
+    EXPECT_FALSE(dynamic_visit_by_number([](auto&&) {}, sparse, 99999));
+}
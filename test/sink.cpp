@@ -0,0 +1,125 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <protopuf/message.h>
+#include <array>
+#include <stdexcept>
+
+using namespace pp;
+using namespace std;
+
+namespace {
+    using Student = message<uint32_field<"id", 1>, string_field<"name", 3>>;
+    using Class = message<string_field<"name", 8>, message_field<"students", 3, Student, repeated>>;
+
+    Class make_class() {
+        return Class{"class 101", {Student{123, "tom"}, Student{456, "jerry"}, Student{789, string(300, 'x')}}};
+    }
+
+    vector<byte> encode_span(const Class& c) {
+        vector<byte> res(skipper<message_coder<Class>>::encode_skip(c));
+        message_coder<Class>::encode(c, res);
+        return res;
+    }
+}
+
+GTEST_TEST(vector_sink, encode) {
+    static_assert(sink<vector_sink>);
+
+    auto c = make_class();
+    auto e = encode_span(c);
+
+    vector<byte> v{1_b, 2_b};
+    {
+        vector_sink s(v);
+        EXPECT_EQ(message_coder<Class>::encode(c, s), e.size());
+        EXPECT_EQ(s.size(), e.size() + 2);
+    }
+
+    ASSERT_EQ(v.size(), e.size() + 2);
+    EXPECT_EQ(v[0], 1_b);
+    EXPECT_TRUE(equal(e.begin(), e.end(), v.begin() + 2));
+
+    EXPECT_EQ(message_coder<Class>::decode(bytes(v).subspan(2)).first, c);
+}
+
+GTEST_TEST(chunked_sink, encode) {
+    static_assert(sink<chunked_sink>);
+
+    auto c = make_class();
+    auto e = encode_span(c);
+
+    chunked_sink s(16);
+    EXPECT_EQ(message_coder<Class>::encode(c, s), e.size());
+    EXPECT_EQ(s.size(), e.size());
+    EXPECT_GT(s.chunks().size(), 1);
+    EXPECT_EQ(s.to_vector(), e);
+
+    size_t n = 0;
+    for(auto chunk : s.chunks()) {
+        EXPECT_TRUE(equal(chunk.begin(), chunk.end(), e.begin() + n));
+        n += chunk.size();
+    }
+    EXPECT_EQ(n, e.size());
+}
+
+GTEST_TEST(callback_sink, encode) {
+    auto c = make_class();
+    auto e = encode_span(c);
+
+    vector<byte> out;
+    size_t calls = 0;
+    callback_sink s([&](const_bytes b) {
+        out.insert(out.end(), b.begin(), b.end());
+        ++calls;
+    }, 32);
+    static_assert(sink<decltype(s)>);
+
+    EXPECT_EQ(message_coder<Class>::encode(c, s), e.size());
+    s.flush();
+
+    EXPECT_EQ(out, e);
+    EXPECT_GT(calls, 1);
+
+    // staged bytes are flushed while the sink is destroyed
+    out.clear();
+    {
+        callback_sink d([&](const_bytes b) { out.insert(out.end(), b.begin(), b.end()); }, 1024);
+        message_coder<Class>::encode(c, d);
+        EXPECT_TRUE(out.empty());
+    }
+    EXPECT_EQ(out, e);
+}
+
+GTEST_TEST(callback_sink, throwing_writer) {
+    auto c = make_class();
+
+    size_t calls = 0;
+    {
+        callback_sink s([&](const_bytes) {
+            ++calls;
+            throw runtime_error("disk full");
+        }, 1024);
+
+        message_coder<Class>::encode(c, s);
+        EXPECT_THROW(s.flush(), runtime_error);
+        EXPECT_EQ(calls, 1u);
+
+        // the staged bytes are discarded by the failed flush, and an error in the destructor is dropped
+        message_coder<Class>::encode(c, s);
+    }
+    EXPECT_EQ(calls, 2u);
+}
@@ -101,3 +101,26 @@ GTEST_TEST(skipper, decode) {
         EXPECT_EQ(begin_diff(skipper<string_coder>::decode_skip(a), a), 2 + 128);
     }
 }
+
+GTEST_TEST(skipper, checked_decode) {
+    {
+        array<byte, 4> a{0x80_b, 0x80_b, 0x00_b, 0x00_b};
+
+        EXPECT_EQ(begin_diff(*skipper<integer_coder<int>>::checked_decode_skip(a), a), sizeof(int));
+        EXPECT_EQ(begin_diff(*skipper<varint_coder<int>>::checked_decode_skip(a), a), 3);
+        EXPECT_EQ(skipper<integer_coder<int64_t>>::checked_decode_skip(a).error(), decode_error::truncated);
+        EXPECT_EQ(skipper<float_coder<double>>::checked_decode_skip(a).error(), decode_error::truncated);
+    }
+
+    {
+        array<byte, 2> a{0x80_b, 0x80_b};
+
+        EXPECT_EQ(skipper<varint_coder<int>>::checked_decode_skip(a).error(), decode_error::truncated);
+    }
+
+    {
+        array<byte, 100> a{0x80_b, 0x01_b};
+
+        EXPECT_EQ(skipper<string_coder>::checked_decode_skip(a).error(), decode_error::length_overflow);
+    }
+}
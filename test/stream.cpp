@@ -0,0 +1,218 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <protopuf/stream.h>
+#include <protopuf/map.h>
+#include <algorithm>
+#include <array>
+
+using namespace pp;
+using namespace std;
+
+namespace {
+    using Student = message<uint32_field<"id", 1>, string_field<"name", 3>>;
+    using Class = message<string_field<"name", 8>, message_field<"students", 3, Student, repeated>,
+                          double_field<"score", 4>, sfixed32_field<"rank", 5>, uint64_field<"ids", 6, packed>>;
+
+    Class make_class() {
+        return Class{"class 101", {Student{123, "tom"}, Student{456, "jerry"}, Student{789, string(200, 'x')}},
+                     2.5, -7, vector<pp::uint<8>>{1, 300, 1ull << 40}};
+    }
+
+    vector<byte> encode(const Class& c) {
+        vector<byte> res(skipper<message_coder<Class>>::encode_skip(c));
+        message_coder<Class>::encode(c, res);
+        return res;
+    }
+}
+
+GTEST_TEST(stream_decoder, missing_field_bytes) {
+    array<byte, 4> a{0x08_b, 0x96_b, 0x01_b, 0x12_b};
+    EXPECT_EQ(*missing_field_bytes(bytes(a).subspan(0, 0)), 1);
+    EXPECT_EQ(*missing_field_bytes(bytes(a).subspan(0, 2)), 1);
+    EXPECT_EQ(*missing_field_bytes(bytes(a).subspan(0, 3)), 0);
+
+    array<byte, 3> b{0x12_b, 0x05_b, 0x61_b};
+    EXPECT_EQ(*missing_field_bytes(bytes(b).subspan(0, 1)), 1);
+    EXPECT_EQ(*missing_field_bytes(b), 4);
+
+    array<byte, 2> c{0x0D_b, 0x01_b};
+    EXPECT_EQ(*missing_field_bytes(c), 3);
+
+    array<byte, 2> d{0x0F_b, 0x01_b};
+    EXPECT_EQ(missing_field_bytes(d).error(), decode_error::bad_wire_type);
+}
+
+GTEST_TEST(stream_decoder, every_split) {
+    auto c = make_class();
+    auto e = encode(c);
+
+    for(size_t i = 0; i <= e.size(); ++i) {
+        for(size_t j = i; j <= e.size(); j += 7) {
+            stream_decoder<Class> d;
+            ASSERT_TRUE(d.feed(bytes(e).subspan(0, i)));
+            ASSERT_TRUE(d.feed(bytes(e).subspan(i, j - i)));
+            ASSERT_TRUE(d.feed(bytes(e).subspan(j)));
+            EXPECT_TRUE(d.at_boundary());
+
+            auto r = std::move(d).finish();
+            ASSERT_TRUE(r);
+            EXPECT_EQ(*r, c);
+        }
+    }
+}
+
+GTEST_TEST(stream_decoder, header_split) {
+    Class c;
+    c["name"_f] = string(300, 'n');
+    c["rank"_f] = 3;
+    auto e = encode(c);
+
+    // the segment ends within the length of the name
+    stream_decoder<Class> d;
+    ASSERT_TRUE(d.feed(bytes(e).subspan(0, 2)));
+    EXPECT_EQ(d.buffered(), 2);
+
+    // the length is completed in one step, then the name up to its end
+    ASSERT_TRUE(d.feed(bytes(e).subspan(2, 10)));
+    EXPECT_EQ(d.buffered(), 12);
+    ASSERT_TRUE(d.feed(bytes(e).subspan(12)));
+    EXPECT_TRUE(d.at_boundary());
+
+    auto r = std::move(d).finish();
+    ASSERT_TRUE(r);
+    EXPECT_EQ(*r, c);
+
+    // bytes after the end of a buffered field are decoded straight from the segment
+    stream_decoder<Class> s;
+    auto n = e.size() - 5;
+    ASSERT_TRUE(s.feed(bytes(e).subspan(0, n - 1)));
+    ASSERT_TRUE(s.feed(bytes(e).subspan(n - 1)));
+    EXPECT_EQ(s.buffered(), 0);
+    EXPECT_EQ(s.value(), c);
+}
+
+GTEST_TEST(stream_decoder, byte_by_byte) {
+    auto c = make_class();
+    auto e = encode(c);
+
+    vector<bytes> segments;
+    for(size_t i = 0; i < e.size(); ++i) {
+        segments.push_back(bytes(e).subspan(i, 1));
+    }
+
+    auto r = stream_decode<Class>(segments);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(*r, c);
+}
+
+GTEST_TEST(stream_decoder, consume_while_streaming) {
+    auto c = make_class();
+    auto e = encode(c);
+
+    stream_decoder<Class> d;
+    size_t seen = 0;
+    for(size_t i = 0; i < e.size(); i += 10) {
+        ASSERT_TRUE(d.feed(bytes(e).subspan(i, min<size_t>(10, e.size() - i))));
+        EXPECT_LE(d.buffered(), 210);
+
+        seen += d.value()["students"_f].size();
+        d.value()["students"_f].clear();
+    }
+
+    EXPECT_EQ(seen, 3);
+    EXPECT_TRUE(d.at_boundary());
+}
+
+GTEST_TEST(stream_decoder, sorted_map) {
+    using Tags = message<sorted_map_field<"tags", 1, string_coder, varint_coder<int32>>, string_field<"name", 2>>;
+
+    Tags t;
+    t["tags"_f].emplace("b", 2);
+    t["tags"_f].emplace("a", 1);
+    t["tags"_f].emplace("c", 3);
+    t["name"_f] = "tags";
+
+    vector<byte> e(skipper<message_coder<Tags>>::encode_skip(t));
+    message_coder<Tags>::encode(t, e);
+
+    // keys on the wire are out of order
+    Tags u;
+    u["tags"_f].emplace("c", 3);
+    vector<byte> c(skipper<message_coder<Tags>>::encode_skip(u));
+    message_coder<Tags>::encode(u, c);
+    e.insert(e.begin(), c.begin(), c.end());
+
+    vector<bytes> segments;
+    for(size_t i = 0; i < e.size(); i += 3) {
+        segments.push_back(bytes(e).subspan(i, min<size_t>(3, e.size() - i)));
+    }
+
+    auto r = stream_decode<Tags>(segments);
+    ASSERT_TRUE(r);
+    const auto& tags = r->get<"tags">();
+    ASSERT_EQ(tags.size(), 3);
+    EXPECT_EQ(tags.at("a"), 1);
+    EXPECT_EQ(tags.at("b"), 2);
+    EXPECT_EQ(tags.at("c"), 3);
+    EXPECT_TRUE(ranges::is_sorted(tags, {}, [](const auto& p) { return p.first; }));
+    EXPECT_EQ(*r, message_coder<Tags>::decode(e).first);
+}
+
+GTEST_TEST(stream_decoder, error) {
+    auto e = encode(make_class());
+
+    {
+        stream_decoder<Class> d;
+        ASSERT_TRUE(d.feed(bytes(e).subspan(0, e.size() - 1)));
+        EXPECT_FALSE(d.at_boundary());
+        EXPECT_EQ(std::move(d).finish().error(), decode_error::truncated);
+    }
+
+    {
+        array<byte, 3> a{0x08_b, 0x01_b, 0x0F_b};
+        stream_decoder<Class> d;
+        EXPECT_FALSE(d.feed(a));
+        EXPECT_EQ(d.error(), decode_error::bad_wire_type);
+        EXPECT_FALSE(d.feed(a));
+    }
+
+    {
+        // a key with field number 0, where contiguous decoding stops and the stream reports it
+        array<byte, 4> a{0x08_b, 0x01_b, 0x00_b, 0x01_b};
+        stream_decoder<Class> d;
+        EXPECT_FALSE(d.feed(a));
+        EXPECT_EQ(d.error(), decode_error::invalid_field_number);
+
+        auto r = message_coder<Class>::checked_decode(a);
+        ASSERT_TRUE(r);
+        EXPECT_EQ(r->second.size(), 2);
+
+        // other malformed bytes are reported the same by both
+        array<byte, 3> b{0x08_b, 0x01_b, 0x0F_b};
+        stream_decoder<Class> s;
+        EXPECT_FALSE(s.feed(b));
+        EXPECT_EQ(s.error(), message_coder<Class>::checked_decode(b).error());
+    }
+
+    {
+        // a student with a truncated name inside a complete embedded message
+        array<byte, 5> a{0x1A_b, 0x03_b, 0x1A_b, 0x05_b, 0x61_b};
+        stream_decoder<Class> d;
+        EXPECT_FALSE(d.feed(a));
+        EXPECT_EQ(d.error(), decode_error::length_overflow);
+    }
+}
@@ -15,6 +15,7 @@
 #include <gtest/gtest.h>
 
 #include <protopuf/varint.h>
+#include <protopuf/skip.h>
 #include <array>
 
 using namespace pp;
@@ -94,3 +95,119 @@ GTEST_TEST(varint, decode) {
         EXPECT_EQ(begin_diff(r, b), 1);
     }
 }
+
+GTEST_TEST(varint, checked_decode) {
+    {
+        array<byte, 3> a{0x96_b, 0x01_b, 0x05_b};
+        auto r = varint_coder<pp::uint<4>>::checked_decode(a);
+        ASSERT_TRUE(r);
+        EXPECT_EQ(r->first, 150);
+        EXPECT_EQ(begin_diff(r->second, a), 2);
+    }
+
+    {
+        array<byte, 2> a{0x96_b, 0x81_b};
+        auto r = varint_coder<pp::uint<4>>::checked_decode(a);
+        ASSERT_FALSE(r);
+        EXPECT_EQ(r.error(), decode_error::truncated);
+        EXPECT_EQ(varint_coder<pp::uint<4>>::checked_decode({}).error(), decode_error::truncated);
+    }
+
+    {
+        array<byte, 11> a{0xff_b, 0xff_b, 0xff_b, 0xff_b, 0xff_b, 0xff_b, 0xff_b, 0xff_b, 0xff_b, 0xff_b, 0x01_b};
+        auto r = varint_coder<pp::uint<8>>::checked_decode(a);
+        ASSERT_FALSE(r);
+        EXPECT_EQ(r.error(), decode_error::overlong_varint);
+    }
+
+    {
+        array<byte, 10> a{0xff_b, 0xff_b, 0xff_b, 0xff_b, 0xff_b, 0xff_b, 0xff_b, 0xff_b, 0xff_b, 0x01_b};
+        auto r = varint_coder<int>::checked_decode(a);
+        ASSERT_TRUE(r);
+        EXPECT_EQ(r->first, -1);
+        EXPECT_EQ(begin_diff(r->second, a), 10);
+    }
+}
+
+GTEST_TEST(varint, size) {
+    static_assert(varint_size(0) == 1);
+    static_assert(varint_size(127) == 1);
+    static_assert(varint_size(128) == 2);
+    static_assert(varint_size(16383) == 2);
+    static_assert(varint_size(16384) == 3);
+    static_assert(varint_size(~0ull >> 8) == 8);
+    static_assert(varint_size(~0ull >> 7) == 9);
+    static_assert(varint_size(~0ull) == 10);
+}
+
+GTEST_TEST(varint, word_impl) {
+    constexpr auto scalar_encode = [](pp::uint<8> n) {
+        array<byte, 10> a{};
+        auto iter = a.begin();
+        do {
+            *iter++ = 0b1000'0000_b | byte(n);
+            n >>= 7;
+        } while(n != 0);
+        *(iter - 1) &= 0b0111'1111_b;
+        return pair{a, size_t(iter - a.begin())};
+    };
+
+    for(size_t bits = 0; bits <= 64; ++bits) {
+        for(pp::uint<8> v : initializer_list<pp::uint<8>>{bits ? pp::uint<8>(1) << (bits - 1) : 0, bits ? ~pp::uint<8>(0) >> (64 - bits) : 0}) {
+            auto [e, len] = scalar_encode(v);
+
+            array<byte, 16> a{};
+            auto n = varint_coder<pp::uint<8>>::encode(v, a);
+            ASSERT_EQ(begin_diff(n, a), len);
+            EXPECT_TRUE(equal(e.begin(), e.begin() + len, a.begin()));
+            EXPECT_EQ(skipper<varint_coder<pp::uint<8>>>::encode_skip(v), len);
+
+            // both the word-at-a-time path (enough bytes) and the tail path (exact bytes)
+            for(bytes b : {bytes(a), bytes(a).subspan(0, len)}) {
+                auto [d, m] = varint_coder<pp::uint<8>>::decode(b);
+                EXPECT_EQ(d, v);
+                EXPECT_EQ(begin_diff(m, b), len);
+
+                auto r = varint_coder<pp::uint<8>>::checked_decode(b);
+                ASSERT_TRUE(r);
+                EXPECT_EQ(r->first, v);
+                EXPECT_EQ(begin_diff(r->second, b), len);
+
+                EXPECT_EQ(begin_diff(skipper<varint_coder<pp::uint<8>>>::decode_skip(b), b), len);
+                EXPECT_EQ(begin_diff(*skipper<varint_coder<pp::uint<8>>>::checked_decode_skip(b), b), len);
+            }
+        }
+    }
+
+    array<byte, 12> a{0x80_b, 0x80_b, 0x80_b, 0x80_b, 0x80_b, 0x80_b, 0x80_b, 0x80_b, 0x80_b, 0x80_b, 0x80_b, 0x01_b};
+    EXPECT_EQ(varint_coder<pp::uint<8>>::checked_decode(a).error(), decode_error::overlong_varint);
+    EXPECT_EQ(varint_coder<pp::uint<8>>::checked_decode(bytes(a).subspan(3, 8)).error(), decode_error::truncated);
+}
+
+GTEST_TEST(varint, count) {
+    array<byte, 40> a{};
+    for(size_t i = 0; i < a.size(); ++i) {
+        a[i] = i % 3 == 0 ? 0x01_b : 0x81_b;
+    }
+
+    EXPECT_EQ(varint_count(a), 14);
+    EXPECT_EQ(varint_count(bytes(a).subspan(1)), 13);
+    EXPECT_EQ(varint_count(bytes(a).subspan(0, 0)), 0);
+
+    constexpr auto f = [] {
+        array<byte, 3> c{0x81_b, 0x01_b, 0x7F_b};
+        return varint_count(c);
+    };
+    static_assert(f() == 2);
+}
+
+GTEST_TEST(varint, constant) {
+    static_assert(varint_bytes<0> == array{0_b});
+    static_assert(varint_bytes<300> == array{0xac_b, 0x02_b});
+    static_assert(varint_bytes<~pp::uint<8>(0)>.size() == 10);
+
+    array<byte, 4> a{};
+    auto n = encode_constant_varint<300>(a);
+    EXPECT_EQ(begin_diff(n, a), 2);
+    EXPECT_EQ(a, (array{0xac_b, 0x02_b, 0_b, 0_b}));
+}
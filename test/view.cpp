@@ -0,0 +1,95 @@
+//   Copyright 2020-2021 PragmaTwice
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <protopuf/message.h>
+#include <array>
+#include <algorithm>
+
+using namespace pp;
+using namespace std;
+
+GTEST_TEST(string_view_coder, encode) {
+    array<byte, 10> e{3_b, 0x61_b, 0x62_b, 0x63_b};
+    array<byte, 10> a{};
+    auto n = string_view_coder::encode("abc"sv, a);
+    EXPECT_EQ(begin_diff(n, a), 4);
+    EXPECT_EQ(a, e);
+
+    EXPECT_EQ(skipper<string_view_coder>::encode_skip("abc"sv), 4);
+}
+
+GTEST_TEST(string_view_coder, decode) {
+    array<byte, 10> a{3_b, 0x61_b, 0x62_b, 0x63_b};
+    auto [v, n] = string_view_coder::decode(a);
+    EXPECT_EQ(begin_diff(n, a), 4);
+    EXPECT_EQ(v, "abc"sv);
+    EXPECT_EQ(static_cast<const void*>(v.data()), static_cast<const void*>(a.data() + 1));
+
+    EXPECT_EQ(begin_diff(skipper<string_view_coder>::decode_skip(a), a), 4);
+}
+
+GTEST_TEST(bytes_view_coder, encode_decode) {
+    constexpr auto f = [] {
+        array<byte, 5> a{};
+        array<byte, 3> v{1_b, 2_b, 3_b};
+        bytes_view_coder::encode(v, a);
+        return a;
+    };
+    static_assert(f() == array<byte, 5>{3_b, 1_b, 2_b, 3_b});
+
+    array<byte, 5> a{3_b, 1_b, 2_b, 3_b, 9_b};
+    auto [v, n] = bytes_view_coder::decode(a);
+    EXPECT_EQ(begin_diff(n, a), 4);
+    EXPECT_EQ(v.data(), a.data() + 1);
+    EXPECT_TRUE(ranges::equal(v, array<byte, 3>{1_b, 2_b, 3_b}));
+}
+
+GTEST_TEST(bytes_view_coder, checked_decode) {
+    array<byte, 3> a{3_b, 1_b, 2_b};
+    EXPECT_EQ(bytes_view_coder::checked_decode(a).error(), decode_error::length_overflow);
+    EXPECT_EQ(string_view_coder::checked_decode(a).error(), decode_error::length_overflow);
+    EXPECT_EQ(skipper<bytes_view_coder>::checked_decode_skip(a).error(), decode_error::length_overflow);
+
+    array<byte, 1> b{0x80_b};
+    EXPECT_EQ(bytes_view_coder::checked_decode(b).error(), decode_error::truncated);
+
+    auto r = bytes_view_coder::checked_decode(span(a).subspan(1));
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->first.size(), 1);
+    EXPECT_EQ(r->first[0], 2_b);
+}
+
+GTEST_TEST(message_coder, view_fields) {
+    using M = message<string_view_field<"name", 1>, bytes_view_field<"blob", 2>, string_view_field<"tags", 3, repeated>>;
+    using N = message<string_field<"name", 1>, bytes_field<"blob", 2>, string_field<"tags", 3, repeated>>;
+
+    array<byte, 64> a{};
+    N owned{"hello", vector<pp::uint<1>>{7, 8}, vector<string>{"x", "yz"}};
+    auto end = message_coder<N>::encode(owned, a);
+    auto len = begin_diff(end, a);
+
+    auto [v, n] = message_coder<M>::decode(a);
+    EXPECT_EQ(begin_diff(n, a), len);
+    EXPECT_EQ(v["name"_f], "hello"sv);
+    EXPECT_TRUE(ranges::equal(*v["blob"_f], array<byte, 2>{7_b, 8_b}));
+    EXPECT_EQ(v["tags"_f], (vector<string_view>{"x", "yz"}));
+
+    array<byte, 64> b{};
+    EXPECT_EQ(skipper<message_coder<M>>::encode_skip(v), len);
+    auto end2 = message_coder<M>::encode(v, b);
+    EXPECT_EQ(begin_diff(end2, b), len);
+    EXPECT_EQ(a, b);
+}